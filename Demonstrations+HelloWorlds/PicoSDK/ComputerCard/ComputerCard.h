@@ -7,7 +7,10 @@ System Computer.
 
 It aims to present a very simple C++ interface for card programmers 
 to use the jacks, knobs, switch and LEDs, for programs running at
-a fixed 48kHz audio sample rate.
+a fixed audio sample rate (48kHz by default, or 24, 32 or 96kHz).
+
+Audio can be processed either one sample at a time (ProcessSample)
+or, optionally, in blocks of several samples (ProcessBlock).
 
 See examples/ directory
 */
@@ -16,8 +19,21 @@ See examples/ directory
 #ifndef COMPUTERCARD_H
 #define COMPUTERCARD_H
 
+// Version of this copy of ComputerCard.h.
+// Cards copied into their own directory can check this, e.g. #if COMPUTERCARD_VERSION < 0x000300
+#define COMPUTERCARD_VERSION_MAJOR 0
+#define COMPUTERCARD_VERSION_MINOR 3
+#define COMPUTERCARD_VERSION_PATCH 0
+#define COMPUTERCARD_VERSION ((COMPUTERCARD_VERSION_MAJOR << 16) | (COMPUTERCARD_VERSION_MINOR << 8) | COMPUTERCARD_VERSION_PATCH)
+
+#include "hardware/flash.h"
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include <cstdio>
+#include <cstring>
 
 #define PULSE_1_RAW_OUT 8
 #define PULSE_2_RAW_OUT 9
@@ -28,6 +44,1338 @@ See examples/ directory
 // USB host status pin
 #define USB_HOST_STATUS 20
 
+// Maximum number of frames per block, when block processing is enabled.
+// Sets the size of the DMA buffers, so can be reduced to save RAM.
+#ifndef COMPUTERCARD_MAX_BLOCK_SIZE
+#define COMPUTERCARD_MAX_BLOCK_SIZE 32
+#endif
+
+// Optional features, each enabled (1) or disabled (0) by defining before including ComputerCard.h.
+// A disabled feature is removed from the audio interrupt entirely, rather than skipped at run time.
+
+// Connected/Disconnected detection (also needs EnableNormalisationProbe() at run time)
+#ifndef COMPUTERCARD_NORMALISATION_PROBE
+#define COMPUTERCARD_NORMALISATION_PROBE 1
+#endif
+
+// Smoothing filters on knobs, switch and CV inputs, each one of:
+//   NoSmoothing                                    - raw ADC readings
+//   OnePoleSmoothing<cutoff Hz>                    - one-pole lowpass filter
+//   OnePoleHysteresisSmoothing<cutoff Hz, amount>  - as above, changing only by more than amount
+// COMPUTERCARD_KNOB_FILTER and COMPUTERCARD_CV_FILTER set all knobs or both CV inputs,
+// and individual inputs can be set with the COMPUTERCARD_MAIN_KNOB_FILTER etc. below.
+#ifndef COMPUTERCARD_KNOB_FILTER
+#define COMPUTERCARD_KNOB_FILTER OnePoleSmoothing<15>
+#endif
+#ifndef COMPUTERCARD_MAIN_KNOB_FILTER
+#define COMPUTERCARD_MAIN_KNOB_FILTER COMPUTERCARD_KNOB_FILTER
+#endif
+#ifndef COMPUTERCARD_X_KNOB_FILTER
+#define COMPUTERCARD_X_KNOB_FILTER COMPUTERCARD_KNOB_FILTER
+#endif
+#ifndef COMPUTERCARD_Y_KNOB_FILTER
+#define COMPUTERCARD_Y_KNOB_FILTER COMPUTERCARD_KNOB_FILTER
+#endif
+#ifndef COMPUTERCARD_SWITCH_FILTER
+#define COMPUTERCARD_SWITCH_FILTER OnePoleSmoothing<15>
+#endif
+#ifndef COMPUTERCARD_CV_FILTER
+#define COMPUTERCARD_CV_FILTER OnePoleSmoothing<246>
+#endif
+#ifndef COMPUTERCARD_CV1_FILTER
+#define COMPUTERCARD_CV1_FILTER COMPUTERCARD_CV_FILTER
+#endif
+#ifndef COMPUTERCARD_CV2_FILTER
+#define COMPUTERCARD_CV2_FILTER COMPUTERCARD_CV_FILTER
+#endif
+
+// Compensation for the RP2040 ADC differential non-linearity, on CV inputs
+#ifndef COMPUTERCARD_DNL_CORRECTION
+#define COMPUTERCARD_DNL_CORRECTION 1
+#endif
+
+// Clamp values passed to CVOut to -2048 to 2047. If disabled, out-of-range values wrap around.
+#ifndef COMPUTERCARD_CLAMP_CV_OUTPUTS
+#define COMPUTERCARD_CLAMP_CV_OUTPUTS 0
+#endif
+
+// Per-unit ADC calibration, read from the EEPROM at startup (see ADCCalibration): each ADC reading is
+// corrected by a 4096-entry table (4kB of RAM), replacing COMPUTERCARD_DNL_CORRECTION, and audio and CV
+// input offsets are removed. Calibrations are measured and saved by the adc_calibration example.
+#ifndef COMPUTERCARD_ADC_CALIBRATION
+#define COMPUTERCARD_ADC_CALIBRATION 0
+#endif
+
+// CVOutPrecise, with 19-bit CV output values, sigma-delta modulated onto the 11-bit PWM,
+// with a new level written by DMA at each PWM wrap.
+// 1 for first-order noise shaping, 2 for second-order (see SigmaDeltaModulator), 0 to disable.
+#ifndef COMPUTERCARD_PRECISE_CV
+#define COMPUTERCARD_PRECISE_CV 0
+#endif
+
+// AudioOutPrecise, with 16-bit audio outputs reduced to the DAC's 12 bits with dither (see AudioDither).
+// 1 for TPDF dither, 2 for TPDF dither with first-order noise shaping, 0 to disable.
+#ifndef COMPUTERCARD_AUDIO_DITHER
+#define COMPUTERCARD_AUDIO_DITHER 0
+#endif
+
+// Audio inputs filtered from all ADC readings by a CIC decimator and compensating FIR (see AudioDecimator),
+// rather than averaging two readings. Lowers noise and aliasing, at the cost of ~2 samples' latency.
+#ifndef COMPUTERCARD_AUDIO_DECIMATION
+#define COMPUTERCARD_AUDIO_DECIMATION 0
+#endif
+
+// CV output calibration between the points stored in the EEPROM: 0 for the least-squares straight line
+// through them, 1 for straight lines joining neighbouring points (more accurate if the outputs are not quite linear)
+#ifndef COMPUTERCARD_PIECEWISE_CALIBRATION
+#define COMPUTERCARD_PIECEWISE_CALIBRATION 0
+#endif
+
+// I2C clock for reading the calibration data from the EEPROM at startup.
+// 400000 (fast mode, within the EEPROM's rating) shortens startup by a few more milliseconds.
+#ifndef COMPUTERCARD_EEPROM_I2C_HZ
+#define COMPUTERCARD_EEPROM_I2C_HZ 100000
+#endif
+
+// Set to 1 if everything the audio interrupt runs or reads, including constant data, is in RAM,
+// so that audio can continue while FlashSettings writes to flash. Set by default for cards
+// built with pico_set_binary_type(<card> copy_to_ram), which run entirely from RAM.
+#ifndef COMPUTERCARD_AUDIO_IN_RAM
+#if defined(PICO_COPY_TO_RAM) && PICO_COPY_TO_RAM
+#define COMPUTERCARD_AUDIO_IN_RAM 1
+#else
+#define COMPUTERCARD_AUDIO_IN_RAM 0
+#endif
+#endif
+
+// Capacity of the queue of events sent to OnEvent with PostEvent (a power of two)
+#ifndef COMPUTERCARD_EVENT_QUEUE_SIZE
+#define COMPUTERCARD_EVENT_QUEUE_SIZE 64
+#endif
+
+// Set to 1 when linking with memmap_audio_bank.ld (see README), which gives the audio interrupt
+// SRAM bank 3 to itself. ComputerCard's DMA buffers, and data marked COMPUTERCARD_AUDIO_DATA,
+// then go in that bank, so that the audio core and DMA don't wait for the second core's memory accesses.
+#ifndef COMPUTERCARD_AUDIO_BANK
+#define COMPUTERCARD_AUDIO_BANK 0
+#endif
+
+// Bytes of RAM that ComputerCard::MemoryBudget keeps back for the Pico SDK, code run from RAM
+// (__not_in_flash_func, including ComputerCard's audio interrupt) and other small static data.
+#ifndef COMPUTERCARD_RAM_RESERVE
+#define COMPUTERCARD_RAM_RESERVE 16384
+#endif
+
+// Number of trace records kept for each core (a power of two), or 0 to remove tracing (see TraceBuffer).
+// Each record takes 12 bytes; the audio interrupt writes two per interrupt.
+#ifndef COMPUTERCARD_TRACE_SIZE
+#define COMPUTERCARD_TRACE_SIZE 0
+#endif
+
+// Section attribute for data used by the audio interrupt, such as the card object itself:
+// placed in SRAM bank 3 with COMPUTERCARD_AUDIO_BANK, and not initialised at startup,
+// so only for variables set by a constructor or at runtime. Elsewhere, has no effect.
+#if COMPUTERCARD_AUDIO_BANK
+#define COMPUTERCARD_AUDIO_DATA __attribute__((section(".audio_bank")))
+#else
+#define COMPUTERCARD_AUDIO_DATA
+#endif
+
+// Time source for the profiler (see EnableProfiler).
+// By default, the 24-bit SysTick counter of the audio core, counting processor clock cycles.
+// Another source (e.g. a mock timer, for testing) can be used by defining all three of
+// COMPUTERCARD_PROFILER_TICKS(), COMPUTERCARD_PROFILER_TICK_MASK and COMPUTERCARD_PROFILER_TICK_HZ.
+#ifndef COMPUTERCARD_PROFILER_TICKS
+#define COMPUTERCARD_PROFILER_SYSTICK
+#define COMPUTERCARD_PROFILER_TICKS() (~systick_hw->cvr) // SysTick counts down
+#define COMPUTERCARD_PROFILER_TICK_MASK 0x00FFFFFFu
+#define COMPUTERCARD_PROFILER_TICK_HZ clock_get_hz(clk_sys)
+#endif
+
+// Time source for trace records (see TraceBuffer), which must be shared by both cores.
+// By default, the 1MHz system timer. Another can be used by defining both of
+// COMPUTERCARD_TRACE_TICKS() and COMPUTERCARD_TRACE_TICK_HZ.
+#ifndef COMPUTERCARD_TRACE_TICKS
+#define COMPUTERCARD_TRACE_TICKS() time_us_32()
+#define COMPUTERCARD_TRACE_TICK_HZ 1000000
+#endif
+
+
+////////////////////////////////////////
+// Lock-free data exchange between the two RP2040 cores,
+// or between the audio interrupt and code running outside it.
+
+/** \brief Fixed-capacity, single-producer single-consumer ring buffer.
+
+	One core (or the audio interrupt) only calls Push, and the other only calls Pop.
+	Neither ever blocks or disables interrupts. Capacity must be a power of two.
+	Each side keeps its own copy of the other's index, so only reads the
+	shared index when the ring appears full (Push) or empty (Pop).
+*/
+template <typename T, unsigned Capacity>
+class SPSCRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SPSCRing capacity must be a power of two");
+
+public:
+	SPSCRing() : head(0), producerTail(0), tail(0), consumerHead(0) {}
+
+	/// Add one item. Returns false, dropping the item, if the ring is full. Producer only.
+	bool Push(const T &item) {return Push(&item, 1) == 1;}
+
+	/// Add up to n items, returning the number added. Producer only.
+	unsigned Push(const T *items, unsigned n)
+	{
+		uint32_t h = head;
+		if (Capacity - (h - producerTail) < n) producerTail = tail;
+		uint32_t space = Capacity - (h - producerTail);
+		if (n > space) n = space;
+
+		for (unsigned i = 0; i < n; i++) buffer[(h + i) & mask] = items[i];
+
+		__dmb(); // items must be written before they are published
+		head = h + n;
+		return n;
+	}
+
+	/// Remove one item. Returns false if the ring is empty. Consumer only.
+	bool Pop(T &item) {return Pop(&item, 1) == 1;}
+
+	/// Remove up to n items, returning the number removed. Consumer only.
+	unsigned Pop(T *items, unsigned n)
+	{
+		uint32_t t = tail;
+		if (consumerHead - t < n)
+		{
+			consumerHead = head;
+			__dmb(); // items must not be read before head
+		}
+		uint32_t avail = consumerHead - t;
+		if (n > avail) n = avail;
+
+		for (unsigned i = 0; i < n; i++) items[i] = buffer[(t + i) & mask];
+
+		__dmb(); // items must be read before their slots are released
+		tail = t + n;
+		return n;
+	}
+
+	/// Copy the oldest item without removing it. Returns false if the ring is empty. Consumer only.
+	bool Peek(T &item)
+	{
+		uint32_t t = tail;
+		if (consumerHead == t)
+		{
+			consumerHead = head;
+			__dmb(); // item must not be read before head
+		}
+		if (consumerHead == t) return false;
+		item = buffer[t & mask];
+		return true;
+	}
+
+	/// Number of items in the ring (may be out of date by the time it is used)
+	unsigned Size() const {return head - tail;}
+
+	bool Empty() const {return Size() == 0;}
+	bool Full() const {return Size() == Capacity;}
+
+private:
+	static constexpr uint32_t mask = Capacity - 1;
+
+	T buffer[Capacity];
+
+	volatile uint32_t head;  // written by producer
+	uint32_t producerTail;   // producer's copy of tail
+	volatile uint32_t tail;  // written by consumer
+	uint32_t consumerHead;   // consumer's copy of head
+};
+
+
+/** \brief Queue of items that are each due at a given time, such as a sample count.
+
+	The producer pushes each item with the time it is due, and the consumer
+	takes items from the front of the queue only once their time has come.
+	Items must be pushed in order of time. Times are compared allowing for
+	wrap-around, so must be within 2^31 of each other.
+	Like SPSCRing, on which it is built, there is one producer and one consumer,
+	and neither ever blocks.
+*/
+template <typename T, unsigned Capacity>
+class TimedQueue
+{
+public:
+	/// Add an item due at the given time. Returns false, dropping the item, if the queue is full. Producer only.
+	bool Push(uint32_t time, const T &item) {return ring.Push(Entry{time, item});}
+
+	/// Remove the oldest item if it is due at or before now, optionally returning the time it was due.
+	/// Returns false if there is no such item. Consumer only.
+	bool PopDue(uint32_t now, T &item, uint32_t *time = nullptr)
+	{
+		Entry e;
+		if (!ring.Peek(e) || int32_t(e.time - now) > 0) return false;
+		ring.Pop(e);
+		item = e.item;
+		if (time) *time = e.time;
+		return true;
+	}
+
+	/// Number of items in the queue (may be out of date by the time it is used)
+	unsigned Size() const {return ring.Size();}
+
+	bool Empty() const {return ring.Empty();}
+
+private:
+	struct Entry
+	{
+		uint32_t time;
+		T item;
+	};
+	SPSCRing<Entry, Capacity> ring;
+};
+
+
+/** \brief Latest-value mailbox: one writer publishes a set of N values, and readers get the most recent complete set.
+
+	For example, parameters calculated on one core and used on the other.
+	Neither side ever blocks on the other, so the writer or reader may be the audio interrupt.
+	The values are double-buffered, with a sequence count used to detect a read
+	that overlapped two writes, in which case the read is retried.
+*/
+template <typename T, unsigned N = 1>
+class Mailbox
+{
+public:
+	Mailbox() : seq(0)
+	{
+		for (unsigned i = 0; i < N; i++) slots[0][i] = slots[1][i] = T();
+	}
+
+	/// Publish the first n values (n <= N). The rest keep their previous values. Writer only.
+	void Write(const T *values, unsigned n = N)
+	{
+		// Write number k+1 goes into slot (k+1)&1, while readers use slot k&1
+		uint32_t k = seq >> 1;
+		const T *latest = slots[k & 1];
+		T *slot = slots[(k + 1) & 1];
+
+		seq = 2 * k + 1; // odd while writing
+		__dmb();
+		for (unsigned i = 0; i < N; i++) slot[i] = (i < n) ? values[i] : latest[i];
+		__dmb();
+		seq = 2 * k + 2;
+	}
+
+	/// Publish a single value (N = 1). Writer only.
+	void Write(const T &value) {Write(&value, 1);}
+
+	/// Copy the first n of the latest values. Returns the number of writes so far, which can be
+	/// compared with the previous return value to tell whether new values have arrived.
+	uint32_t Read(T *values, unsigned n = N) const
+	{
+		while (true)
+		{
+			uint32_t s = seq;
+			uint32_t k = s >> 1;
+			__dmb();
+			const T *slot = slots[k & 1];
+			for (unsigned i = 0; i < n; i++) values[i] = slot[i];
+			__dmb();
+
+			// This slot is only overwritten once write k+2 starts
+			if (seq - 2 * k <= 2) return k;
+		}
+	}
+
+	/// Read a single value (N = 1)
+	uint32_t Read(T &value) const {return Read(&value, 1);}
+
+	/// Number of writes so far
+	uint32_t Writes() const {return seq >> 1;}
+
+private:
+	T slots[2][N];
+	volatile uint32_t seq; // twice the number of writes, plus one while a write is in progress
+};
+
+
+////////////////////////////////////////
+// Trace buffer, for timing code on the hardware (see COMPUTERCARD_TRACE_SIZE)
+
+/** \brief Ring buffers of timestamped trace records, written from the audio interrupt and either core.
+
+	Each record is a time, an event ID, a type (the start or end of a span, an instant, or a
+	counter value) and a 32-bit value. Each core writes to its own ring of Size records, with
+	interrupts disabled for the few cycles of the write, so writes never wait for the other core.
+	When a ring is full, the oldest records are overwritten.
+
+	Dump writes the records out as lines of text, e.g. over USB serial,
+	which host/trace_decode converts to a Chrome trace / Perfetto JSON file.
+	Size 0 removes tracing, so that every call does nothing.
+*/
+template <unsigned Size>
+class TraceBuffer
+{
+	static_assert((Size & (Size - 1)) == 0, "TraceBuffer size must be a power of two");
+
+public:
+	enum Type : uint8_t {Begin = 'B', End = 'E', Instant = 'I', Counter = 'C'};
+
+	/// IDs below this may be named with SetName, for the decoder
+	static constexpr unsigned maxNamedIds = 64;
+
+	TraceBuffer() : head{0, 0}, paused(false)
+	{
+		for (unsigned i = 0; i < maxNamedIds; i++) names[i] = nullptr;
+	}
+
+	/// Add a record, with the current time, to the calling core's ring
+	void __not_in_flash_func(Write)(Type type, uint16_t id, uint32_t value)
+	{
+		uint core = get_core_num();
+		uint32_t irq = save_and_disable_interrupts();
+		if (!paused)
+		{
+			Record &r = records[core][head[core] & (Size - 1)];
+			r.time = COMPUTERCARD_TRACE_TICKS();
+			r.id = id;
+			r.type = type;
+			r.value = value;
+			head[core] = head[core] + 1;
+		}
+		restore_interrupts(irq);
+	}
+
+	/// Give an ID a name, shown by the decoder. The string is not copied, so must be kept (e.g. a literal).
+	void SetName(uint16_t id, const char *name)
+	{
+		if (id < maxNamedIds) names[id] = name;
+	}
+
+	/** \brief Write out the names and records, one line at a time, to a function such as one printing to USB serial.
+
+		Recording is paused during the dump, so records written meanwhile are lost.
+		Returns the number of records written.
+	*/
+	template <typename LineWriter>
+	unsigned Dump(LineWriter &&writeLine)
+	{
+		char line[64];
+		paused = true;
+		__dmb();
+
+		snprintf(line, sizeof(line), "# computercard-trace 1 tick_hz=%lu\n", (unsigned long)(COMPUTERCARD_TRACE_TICK_HZ));
+		writeLine(line);
+		for (unsigned i = 0; i < maxNamedIds; i++)
+		{
+			if (!names[i]) continue;
+			snprintf(line, sizeof(line), "N %u %s\n", i, names[i]);
+			writeLine(line);
+		}
+
+		unsigned count = 0;
+		for (unsigned core = 0; core < 2; core++)
+		{
+			uint32_t end = head[core];
+			uint32_t start = end > Size ? end - Size : 0;
+			for (uint32_t i = start; i != end; i++, count++)
+			{
+				const Record &r = records[core][i & (Size - 1)];
+				snprintf(line, sizeof(line), "R %u %lu %c %u %lu\n", core, (unsigned long)r.time, char(r.type),
+						 unsigned(r.id), (unsigned long)r.value);
+				writeLine(line);
+			}
+		}
+		writeLine("# end\n");
+
+		__dmb();
+		paused = false;
+		return count;
+	}
+
+	/// Discard all records
+	void Clear()
+	{
+		uint32_t irq = save_and_disable_interrupts();
+		head[0] = head[1] = 0;
+		restore_interrupts(irq);
+	}
+
+private:
+	struct Record
+	{
+		uint32_t time;
+		uint16_t id;
+		uint8_t type;
+		uint32_t value;
+	};
+
+	Record records[2][Size];
+	volatile uint32_t head[2]; // records written by each core
+	volatile bool paused;
+	const char *names[maxNamedIds];
+};
+
+/// Tracing removed: every call does nothing
+template <>
+class TraceBuffer<0>
+{
+public:
+	enum Type : uint8_t {Begin = 'B', End = 'E', Instant = 'I', Counter = 'C'};
+	static constexpr unsigned maxNamedIds = 64;
+
+	void Write(Type, uint16_t, uint32_t) {}
+	void SetName(uint16_t, const char *) {}
+	template <typename LineWriter>
+	unsigned Dump(LineWriter &&) {return 0;}
+	void Clear() {}
+};
+
+
+////////////////////////////////////////
+// Sigma-delta modulator for the precise CV outputs (see COMPUTERCARD_PRECISE_CV)
+
+/** \brief Converts a level with 8 fractional bits into a sequence of integer PWM levels
+	(0 to MaxLevel), one per call to Next, whose average is the requested level.
+
+	The quantisation error of each output is fed back into the following ones,
+	shaping the error spectrum so that it is mostly at high frequencies, where it
+	is removed by the analogue filter after the PWM output.
+	Order 0 simply truncates. Order 1 feeds back the last error, giving noise
+	rising at 6dB/octave. Order 2 feeds back the last two errors, giving noise rising
+	at 12dB/octave: less noise at low frequencies, at the cost of the output
+	jumping over a wider range of levels (and so more noise at high frequencies).
+	The shaping assumes that every output lasts the same time, so ComputerCard calls Next
+	once per CV output PWM period (~61kHz), queuing the levels for DMA to write to the PWM
+	at each wrap. At 48kHz, below 200Hz, order 1 gives about 21 effective bits and order 2
+	about 22 (more with block processing), far finer than the analogue output's own noise.
+	host/sigma_delta_model.cpp models this timing.
+*/
+template <int Order, int32_t MaxLevel = 2047>
+class SigmaDeltaModulator
+{
+	static_assert(Order >= 0 && Order <= 2, "SigmaDeltaModulator order must be 0, 1 or 2");
+
+public:
+	SigmaDeltaModulator() : e1(0), e2(0) {}
+
+	/// Next output level, for requested level value/256
+	int32_t __not_in_flash_func(Next)(uint32_t value)
+	{
+		int32_t u = int32_t(value);
+		if constexpr (Order == 1) u += e1;
+		if constexpr (Order == 2) u += 2 * e1 - e2;
+
+		int32_t q = u >> 8;
+		if (q < 0) q = 0;
+		if (q > MaxLevel) q = MaxLevel;
+
+		if constexpr (Order > 0)
+		{
+			// Error is limited so that the modulator recovers quickly after requests beyond the end levels
+			int32_t e = u - (q << 8);
+			if (e < -1024) e = -1024;
+			if (e > 1023) e = 1023;
+			e2 = e1;
+			e1 = e;
+		}
+		return q;
+	}
+
+private:
+	int32_t e1, e2; // last two quantisation errors, with 8 fractional bits
+};
+
+
+////////////////////////////////////////
+// Dither for the audio outputs (see COMPUTERCARD_AUDIO_DITHER)
+
+/** \brief Reduces 16-bit audio samples (-32768 to 32767) to 12-bit DAC values
+	(-2048 to 2047), one per call to Next.
+
+	Mode 0 rounds to the nearest value. Simply dropping the lowest bits leaves an error
+	that follows the signal, heard as distortion on quiet sounds such as reverb tails
+	and fades. Mode 1 adds TPDF (triangular) dither of ±1 DAC step before rounding,
+	which turns the error into a steady hiss, independent of the signal, with three
+	times the power of the rounding error. Mode 2 also feeds back the last error, as
+	SigmaDeltaModulator order 1 does, so that the noise rises at 6dB/octave: below
+	~8kHz (at 48kHz) it is quieter than plain rounding, above it louder.
+	Mode 2 only suits low-bandwidth material, such as bass or signals filtered below a
+	few kHz. Over the full audio band it is the noisiest mode: for a sine of 2 DAC steps,
+	host/dither_model.cpp measures an SNR over 0-20kHz of 7.7dB against 15.1dB for mode 0,
+	and over 0-4kHz of 27.2dB against 25.1dB. For full-bandwidth audio, use mode 1.
+	The dither comes from a linear congruential generator, so costs a multiply and a
+	few additions and shifts per sample.
+*/
+template <int Mode>
+class AudioDither
+{
+	static_assert(Mode >= 0 && Mode <= 2, "AudioDither mode must be 0, 1 or 2");
+
+public:
+	/// Different seeds give uncorrelated dither, e.g. for the two audio channels
+	AudioDither(uint32_t seed = 1) : e1(0), rng(seed) {}
+
+	/// Next DAC value, for 16-bit sample value
+	int32_t __not_in_flash_func(Next)(int32_t value)
+	{
+		int32_t u = value;
+		if constexpr (Mode == 2) u += e1;
+		int32_t d = 0;
+		if constexpr (Mode > 0)
+		{
+			// Sum of two uniform 4-bit random numbers, from the top (most random) bits of the LCG
+			rng = rng * 1664525u + 1013904223u;
+			d = int32_t(rng >> 28) + int32_t((rng >> 24) & 15) - 15;
+		}
+
+		int32_t q = (u + d + 8) >> 4;
+		if (q < -2048) q = -2048;
+		if (q > 2047) q = 2047;
+
+		if constexpr (Mode == 2)
+		{
+			// The error fed back includes the dither, so that the dither noise is shaped too.
+			// It is limited so that the output recovers quickly after clipping.
+			int32_t e = u - (q << 4);
+			if (e < -32) e = -32;
+			if (e > 31) e = 31;
+			e1 = e;
+		}
+		return q;
+	}
+
+private:
+	int32_t e1; // last quantisation error, in 16-bit steps
+	uint32_t rng;
+};
+
+
+////////////////////////////////////////
+// Decimation filter for the audio inputs (see COMPUTERCARD_AUDIO_DECIMATION)
+
+/** \brief Turns the several ADC readings of one input made during each audio sample
+	into one filtered sample, with 4 extra fractional bits.
+
+	A third-order CIC (cascaded integrator-comb) filter decimates by the number of
+	readings per sample (1, 2 or 4), using only additions. This rejects the signals
+	between readings that would otherwise alias into the audio band, but droops at high
+	frequencies, which a 3-tap FIR compensates to within ±0.35dB up to 0.3× the sample rate.
+	Total latency is about two samples.
+	Against averaging the readings, aliases of signals near the sample rate are ~30dB lower
+	with 2 readings per sample and ~48dB lower with 4, and with 4, random ADC noise is ~0.6 bits
+	lower. The FIR lifts the response by up to 0.3dB around 10kHz before it rolls off, to about
+	-2.4dB (2 readings) or -2.9dB (4 readings) at 20kHz. host/decimator_model.cpp measures these.
+*/
+class AudioDecimator
+{
+public:
+	AudioDecimator() {SetFactor(1);}
+
+	/// Set the number of readings per sample (1, 2 or 4), and clear the filter
+	void SetFactor(unsigned factor)
+	{
+		// CIC gain is factor³; compensation coefficient (8 fractional bits) fitted for 3 stages
+		shift = (factor >= 4) ? 6 : ((factor >= 2) ? 3 : 0);
+		comp = (factor >= 4) ? 47 : ((factor >= 2) ? 36 : 0);
+		i1 = i2 = i3 = 0;
+		d1 = d2 = d3 = 0;
+		y1 = y2 = 0;
+	}
+
+	/// Filter n readings (0-4095), stride words apart, returning the sample (0-65535, may overshoot)
+	int32_t __not_in_flash_func(Next)(const uint16_t *reading, unsigned stride, unsigned n)
+	{
+		// Integrators run at the reading rate. Unsigned arithmetic wraps harmlessly.
+		for (unsigned i = 0; i < n; i++)
+		{
+			i1 += reading[i * stride];
+			i2 += i1;
+			i3 += i2;
+		}
+
+		// Combs run at the sample rate
+		uint32_t c1 = i3 - d1;
+		d1 = i3;
+		uint32_t c2 = c1 - d2;
+		d2 = c1;
+		uint32_t c3 = c2 - d3;
+		d3 = c2;
+		int32_t y = int32_t(c3 << 4) >> shift;
+
+		// Droop compensation, -a + (1+2a)z⁻¹ - az⁻²
+		int32_t out = (y1 * (256 + 2 * comp) - comp * (y + y2)) >> 8;
+		y2 = y1;
+		y1 = y;
+		return out;
+	}
+
+private:
+	uint32_t i1, i2, i3, d1, d2, d3;
+	int32_t y1, y2;
+	unsigned shift;
+	int32_t comp;
+};
+
+
+////////////////////////////////////////
+// Linear ramp, for values calculated at control rate (see ProcessControl) and used every sample
+
+/** \brief A value that moves in a straight line to a new target over a given number of steps.
+
+	Typically set in ProcessControl and advanced with Next in ProcessSample, so that coefficients
+	calculated once every few samples change smoothly rather than in steps ('zipper' noise).
+	The ramp reaches its target exactly. The difference between the target and the current value must fit in an int32_t.
+*/
+class LinearRamp
+{
+public:
+	LinearRamp(int32_t initial = 0) {Jump(initial);}
+
+	/// Move from the current value to target over the next 'steps' calls to Next
+	void Set(int32_t target, unsigned steps)
+	{
+		if (steps < 1) steps = 1;
+		int32_t diff = target - value;
+		dest = target;
+		remaining = steps;
+		count = int32_t(steps);
+		step = diff / count;
+		int32_t rem = diff % count;
+		carry = (rem < 0) ? -1 : 1;
+		fraction = (rem < 0) ? -rem : rem;
+		error = 0;
+	}
+
+	/// Set the value immediately, stopping any ramp
+	void Jump(int32_t v)
+	{
+		value = dest = v;
+		remaining = 0;
+	}
+
+	/// Advance one step along the ramp, and return the new value
+	int32_t __not_in_flash_func(Next)()
+	{
+		if (remaining)
+		{
+			remaining--;
+			value += step;
+			// Spread the remainder of the division evenly along the ramp
+			error += fraction;
+			if (error >= count)
+			{
+				error -= count;
+				value += carry;
+			}
+		}
+		return value;
+	}
+
+	int32_t Value() const {return value;}
+	int32_t Target() const {return dest;}
+
+private:
+	int32_t value, dest, step, carry, fraction, error, count;
+	unsigned remaining;
+};
+
+
+////////////////////////////////////////
+// Persistent settings, stored in flash
+
+/** \brief Key/value store keeping NumKeys int32_t settings in a ring of NumSectors flash sectors.
+
+	Get and Set only use copies of the values in RAM, so are quick enough to use in the audio interrupt.
+	Commit then writes changed values to flash, one flash operation per call, from code outside
+	the audio interrupt: usually the Background callback, or a loop on the other core.
+	Each changed value is appended to the current sector as an 8-byte record, rather than
+	rewriting the sector. Only when that sector is full is the next one in the ring erased
+	and the latest values copied into it, so erases are rare and spread over all the sectors.
+	Each record has a CRC, and a sector's header is written after the values copied into it,
+	so power loss at any point leaves each setting with either its old or its new value.
+	host/settings_model.cpp checks this against a simulated flash device, with power failures.
+
+	Flash cannot be read while it is being erased or programmed, so no code may run from flash
+	on either core during Commit. If the audio interrupt runs entirely from RAM (COMPUTERCARD_AUDIO_IN_RAM),
+	it carries on during Commit; otherwise, interrupts are disabled for each flash operation,
+	which stops audio for up to ~1ms (programming one 256-byte page) or ~50ms (erasing a sector).
+	Code running on the other core must be paused around Commit, e.g. with multicore_lockout_start_blocking.
+*/
+template <unsigned NumKeys, unsigned NumSectors = 4>
+class FlashSettings
+{
+	static constexpr uint32_t magic = 0x53534343; // "CCSS"
+	static constexpr uint32_t headerSize = 16;
+	static constexpr uint32_t recordSize = 8;
+	static constexpr uint32_t noSector = 0xFFFFFFFF;
+
+	static_assert(NumKeys >= 1 && NumKeys <= 255, "FlashSettings supports 1 to 255 keys");
+	static_assert(NumSectors >= 2, "FlashSettings needs at least two sectors");
+	static_assert(headerSize + NumKeys * recordSize <= FLASH_SECTOR_SIZE / 2, "FlashSettings keys must fill at most half a sector");
+
+public:
+	/// Default location: the NumSectors sectors below the last sector of flash, which is left for other uses
+	static constexpr uint32_t defaultOffset = PICO_FLASH_SIZE_BYTES - (NumSectors + 1) * FLASH_SECTOR_SIZE;
+
+	/// Store in NumSectors sectors from flashOffset bytes into flash (a multiple of FLASH_SECTOR_SIZE)
+	FlashSettings(uint32_t flashOffset = defaultOffset) : offset(flashOffset)
+	{
+		Clear();
+	}
+
+	/** \brief Read the stored settings from flash, returning false if there are none.
+
+		Use before Run(), or otherwise when Commit is not running.
+	*/
+	bool Load()
+	{
+		Clear();
+
+		// The newest sector is the valid one with the highest sequence number
+		for (uint32_t s = 0; s < NumSectors; s++)
+		{
+			uint32_t h[4];
+			memcpy(h, Address(s, 0), headerSize);
+			if (h[0] != magic || h[2] != ~h[1]) continue;
+			if (active == noSector || int32_t(h[1] - seq) > 0)
+			{
+				active = s;
+				seq = h[1];
+			}
+		}
+		if (active == noSector) return false;
+
+		// Replay its records in order. An invalid record was cut short by power loss,
+		// and nothing can be appended after it, so the next Commit starts a new sector.
+		for (writePos = headerSize; writePos + recordSize <= FLASH_SECTOR_SIZE; writePos += recordSize)
+		{
+			Record r;
+			memcpy(&r, Address(active, writePos), recordSize);
+			if (r.Erased()) break;
+			if (!r.Valid() || r.key >= NumKeys)
+			{
+				full = true;
+				break;
+			}
+			stored[r.key] = r.value;
+			storedPresent[r.key] = true;
+		}
+		if (writePos + recordSize > FLASH_SECTOR_SIZE) full = true;
+
+		for (unsigned k = 0; k < NumKeys; k++)
+		{
+			values[k] = stored[k];
+			present[k] = storedPresent[k];
+		}
+		return true;
+	}
+
+	/// True if the setting has been loaded or set
+	bool __not_in_flash_func(Has)(unsigned key) const {return present[key];}
+
+	/// Value of a setting, or defaultValue if it has never been set
+	int32_t __not_in_flash_func(Get)(unsigned key, int32_t defaultValue = 0) const
+	{
+		return present[key] ? values[key] : defaultValue;
+	}
+
+	/// Change a setting in RAM, to be written to flash by Commit. May be used in the audio interrupt.
+	void __not_in_flash_func(Set)(unsigned key, int32_t value)
+	{
+		values[key] = value;
+		__dmb(); // value must be written before it is marked present
+		present[key] = true;
+	}
+
+	/// True if any setting differs from the one in flash
+	bool Pending() const
+	{
+		for (unsigned k = 0; k < NumKeys; k++)
+		{
+			if (Changed(k)) return true;
+		}
+		return stage != Idle;
+	}
+
+	/** \brief Write changed settings to flash, one page or one sector erase at a time.
+
+		Returns true once every setting is in flash, so call repeatedly (not from the audio interrupt)
+		until it returns true. Values set while a commit is under way are written by later calls.
+	*/
+	bool Commit()
+	{
+		if (stage == Idle)
+		{
+			if (!Pending()) return true;
+			if (active != noSector && !full)
+			{
+				AppendPage();
+				return !Pending();
+			}
+
+			// Start a new sector, with a copy of the latest value of every setting
+			target = (active == noSector) ? 0 : (active + 1) % NumSectors;
+			copyCount = 0;
+			for (unsigned k = 0; k < NumKeys; k++)
+			{
+				if (!present[k]) continue;
+				copyKeys[copyCount] = uint8_t(k);
+				copyValues[copyCount++] = values[k];
+			}
+			stage = Erase;
+		}
+
+		uint8_t page[FLASH_PAGE_SIZE];
+		memset(page, 0xFF, sizeof(page));
+		switch (stage)
+		{
+		case Erase:
+			FlashErase(target);
+			copyPos = 0;
+			stage = Copy;
+			break;
+
+		case Copy:
+			// Records are copied page by page after the header, which stays erased for now
+			for (unsigned i = 0; i < copyCount; i++)
+			{
+				uint32_t pos = headerSize + i * recordSize;
+				if (pos < copyPos || pos >= copyPos + FLASH_PAGE_SIZE) continue;
+				Record r(copyKeys[i], copyValues[i]);
+				memcpy(page + pos - copyPos, &r, recordSize);
+			}
+			FlashProgram(target, copyPos, page);
+			copyPos += FLASH_PAGE_SIZE;
+			if (copyPos >= headerSize + copyCount * recordSize) stage = Header;
+			break;
+
+		case Header:
+		{
+			// Once the header is written, the new sector replaces the old one
+			uint32_t h[4] = {magic, seq + 1, ~(seq + 1), 0xFFFFFFFF};
+			memcpy(page, h, headerSize);
+			FlashProgram(target, 0, page);
+
+			active = target;
+			seq++;
+			for (unsigned k = 0; k < NumKeys; k++) storedPresent[k] = false;
+			for (unsigned i = 0; i < copyCount; i++)
+			{
+				stored[copyKeys[i]] = copyValues[i];
+				storedPresent[copyKeys[i]] = true;
+			}
+			writePos = headerSize + copyCount * recordSize;
+			full = false;
+			stage = Idle;
+			break;
+		}
+
+		default:
+			break;
+		}
+		return !Pending();
+	}
+
+private:
+	// Value first and CRC last, so that a record cut short by power loss fails its CRC
+	struct Record
+	{
+		int32_t value;
+		uint8_t key, check; // check is ~key
+		uint16_t crc;       // never 0xFFFF, so an unwritten CRC is always invalid
+
+		Record() {}
+		Record(uint8_t k, int32_t v) : value(v), key(k), check(uint8_t(~k)), crc(CRC()) {}
+
+		uint16_t CRC() const
+		{
+			// CRC-16/CCITT of key and value
+			uint8_t bytes[5] = {key, uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(uint32_t(value) >> 24)};
+			uint16_t c = 0xFFFF;
+			for (unsigned i = 0; i < 5; i++)
+			{
+				c ^= uint16_t(bytes[i] << 8);
+				for (int b = 0; b < 8; b++) c = uint16_t((c & 0x8000) ? (c << 1) ^ 0x1021 : (c << 1));
+			}
+			return c == 0xFFFF ? 0 : c;
+		}
+		bool Valid() const {return check == uint8_t(~key) && crc == CRC();}
+		bool Erased() const {return value == -1 && key == 0xFF && check == 0xFF && crc == 0xFFFF;}
+	};
+	static_assert(sizeof(Record) == recordSize, "FlashSettings record must be 8 bytes");
+
+	enum Stage {Idle, Erase, Copy, Header};
+
+	uint32_t offset;
+
+	// Latest settings, and those in the current sector
+	volatile int32_t values[NumKeys];
+	volatile bool present[NumKeys];
+	int32_t stored[NumKeys];
+	bool storedPresent[NumKeys];
+
+	uint32_t active;   // current sector, or noSector if none is valid
+	uint32_t seq;      // sequence number of current sector
+	uint32_t writePos; // offset of next record in current sector
+	bool full;         // no more records can be appended to the current sector
+
+	// Copy of every setting into a new sector, in progress
+	Stage stage;
+	uint32_t target, copyPos, copyCount;
+	uint8_t copyKeys[NumKeys];
+	int32_t copyValues[NumKeys];
+
+	void Clear()
+	{
+		for (unsigned k = 0; k < NumKeys; k++)
+		{
+			values[k] = stored[k] = 0;
+			present[k] = storedPresent[k] = false;
+		}
+		active = noSector;
+		seq = 0;
+		writePos = headerSize;
+		full = false;
+		stage = Idle;
+	}
+
+	bool Changed(unsigned k) const
+	{
+		return present[k] && (!storedPresent[k] || values[k] != stored[k]);
+	}
+
+	const uint8_t *Address(uint32_t sector, uint32_t pos) const
+	{
+		return (const uint8_t *)(XIP_BASE + offset + sector * FLASH_SECTOR_SIZE + pos);
+	}
+
+	// Append records of changed settings to the current sector, as many as fit in one page
+	void AppendPage()
+	{
+		uint8_t page[FLASH_PAGE_SIZE];
+		memset(page, 0xFF, sizeof(page));
+		uint32_t pageStart = writePos & ~(FLASH_PAGE_SIZE - 1);
+
+		uint8_t keys[FLASH_PAGE_SIZE / recordSize];
+		int32_t written[FLASH_PAGE_SIZE / recordSize];
+		unsigned n = 0;
+		uint32_t pos = writePos;
+		for (unsigned k = 0; k < NumKeys && pos + recordSize <= pageStart + FLASH_PAGE_SIZE; k++)
+		{
+			int32_t v = values[k];
+			if (!present[k] || (storedPresent[k] && v == stored[k])) continue;
+			Record r(uint8_t(k), v);
+			memcpy(page + pos - pageStart, &r, recordSize);
+			keys[n] = uint8_t(k);
+			written[n++] = v;
+			pos += recordSize;
+		}
+		FlashProgram(active, pageStart, page);
+
+		for (unsigned i = 0; i < n; i++)
+		{
+			stored[keys[i]] = written[i];
+			storedPresent[keys[i]] = true;
+		}
+		writePos = pos;
+		if (writePos + recordSize > FLASH_SECTOR_SIZE) full = true;
+	}
+
+	void FlashErase(uint32_t sector)
+	{
+		uint32_t irq = COMPUTERCARD_AUDIO_IN_RAM ? 0 : save_and_disable_interrupts();
+		flash_range_erase(offset + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+		if (!COMPUTERCARD_AUDIO_IN_RAM) restore_interrupts(irq);
+	}
+
+	// Program one page. Bytes left as 0xFF leave flash unchanged, so a page can be programmed several times.
+	void FlashProgram(uint32_t sector, uint32_t pos, const uint8_t *page)
+	{
+		uint32_t irq = COMPUTERCARD_AUDIO_IN_RAM ? 0 : save_and_disable_interrupts();
+		flash_range_program(offset + sector * FLASH_SECTOR_SIZE + pos, page, FLASH_PAGE_SIZE);
+		if (!COMPUTERCARD_AUDIO_IN_RAM) restore_interrupts(irq);
+	}
+};
+
+
+////////////////////////////////////////
+// Per-unit ADC calibration (see COMPUTERCARD_ADC_CALIBRATION)
+
+/** \brief Calibration of one unit's ADC: a correction for each of the 4096 ADC codes,
+	and the offset of each audio and CV input.
+
+	The RP2040 ADC has a few codes (around 512, 1536, 2560 and 3584) that each cover
+	several codes' worth of input voltage, so that readings jump by several steps there,
+	by amounts that vary from unit to unit. Build measures these from a histogram of
+	readings of an input swept slowly and evenly across its range (a code density test):
+	each code's share of the readings is its width. The correction for each code moves it
+	to where an ideal ADC would put it, counting only codes whose width differs from 1 by
+	more than a threshold, so that small random variations don't accumulate.
+	The corrections then only change at those few codes, so are kept as runs of codes
+	with the same correction: a few tens of bytes in the EEPROM, which Expand turns into
+	the 4096-entry table used by the audio interrupt.
+	On modelled units whose wide codes vary from 6 to 11 codes wide, the calibration takes
+	about 45 bytes and leaves an RMS error of about 0.5 codes, against about 1 code for the
+	fixed COMPUTERCARD_DNL_CORRECTION (host/adc_calibration_model.cpp).
+*/
+class ADCCalibration
+{
+public:
+	static constexpr unsigned numCodes = 4096;
+	static constexpr unsigned maxRuns = 64;
+	/// Largest size of the encoded calibration
+	static constexpr unsigned maxEncodedSize = 10 + 3 * maxRuns;
+
+	/// Offsets of Audio 1, Audio 2, CV 1 and CV 2, subtracted from AudioIn and CVIn values
+	int16_t offset[4];
+
+	ADCCalibration() {Clear();}
+
+	/// No corrections or offsets
+	void Clear()
+	{
+		for (int i = 0; i < 4; i++) offset[i] = 0;
+		runs[0] = {0, 0};
+		numRuns = 1;
+	}
+
+	/** \brief Set the code corrections from a histogram of readings (numCodes counts) of an input
+		swept evenly across the ADC's range. Codes not reached take the correction of the nearest
+		code that was. Code 2048 (~0V) is left uncorrected, so that offsets are unchanged.
+		Returns false, leaving the corrections unchanged, if the histogram covers less than half the
+		codes, has fewer than 16 readings per code, or would need more than maxRuns runs.
+	*/
+	bool Build(const uint32_t *histogram, float threshold = 0.25f)
+	{
+		// The codes at each end of the sweep are only partly covered, so are left out
+		unsigned lo = 0, hi = numCodes - 1;
+		while (lo < hi && !histogram[lo]) lo++;
+		while (hi > lo && !histogram[hi]) hi--;
+		lo++;
+		hi--;
+		if (hi < lo || hi - lo < numCodes / 2) return false;
+		uint64_t total = 0;
+		for (unsigned k = lo; k <= hi; k++) total += histogram[k];
+		float mean = float(total) / float(hi - lo + 1);
+		if (mean < 16) return false;
+
+		// Two passes: the first finds the correction of the reference code, the second makes the runs
+		unsigned ref = lo > numCodes / 2 ? lo : (hi < numCodes / 2 ? hi : numCodes / 2);
+		float refCorrection = 0;
+		Run newRuns[maxRuns];
+		unsigned n = 0;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			float excess = 0; // extra width of the codes below this one
+			for (unsigned k = lo; k <= hi; k++)
+			{
+				float width = float(histogram[k]) / mean;
+				if (width - 1 < threshold && 1 - width < threshold) width = 1;
+				float c = excess + (width - 1) / 2 - refCorrection;
+				excess += width - 1;
+				if (pass == 0)
+				{
+					if (k == ref) refCorrection = c;
+					continue;
+				}
+
+				int32_t ci = c >= 0 ? int32_t(c + 0.5f) : -int32_t(0.5f - c);
+				if (ci < -128) ci = -128;
+				if (ci > 127) ci = 127;
+				if (n == 0 || ci != newRuns[n - 1].correction)
+				{
+					if (n == maxRuns) return false;
+					newRuns[n] = {uint16_t(n == 0 ? 0 : k), int8_t(ci)};
+					n++;
+				}
+			}
+		}
+		for (unsigned i = 0; i < n; i++) runs[i] = newRuns[i];
+		numRuns = n;
+		return true;
+	}
+
+	/// Correction added to ADC readings of the given code
+	int Correction(unsigned code) const
+	{
+		unsigned i = numRuns - 1;
+		while (i > 0 && runs[i].start > code) i--;
+		return runs[i].correction;
+	}
+
+	/// Fill table with the correction for each of the numCodes codes, limited so that corrected codes stay within 0-4095
+	void Expand(int8_t *table) const
+	{
+		unsigned r = 0;
+		for (unsigned code = 0; code < numCodes; code++)
+		{
+			if (r + 1 < numRuns && runs[r + 1].start <= code) r++;
+			int32_t c = runs[r].correction;
+			if (int32_t(code) + c < 0) c = -int32_t(code);
+			if (int32_t(code) + c > int32_t(numCodes - 1)) c = int32_t(numCodes - 1 - code);
+			table[code] = int8_t(c);
+		}
+	}
+
+	/// Number of runs of codes with the same correction
+	unsigned NumRuns() const {return numRuns;}
+
+	/// Write into buf (at least EncodedSize() bytes), as stored in the EEPROM. Returns the number of bytes.
+	unsigned Encode(uint8_t *buf) const
+	{
+		unsigned p = 0;
+		buf[p++] = version;
+		buf[p++] = uint8_t(numRuns);
+		for (int i = 0; i < 4; i++)
+		{
+			buf[p++] = uint8_t(uint16_t(offset[i]) >> 8);
+			buf[p++] = uint8_t(offset[i]);
+		}
+		for (unsigned i = 0; i < numRuns; i++)
+		{
+			buf[p++] = uint8_t(runs[i].start >> 8);
+			buf[p++] = uint8_t(runs[i].start);
+			buf[p++] = uint8_t(runs[i].correction);
+		}
+		return p;
+	}
+
+	/// Size of the encoded calibration in bytes
+	unsigned EncodedSize() const {return 10 + 3 * numRuns;}
+
+	/// Read from buf, as written by Encode. Returns false, leaving this calibration cleared, if not valid.
+	bool Decode(const uint8_t *buf, unsigned length)
+	{
+		Clear();
+		if (length < 10 || buf[0] != version) return false;
+		unsigned n = buf[1];
+		if (n < 1 || n > maxRuns || length < 10 + 3 * n) return false;
+		for (unsigned i = 0; i < n; i++)
+		{
+			const uint8_t *r = buf + 10 + 3 * i;
+			runs[i] = {uint16_t((r[0] << 8) | r[1]), int8_t(r[2])};
+			bool ordered = i == 0 ? runs[i].start == 0 : (runs[i].start > runs[i - 1].start && runs[i].start < numCodes);
+			if (!ordered)
+			{
+				Clear();
+				return false;
+			}
+		}
+		numRuns = n;
+		for (int i = 0; i < 4; i++) offset[i] = int16_t((buf[2 + 2 * i] << 8) | buf[3 + 2 * i]);
+		return true;
+	}
+
+private:
+	static constexpr uint8_t version = 1;
+
+	struct Run
+	{
+		uint16_t start; // first code of the run
+		int8_t correction;
+	};
+	Run runs[maxRuns];
+	unsigned numRuns;
+};
+
+
+////////////////////////////////////////
+// Smoothing filters for knob, switch and CV inputs (see COMPUTERCARD_KNOB_FILTER etc.)
+// Each provides a Filter class, told the rate (Hz) at which its input is read by SetRate.
+
+/// No smoothing: inputs take the latest ADC reading
+struct NoSmoothing
+{
+	class Filter
+	{
+	public:
+		void SetRate(unsigned) {}
+		void Seed(int32_t x) {y = x;}
+		void __not_in_flash_func(Update)(int32_t x, unsigned) {y = x;}
+		int32_t Value() const {return y;}
+
+	private:
+		int32_t y;
+	};
+};
+
+/** \brief One-pole lowpass filter, with the given cutoff frequency
+
+	The filter state has only 4 fractional bits, so the output stops short of a
+	slowly-changing input by up to 128/k LSBs, acting as a simple form of hysteresis.
+	The defaults, OnePoleSmoothing<15> for knobs (k = 16) and OnePoleSmoothing<246>
+	for CV (k = 128), give the filters used before these were configurable.
+*/
+template <unsigned CutoffHz>
+struct OnePoleSmoothing
+{
+	class Filter
+	{
+	public:
+		Filter() : k(1), y(0) {}
+
+		void SetRate(unsigned updateHz)
+		{
+			// Coefficient 1-exp(-w), approximated as w/(1+w/2) = 2πfc/(fs+πfc), with 11 fractional bits
+			uint32_t num = 12868u * CutoffHz; // 2048 × 2π × fc
+			uint32_t den = updateHz + (CutoffHz * 355u) / 113u;
+			k = int32_t((num + den / 2) / den);
+			if (k < 1) k = 1;
+			if (k > 2047) k = 2047;
+		}
+
+		void Seed(int32_t x) {y = x << 4;}
+
+		/// Run the filter n times on reading x (0-4095)
+		void __not_in_flash_func(Update)(int32_t x, unsigned n)
+		{
+			for (unsigned i = 0; i < n; i++)
+			{
+				y = ((2048 - k) * y + k * (x << 4)) >> 11;
+			}
+		}
+
+		int32_t Value() const {return y >> 4;}
+
+	private:
+		int32_t k; // 11 fractional bits
+		int32_t y; // 4 fractional bits
+	};
+};
+
+/// One-pole lowpass filter, followed by hysteresis: the value only changes
+/// when the filter output moves more than Amount away from it.
+template <unsigned CutoffHz, unsigned Amount>
+struct OnePoleHysteresisSmoothing
+{
+	class Filter
+	{
+	public:
+		void SetRate(unsigned updateHz) {lowpass.SetRate(updateHz);}
+
+		void Seed(int32_t x)
+		{
+			lowpass.Seed(x);
+			held = x;
+		}
+
+		void __not_in_flash_func(Update)(int32_t x, unsigned n)
+		{
+			lowpass.Update(x, n);
+			int32_t v = lowpass.Value();
+			if (v > held + int32_t(Amount) || v < held - int32_t(Amount)) held = v;
+		}
+
+		int32_t Value() const {return held;}
+
+	private:
+		typename OnePoleSmoothing<CutoffHz>::Filter lowpass;
+		int32_t held;
+	};
+};
+
+
 class ComputerCard
 {
 	constexpr static int numLeds = 6;
@@ -44,8 +1392,132 @@ public:
 	enum HardwareVersion_t {Proto1=0x2a, Proto2_Rev1=0x30, Rev1_1=0x0C, Unknown=0xFF};
 	/// USB Power state
 	enum USBPowerState_t {DFP, UFP, Unsupported};
+	/// Audio sample rate, set when the card is constructed
+	enum SampleRate_t {Rate24kHz=24000, Rate32kHz=32000, Rate48kHz=48000, Rate96kHz=96000};
+
+	/// One sample of both audio channels, used by ProcessBlock
+	struct Frame
+	{
+		int16_t audio[2]; ///< Audio 1 and Audio 2 (values -2048 to 2047; outputs -32768 to 32767 with COMPUTERCARD_AUDIO_DITHER)
+	};
+
+	/// Event sent to OnEvent with PostEvent, such as a MIDI message. The meaning of the bytes is up to the card.
+	struct Event
+	{
+		uint8_t data[4];
+	};
+
+	/// Largest block size accepted by EnableBlockProcessing
+	static constexpr unsigned maxBlockSize = COMPUTERCARD_MAX_BLOCK_SIZE;
+	static_assert(maxBlockSize >= 1 && maxBlockSize <= 4096 && (maxBlockSize & (maxBlockSize - 1)) == 0,
+				  "COMPUTERCARD_MAX_BLOCK_SIZE must be a power of two, up to 4096");
+
+	/// Optional features compiled into this card, set by the COMPUTERCARD_* feature macros
+	struct Features
+	{
+		static constexpr bool normalisationProbe = COMPUTERCARD_NORMALISATION_PROBE;
+		static constexpr bool dnlCorrection = COMPUTERCARD_DNL_CORRECTION;
+		static constexpr bool adcCalibration = COMPUTERCARD_ADC_CALIBRATION;
+		static constexpr bool clampCVOutputs = COMPUTERCARD_CLAMP_CV_OUTPUTS;
+		static constexpr int preciseCVOrder = COMPUTERCARD_PRECISE_CV;
+		static constexpr bool preciseCV = preciseCVOrder > 0;
+		static constexpr int audioDitherMode = COMPUTERCARD_AUDIO_DITHER;
+		static constexpr bool audioDither = audioDitherMode > 0;
+		static constexpr bool audioDecimation = COMPUTERCARD_AUDIO_DECIMATION;
+		static constexpr bool audioInRAM = COMPUTERCARD_AUDIO_IN_RAM;
+		static constexpr bool piecewiseCalibration = COMPUTERCARD_PIECEWISE_CALIBRATION;
+		static constexpr bool audioBank = COMPUTERCARD_AUDIO_BANK;
+		static constexpr unsigned traceSize = COMPUTERCARD_TRACE_SIZE;
+
+		using MainKnobFilter = COMPUTERCARD_MAIN_KNOB_FILTER;
+		using XKnobFilter = COMPUTERCARD_X_KNOB_FILTER;
+		using YKnobFilter = COMPUTERCARD_Y_KNOB_FILTER;
+		using SwitchFilter = COMPUTERCARD_SWITCH_FILTER;
+		using CV1Filter = COMPUTERCARD_CV1_FILTER;
+		using CV2Filter = COMPUTERCARD_CV2_FILTER;
+	};
+
+	/// RAM available to a card on the RP2040, for checking its size at compile time (defined below)
+	struct MemoryBudget;
+
+	/** \brief Timing statistics for the audio interrupt, collected when EnableProfiler is used.
+
+		Times are in profiler ticks (by default, processor clock cycles).
+		The budget is the time between interrupts: one sample, or one block in block processing mode.
+		This struct does not depend on the hardware, so can be fed with times from any source.
+	*/
+	struct ProfileStats
+	{
+		static constexpr unsigned numBins = 16;
+
+		uint32_t count;       ///< Number of interrupts timed
+		uint32_t overruns;    ///< Number of interrupts that missed their deadline
+		uint32_t minTicks;    ///< Shortest interrupt
+		uint32_t maxTicks;    ///< Longest interrupt
+		uint64_t totalTicks;  ///< Sum of all interrupt times
+		uint32_t budgetTicks; ///< Time available for each interrupt
+		uint32_t histogram[numBins]; ///< Bin i counts interrupts taking i/16 to (i+1)/16 of the budget. The last bin also counts longer ones.
+
+		void Reset(uint32_t budget)
+		{
+			count = overruns = maxTicks = 0;
+			minTicks = 0xFFFFFFFF;
+			totalTicks = 0;
+			budgetTicks = budget ? budget : 1;
+			for (unsigned i = 0; i < numBins; i++) histogram[i] = 0;
+		}
+
+		void __not_in_flash_func(Record)(uint32_t ticks, bool overrun)
+		{
+			count++;
+			if (overrun || ticks > budgetTicks) overruns++;
+			if (ticks < minTicks) minTicks = ticks;
+			if (ticks > maxTicks) maxTicks = ticks;
+			totalTicks += ticks;
+			uint32_t bin = uint32_t((uint64_t(ticks) * numBins) / budgetTicks);
+			histogram[bin < numBins ? bin : numBins - 1]++;
+		}
+
+		uint32_t MeanTicks() const {return count ? uint32_t(totalTicks / count) : 0;}
+
+		/// Percentage of budget used by an interrupt taking the given time
+		uint32_t Percent(uint32_t ticks) const {return uint32_t((uint64_t(ticks) * 100) / budgetTicks);}
+	};
+
+	/** \brief Counts of audio interrupt overruns, returned by Diagnostics().
+
+		Kept in RAM that is not cleared at startup, so the totals survive a reset or watchdog reboot,
+		but not a power cycle. They can be saved to flash (e.g. with FlashSettings) to keep them longer.
+	*/
+	struct DiagnosticsRecord
+	{
+		uint32_t runs;        ///< Number of times Run() has been called since the record was cleared
+		uint32_t overruns;    ///< Audio interrupts that finished after the next was due, over all those runs
+		uint32_t resyncs;     ///< Times the ADC FIFO filled and the ADC was restarted, over all those runs
+		uint32_t runOverruns; ///< Overruns since Run() was last called
+		uint32_t runResyncs;  ///< Resyncs since Run() was last called
+	};
+
+	/** \brief RAM in use, returned by MemoryUsage().
+
+		All zero in the host build, whose memory is not the RP2040's.
+	*/
+	struct MemoryStats
+	{
+		uint32_t staticBytes;    ///< Initialised data and code in RAM (.data), and zero-initialised data (.bss)
+		uint32_t heapBytes;      ///< Heap in use (malloc, new)
+		uint32_t heapFreeBytes;  ///< Heap free, including RAM not yet taken by the heap
+		uint32_t stackBytes;     ///< Stack of the core that called Run()
+		uint32_t stackUsedBytes; ///< Deepest use of that stack since Run() was called, including the audio interrupt
+	};
 	
-	ComputerCard();
+	/** \brief Construct the card, running at the given audio sample rate.
+
+		Knob, switch and CV smoothing, and normalisation probe timing, follow the sample rate.
+		At 96kHz, each audio input is read once per sample rather than averaged over two readings,
+		and knobs, switch and CV are read at the same rate as at 48kHz.
+	*/
+	ComputerCard(SampleRate_t rate = Rate48kHz);
 
 	/** \brief Start audio processing.
 
@@ -55,17 +1527,179 @@ public:
 	void Run()
 	{
 		ComputerCard::thisptr = this;
+		sampleCount = 0;
 		AudioWorker();
 	}
 
-	/// Use before Run() to enable Connected/Disconnected detection
+	/// Use before Run() to enable Connected/Disconnected detection (no effect if COMPUTERCARD_NORMALISATION_PROBE is 0)
 	void EnableNormalisationProbe() {useNormProbe = true;}
 
+	/// Use before Run() to time every audio interrupt, for ProfilerStats, ProfilerLEDs and ProfilerReport
+	void EnableProfiler() {useProfiler = true;}
+
+	/** \brief Use before Run() to convert only the audio inputs, for cards that don't use knobs, switch or CV inputs.
+
+		Each audio input is then read four times per sample (twice at 96kHz) rather than twice (once),
+		and the knob mux stays still, so that its switching does not interfere with the audio inputs.
+		Knobs, switch and CV inputs are not read, and the normalisation probe only detects audio jacks.
+		Best combined with COMPUTERCARD_AUDIO_DECIMATION, which filters all the readings.
+	*/
+	void EnableAudioOnlyADC() {audioOnlyADC = true;}
+
+	/** \brief Use before Run() to call ProcessControl every n samples.
+
+		In block processing mode, ProcessControl is called every n samples rounded up to a whole number of blocks.
+		n = 0 (the default) disables ProcessControl.
+	*/
+	void EnableControlRate(unsigned n) {controlSamples = n;}
+
+	/** \brief Use before Run() to process audio in blocks of n samples, rather than one at a time.
+
+		ProcessBlock is then called every n samples, and knobs, switch, CV and pulse inputs
+		are updated once per block. Audio latency becomes two blocks (2n samples).
+		n = 1 (the default) disables block processing.
+	*/
+	void EnableBlockProcessing(unsigned n)
+	{
+		if (n < 1) n = 1;
+		if (n > maxBlockSize) n = maxBlockSize;
+		blockSize = n;
+	}
+
+	/** \brief Use before Run() to pass events sent with PostEvent to OnEvent, latency samples after they are sent.
+
+		The latency should be at least the longest time that the sending code may take between reading
+		SampleCount() and calling PostEvent, so that events arrive before they are due.
+	*/
+	void EnableEventQueue(unsigned latency) {eventLatency = latency; useEventQueue = true;}
+
+	/** \brief Send an event to OnEvent, to be applied on the sample latency samples from now (see EnableEventQueue).
+
+		For example, MIDI messages received by USB on the other core. Events sent at different times are then
+		applied the same number of samples after they are sent, without jitter from when the audio interrupt runs.
+		Only one core may send events. Returns false, dropping the event, if the queue is full
+		(COMPUTERCARD_EVENT_QUEUE_SIZE events) or EnableEventQueue has not been used.
+	*/
+	bool PostEvent(const Event &e) {return PostEvent(e, sampleCount + eventLatency);}
+
+	/// Send an event to OnEvent, to be applied on the sample with the given SampleCount() value.
+	/// Times must not decrease from one event to the next. An event that is already due is applied on the next sample.
+	bool PostEvent(const Event &e, uint32_t time)
+	{
+		return useEventQueue && eventQueue.Push(time, e);
+	}
+
+	/// Number of events applied after the sample they were due on
+	uint32_t LateEvents() {return lateEvents;}
+
+	/// Trace IDs used by ComputerCard itself (with COMPUTERCARD_TRACE_SIZE). A card's own IDs should start from TraceUser.
+	enum TraceId : uint16_t
+	{
+		TraceAudioInterrupt = 0, ///< Span of each audio interrupt, with the SampleCount at its start
+		TraceOverrun,            ///< Instant at the end of an interrupt that overran
+		TraceResync,             ///< Instant when the ADC was restarted after lost readings
+		TraceUser = 16
+	};
+
+	/** \brief Record the start of a span of time with the given ID, e.g. a loop on the second core, with an optional value.
+
+		Tracing functions may be called from the audio interrupt and either core, and do nothing
+		unless COMPUTERCARD_TRACE_SIZE is set. Each takes a few tens of cycles.
+	*/
+	static void __not_in_flash_func(TraceBegin)(uint16_t id, uint32_t value = 0) {trace.Write(Tracer::Begin, id, value);}
+
+	/// Record the end of a span started with TraceBegin on the same core
+	static void __not_in_flash_func(TraceEnd)(uint16_t id, uint32_t value = 0) {trace.Write(Tracer::End, id, value);}
+
+	/// Record a single moment, such as a USB packet arriving
+	static void __not_in_flash_func(TraceInstant)(uint16_t id, uint32_t value = 0) {trace.Write(Tracer::Instant, id, value);}
+
+	/// Record the value of a quantity that changes over time, such as a queue length, shown as a graph by the decoder
+	static void __not_in_flash_func(TraceCounter)(uint16_t id, uint32_t value) {trace.Write(Tracer::Counter, id, value);}
+
+	/// Name a trace ID (below 64) for the decoder. The string is not copied, so should be a literal.
+	static void TraceName(uint16_t id, const char *name) {trace.SetName(id, name);}
+
+	/** \brief Write out all trace records as text, one line at a time, to writeLine(const char *line).
+
+		For example, TraceDump([](const char *s) {fputs(s, stdout);}) over USB serial.
+		Recording pauses during the dump. Returns the number of records written.
+	*/
+	template <typename LineWriter>
+	static unsigned TraceDump(LineWriter &&writeLine) {return trace.Dump(writeLine);}
+
+	/// Discard all trace records, e.g. after a dump
+	static void TraceClear() {trace.Clear();}
+
 protected:
-	/// Callback, called once per sample at 48kHz
+	/** \brief Callback, called once per sample at the sample rate (48kHz by default).
+
+		Cards working only in ProcessBlock or the event callbacks override it with an empty function.
+	*/
 	virtual void ProcessSample() = 0;
 
+	/** \brief Callback, called once per block of n samples if EnableBlockProcessing has been used.
+
+		Reads audio inputs from in[0..n-1] and writes audio outputs to out[0..n-1].
+		The default implementation calls ProcessSample once for each frame.
+	*/
+	virtual void ProcessBlock(const Frame *in, Frame *out, size_t n);
+
+	/** \brief Callback, called every n samples if EnableControlRate(n) has been used, just before ProcessSample or ProcessBlock.
+
+		For calculations that need not be repeated every sample, such as filter coefficients set by knobs.
+		Use ControlPeriod() as the length of a LinearRamp to carry the results smoothly to each sample.
+		ProcessControl runs in the audio interrupt, so with ProcessSample must still finish within one sample.
+		To spread the load, it is moved one sample later if it would coincide with normalisation probe jack detection.
+	*/
+	virtual void ProcessControl() {}
+
+	/** \brief Callback, called repeatedly on the audio core, outside the audio interrupt.
+
+		For slow work that need not finish within one sample, such as FlashSettings::Commit.
+		It is interrupted by the audio interrupt (ProcessSample etc.) whenever that is due.
+	*/
+	virtual void Background() {}
+
+	/// Event callback, called when pulse input i (0 or 1) goes high
+	virtual void OnPulseRise(int) {}
+
+	/// Event callback, called when pulse input i (0 or 1) goes low
+	virtual void OnPulseFall(int) {}
+
+	/// Event callback, called when the switch moves, with its new position
+	virtual void OnSwitch(Switch) {}
+
+	/// Event callback, called when a jack is plugged into an input (needs EnableNormalisationProbe)
+	virtual void OnJackInserted(Input) {}
+
+	/// Event callback, called when a jack is removed from an input (needs EnableNormalisationProbe)
+	virtual void OnJackRemoved(Input) {}
+
+	/** \brief Event callback, called with each event sent by PostEvent (needs EnableEventQueue), on the sample it is due.
+
+		Called before ProcessSample for that sample, so e.g. a CV output set here changes on exactly that sample.
+		In block processing mode, events due at any sample in the block are applied at the start of the block.
+	*/
+	virtual void OnEvent(const Event &) {}
+
+	/** \brief Callback, called from the audio interrupt when it has overrun: taken so long that the next interrupt is already due.
+
+		A short overrun is absorbed, but if the interrupt falls so far behind that the ADC FIFO fills,
+		readings are lost and ComputerCard restarts the ADC (and in block mode the DAC) to realign the inputs,
+		causing a brief glitch. A card can use this callback to drop to a cheaper quality tier.
+		It should only set a flag or similar, as the interrupt is already late.
+	*/
+	virtual void OnOverrun() {}
+
+	/** \brief Number of samples since Run() was called, e.g. to timestamp events. Wraps around after about a day.
+
+		In block processing mode, this is the number of the first sample in the block.
+	*/
+	uint32_t __not_in_flash_func(SampleCount)() {return sampleCount;}
 
+	/// Samples between calls to ProcessControl (0 if EnableControlRate has not been used)
+	unsigned ControlPeriod() {return controlCalls * blockSize;}
 
 
 	/// Read knob position (returns 0-4095)
@@ -81,57 +1715,110 @@ protected:
 	/// Set Audio output (values -2048 to 2047)
 	void __not_in_flash_func(AudioOut)(int i, int16_t val)
 	{
-		dacOut[i] = val;
+		if constexpr (Features::audioDither)
+		{
+			if (val < -2048) val = -2048;
+			if (val > 2047) val = 2047;
+			dacOut[i] = int16_t(val * 16);
+		}
+		else
+		{
+			dacOut[i] = val;
+		}
 	}
 	
 	/// Set Audio 1 output (values -2048 to 2047)
-	void __not_in_flash_func(AudioOut1)(int16_t val)
-	{
-		dacOut[0] = val;
-	}
+	void __not_in_flash_func(AudioOut1)(int16_t val) {AudioOut(0, val);}
 	
 	/// Set Audio 2 output (values -2048 to 2047)
-	void __not_in_flash_func(AudioOut2)(int16_t val)
+	void __not_in_flash_func(AudioOut2)(int16_t val) {AudioOut(1, val);}
+
+	/** \brief Set Audio output with 16-bit resolution (values -32768 to 32767)
+
+		AudioOutPrecise(i, val<<4) gives the same output as AudioOut(i, val).
+		With COMPUTERCARD_AUDIO_DITHER set to 1 or 2, the value is reduced to the DAC's
+		12 bits with dither (see AudioDither), so that quiet signals are not distorted,
+		and the output frames of ProcessBlock take the same 16-bit values.
+		Otherwise, the lowest 4 bits are ignored.
+	*/
+	void __not_in_flash_func(AudioOutPrecise)(int i, int16_t val)
 	{
-		dacOut[1] = val;
+		if constexpr (Features::audioDither)
+		{
+			dacOut[i] = val;
+		}
+		else
+		{
+			dacOut[i] = int16_t(val >> 4);
+		}
 	}
 
 	
 	/// Set CV output (values -2048 to 2047)
 	void __not_in_flash_func(CVOut)(int i, int16_t val)
 	{
-		pwm_set_gpio_level(CV_OUT_1 - i, (2047-val)>>1);
+		if constexpr (Features::clampCVOutputs)
+		{
+			if (val < -2048) val = -2048;
+			if (val > 2047) val = 2047;
+		}
+		if constexpr (Features::preciseCV)
+		{
+			cvPrecise[i] = uint32_t(2047-val) << 7;
+		}
+		else
+		{
+			pwm_set_gpio_level(CV_OUT_1 - i, (2047-val)>>1);
+		}
 	}
 	
 	/// Set CV 1 output (values -2048 to 2047)
-	void __not_in_flash_func(CVOut1)(int16_t val)
-	{
-		pwm_set_gpio_level(CV_OUT_1, (2047-val)>>1);
-	}
+	void __not_in_flash_func(CVOut1)(int16_t val) {CVOut(0, val);}
 	
 	/// Set CV 2 output (values -2048 to 2047)
-	void __not_in_flash_func(CVOut2)(int16_t val)
+	void __not_in_flash_func(CVOut2)(int16_t val) {CVOut(1, val);}
+
+	/** \brief Set CV output with 19-bit resolution (values -262144 to 262143)
+
+		CVOutPrecise(i, val<<7) gives the same voltage as CVOut(i, val).
+		With COMPUTERCARD_PRECISE_CV set to 1 or 2, the 11-bit PWM level is varied at every
+		PWM period (~61kHz) so that, once smoothed by the output filter, its average has finer
+		resolution than the PWM: over 20 bits below 200Hz (see SigmaDeltaModulator).
+		Otherwise, the lowest 7 bits are ignored.
+	*/
+	void __not_in_flash_func(CVOutPrecise)(int i, int32_t val)
 	{
-		pwm_set_gpio_level(CV_OUT_2, (2047-val)>>1);
+		// Same scaling as CVOut: (2047-val)>>1 is the PWM level for 12-bit values
+		if (val < -262144) val = -262144;
+		if (val > (2047 << 7)) val = 2047 << 7;
+		if constexpr (Features::preciseCV)
+		{
+			cvPrecise[i] = uint32_t((2047 << 7) - val);
+		}
+		else
+		{
+			pwm_set_gpio_level(CV_OUT_1 - i, uint32_t((2047 << 7) - val) >> 8);
+		}
 	}
 
-	/// Set CV 1 output from calibrated MIDI note number (values 0 to 127)
+	/// Set CV output from calibrated MIDI note number (values 0 to 127)
 	void __not_in_flash_func(CVOutMIDINote)(int i, uint8_t noteNum)
 	{
-		pwm_set_gpio_level(CV_OUT_1 - i, MIDIToDac(noteNum, 0) >> 8);
+		if constexpr (Features::preciseCV)
+		{
+			cvPrecise[i] = MIDIToDac(noteNum, i);
+		}
+		else
+		{
+			pwm_set_gpio_level(CV_OUT_1 - i, MIDIToDac(noteNum, i) >> 8);
+		}
 	}
 	
 	/// Set CV 1 output from calibrated MIDI note number (values 0 to 127)
-	void __not_in_flash_func(CVOut1MIDINote)(uint8_t noteNum)
-	{
-		pwm_set_gpio_level(CV_OUT_1, MIDIToDac(noteNum, 0) >> 8);
-	}
+	void __not_in_flash_func(CVOut1MIDINote)(uint8_t noteNum) {CVOutMIDINote(0, noteNum);}
 	
 	/// Set CV 2 output from calibrated MIDI note number (values 0 to 127)
-	void __not_in_flash_func(CVOut2MIDINote)(uint8_t noteNum)
-	{
-		pwm_set_gpio_level(CV_OUT_2, MIDIToDac(noteNum, 1) >> 8);
-	}
+	void __not_in_flash_func(CVOut2MIDINote)(uint8_t noteNum) {CVOutMIDINote(1, noteNum);}
 	
 	/// Set Pulse output (true = on)
 	void __not_in_flash_func(PulseOut)(int i, bool val)
@@ -233,11 +1920,72 @@ protected:
 	/// Return hardware version
 	HardwareVersion_t HardwareVersion() {return hw;}
 
+	/// Audio sample rate in Hz, as passed to the constructor
+	uint32_t SampleRate() {return sampleRate;}
+
 	/// Return ID number unique to flash card
 	uint64_t UniqueCardID()	{return uniqueID;}
 	
 	static ComputerCard *ThisPtr() {return thisptr;}
 
+	/// Return a copy of the profiler statistics collected so far. May be called from either core.
+	ProfileStats ProfilerStats();
+
+	/// Clear profiler statistics, from the next audio interrupt onwards
+	void ResetProfiler() {profileResetRequest = true;}
+
+	/// Return a copy of the overrun counts, including those from before the last reset. May be called from either core.
+	DiagnosticsRecord Diagnostics();
+
+	/// Clear the overrun counts, including the totals from previous runs, from the next audio interrupt onwards
+	void ResetDiagnostics() {diagnosticsResetRequest = true;}
+
+	/// True if ADC readings are being corrected by a calibration (COMPUTERCARD_ADC_CALIBRATION only)
+	bool ADCCalibrated() {return useADCCalibration;}
+
+	/** \brief Correct ADC readings with the given calibration from the next audio interrupt, or with none if cal is nullptr.
+
+		Does not change the calibration stored in the EEPROM. Has no effect without COMPUTERCARD_ADC_CALIBRATION.
+		Readings in the audio interrupt running at the time may be corrected with a mixture of the old and new calibrations.
+	*/
+	void UseADCCalibration(const ADCCalibration *cal);
+
+	/** \brief Store cal in the EEPROM, to be read at startup, and use it (as UseADCCalibration).
+
+		Takes a few tens of milliseconds, so should be called outside the audio interrupt, e.g. from the other core.
+		Returns false if the EEPROM could not be written, or did not read back the same.
+	*/
+	bool SaveADCCalibration(const ADCCalibration &cal);
+
+	/** \brief Count raw ADC readings of an audio or CV input, before calibration, by adding 1 to histogram[reading]
+		for each (an array of ADCCalibration::numCodes counts), or stop counting if histogram is nullptr.
+
+		Audio inputs are counted once per sample, CV inputs each time they are read. For ADCCalibration::Build.
+		Has no effect without COMPUTERCARD_ADC_CALIBRATION.
+	*/
+	void CaptureADC(Input i, uint32_t *histogram)
+	{
+		adcCaptureHistogram = nullptr;
+		adcCaptureInput = i;
+		adcCaptureHistogram = histogram;
+	}
+
+	/** \brief Show profiler results on the LEDs.
+
+		LEDs 0-4 form a bar graph of the longest interrupt time, each LED representing 20% of the budget.
+		LED 5 lights if any interrupt has overrun.
+	*/
+	void ProfilerLEDs();
+
+	/// Write a one-line text summary of profiler statistics into buf, as snprintf
+	int ProfilerReport(char *buf, size_t len);
+
+	/// Return the RAM in use. May be called from either core.
+	MemoryStats MemoryUsage();
+
+	/// Write a one-line text summary of MemoryUsage() into buf, as snprintf
+	int MemoryReport(char *buf, size_t len);
+
 	
 	void Abort();
 	
@@ -261,20 +2009,38 @@ private:
 	uint8_t numCalibrationPoints[calMaxChannels];
 	CalPoint calibrationTable[calMaxChannels][calMaxPoints];
 	CalCoeffs calCoeffs[calMaxChannels];
+	uint32_t noteDac[calMaxChannels][128]; // CV output DAC setting (19-bit) for each MIDI note
 
 	uint64_t uniqueID;
 	
-	uint8_t ReadByteFromEEPROM(unsigned int eeAddress);
-	int ReadIntFromEEPROM(unsigned int eeAddress);
+	bool ReadEEPROMBlock(unsigned int eeAddress, uint8_t *buf, unsigned int length);
 	uint16_t CRCencode(const uint8_t *data, int length);
 	void CalcCalCoeffs(int channel);
+	void CalcNoteTable(int channel);
+	bool WriteEEPROMBlock(unsigned int eeAddress, const uint8_t *buf, unsigned int length);
 	int ReadEEPROM();
-	uint32_t MIDIToDac(int midiNote, int channel);
+	int ReadEEPROMCalibration();
+	int ReadEEPROMADCCalibration();
+
+	// ADC calibration (COMPUTERCARD_ADC_CALIBRATION only)
+	int8_t adcCorrection[Features::adcCalibration ? ADCCalibration::numCodes : 1]; // added to each ADC reading
+	int16_t adcOffset[4]; // Audio 1, Audio 2, CV 1, CV 2
+	volatile bool useADCCalibration;
+	uint32_t *volatile adcCaptureHistogram;
+	volatile Input adcCaptureInput;
+
+	uint32_t __not_in_flash_func(MIDIToDac)(int midiNote, int channel)
+	{
+		if (midiNote > 127) midiNote = 127;
+		return noteDac[channel][midiNote];
+	}
 	
 	HardwareVersion_t hw;
 	HardwareVersion_t ProbeHardwareVersion();
 	
-	int16_t dacOut[2];
+	int16_t dacOut[2]; // 16-bit with COMPUTERCARD_AUDIO_DITHER, otherwise 12-bit
+	AudioDither<Features::audioDitherMode> dacDither[2] = {AudioDither<Features::audioDitherMode>(1),
+														   AudioDither<Features::audioDitherMode>(0x9e3779b9)};
 	
 	volatile int32_t knobs[4] = { 0, 0, 0, 0 }; // 0-4095
 	volatile bool pulse[2] = { 0, 0 };
@@ -286,18 +2052,70 @@ private:
 
 	volatile int32_t plug_state[6] = {0,0,0,0,0,0};
 	volatile bool connected[6] = {0,0,0,0,0,0};
+	volatile uint32_t cvPrecise[2]; // CV output PWM levels, with 8 fractional bits (COMPUTERCARD_PRECISE_CV only)
+	SigmaDeltaModulator<Features::preciseCVOrder> cvModulator[2];
 	bool useNormProbe;
 
+	bool useProfiler;
+	volatile bool profileResetRequest;
+	volatile uint32_t profileSeq; // odd while the ISR is updating profile
+	ProfileStats profile;
+	uint32_t profileBudget;
+	void ProfiledBufferFull();
+
+	volatile bool diagnosticsResetRequest;
+	void RecordOverrun(bool resync);
+
+	unsigned blockSize; // samples per call to BufferFull
+
+	uint32_t sampleRate;
+	unsigned adcFrameWords;   // ADC readings per sample: 8 (two from each ADC input), or 4 at 96kHz
+	unsigned muxSamples;      // samples per step of the knob mux: 1, or 2 at 96kHz
+	unsigned normProbePeriod; // samples per normalisation probe bit (~333us)
+	bool audioOnlyADC;
+	uint32_t adcRoundRobin;   // ADC inputs converted in turn
+	unsigned controlSamples;  // requested ProcessControl period
+	unsigned controlCalls;    // BufferFull calls per ProcessControl call, 0 for none
+	unsigned audioStride;     // words between readings of each audio input: 4, or 2 with audio-only ADC
+	AudioDecimator audioDecimator[2]; // COMPUTERCARD_AUDIO_DECIMATION only
+
+	// Smoothing filters on knobs/switch and CV, with coefficients set by AudioWorker for the sample rate
+	Features::MainKnobFilter::Filter mainKnobFilter;
+	Features::XKnobFilter::Filter xKnobFilter;
+	Features::YKnobFilter::Filter yKnobFilter;
+	Features::SwitchFilter::Filter switchFilter;
+	Features::CV1Filter::Filter cv1Filter;
+	Features::CV2Filter::Filter cv2Filter;
+	Frame blockIn[maxBlockSize], blockOut[maxBlockSize];
+
 	Switch switchVal, lastSwitchVal;
+	volatile uint32_t sampleCount;
+
+	bool useEventQueue;
+	unsigned eventLatency; // samples from PostEvent to OnEvent
+	volatile uint32_t lateEvents;
+	TimedQueue<Event, COMPUTERCARD_EVENT_QUEUE_SIZE> eventQueue;
 	
 	volatile uint8_t runADCMode;
 
 
 // Buffers that DMA reads into / out of
-	uint16_t ADC_Buffer[2][8];
-	uint16_t SPI_Buffer[2][2];
+	// Static, so that they can be placed with COMPUTERCARD_AUDIO_DATA wherever the card object is
+	static uint16_t ADC_Buffer[2][8*maxBlockSize];
+	// Aligned to its size, so that in block mode the DAC channels' read addresses can wrap within it
+	static constexpr unsigned spiBufferBytes = 2 * 2 * maxBlockSize * sizeof(uint16_t);
+	alignas(spiBufferBytes) static uint16_t SPI_Buffer[2][2*maxBlockSize];
+	// With COMPUTERCARD_PRECISE_CV, a ring of CV output PWM levels (both outputs in each word, as the PWM's
+	// CC register), which DMA writes to the PWM at each of its wraps. It holds the levels of two blocks at
+	// the lowest sample rate, with room to spare, and is aligned to its size so that DMA reads wrap within it.
+	static constexpr unsigned cvLevelsSize = Features::preciseCV ? (8 * maxBlockSize > 16 ? 8 * maxBlockSize : 16) : 1;
+	static_assert(!Features::preciseCV || maxBlockSize <= 512, "COMPUTERCARD_PRECISE_CV needs COMPUTERCARD_MAX_BLOCK_SIZE of 512 or less");
+	alignas(cvLevelsSize * sizeof(uint32_t)) static uint32_t CV_Levels[cvLevelsSize];
 
 	uint8_t adc_dma, spi_dma; // DMA ids
+	uint8_t spi_dma_b, spi_timer; // Second SPI DMA and pacing timer, used in block mode
+	uint8_t cv_dma; // CV output DMA, with COMPUTERCARD_PRECISE_CV
+	uint32_t cvWrite, cvLead; // next entry of CV_Levels to write, and entries to keep ahead of the DMA
 
 
 
@@ -312,16 +2130,72 @@ private:
 	}
 	uint32_t next_norm_probe();
 
+	void StartBlockDAC(uint8_t phase);
+	void StopBlockDAC();
+	void RestartADC();
+	void StartCVDMA();
+	void FillCVLevels();
 	void BufferFull();
 
 	void AudioWorker();
 	
 	static void AudioCallback()
 	{
-		thisptr->BufferFull();
+		TraceBegin(TraceAudioInterrupt, thisptr->sampleCount);
+		if (thisptr->useProfiler)
+			thisptr->ProfiledBufferFull();
+		else
+			thisptr->BufferFull();
+		TraceEnd(TraceAudioInterrupt);
 	}
 	static ComputerCard *thisptr;
 
+	using Tracer = TraceBuffer<COMPUTERCARD_TRACE_SIZE>;
+	static Tracer trace;
+
+};
+
+/** \brief RAM available to a card on the RP2040, for checking the size of its data at compile time.
+
+	Main RAM is SRAM0-3 (256kB), or SRAM0-2 (192kB) with COMPUTERCARD_AUDIO_BANK, when SRAM3 holds
+	.data, code run from RAM and data placed with COMPUTERCARD_AUDIO_DATA. In each, ComputerCard's own
+	static buffers and COMPUTERCARD_RAM_RESERVE are kept back, and the rest is the card's: its card object,
+	which includes ComputerCard's members, and its other static data and heap. For example, after a card's class:
+
+		static_assert(ComputerCard::MemoryBudget::Fits(sizeof(MyCard) + sizeof(sampleMemory)), "MyCard needs too much RAM");
+
+	A card object taking much of stackBytes should be static, rather than a local variable in main(): the stack
+	of core 0 is only stackBytes, and grows unchecked into other RAM (see README).
+*/
+struct ComputerCard::MemoryBudget
+{
+	static constexpr uint32_t ramBytes = Features::audioBank ? 192 * 1024 : 256 * 1024; ///< Main RAM
+	static constexpr uint32_t audioBankBytes = Features::audioBank ? 64 * 1024 : 0;  ///< SRAM3, with COMPUTERCARD_AUDIO_BANK
+	static constexpr uint32_t stackBytes = 4 * 1024; ///< Stack of each core, in SRAM5 (core 0) and SRAM4 (core 1)
+	static constexpr uint32_t reserveBytes = COMPUTERCARD_RAM_RESERVE;
+
+	/// ComputerCard's static buffers in main RAM, and in SRAM3: DMA buffers, trace records, and the diagnostics
+	/// record with its magic number and check word
+	static constexpr uint32_t dmaBytes = sizeof(ADC_Buffer) + sizeof(SPI_Buffer) + (Features::preciseCV ? sizeof(CV_Levels) : 0);
+	static constexpr uint32_t computerCardBytes =
+		(Features::audioBank ? 0 : dmaBytes) + sizeof(Tracer) + sizeof(DiagnosticsRecord) + 8;
+	static constexpr uint32_t audioBankComputerCardBytes = Features::audioBank ? dmaBytes : 0;
+
+	/// Main RAM for the card's own data
+	static constexpr uint32_t cardBytes = ramBytes - reserveBytes - computerCardBytes;
+
+	/// SRAM3 for data placed with COMPUTERCARD_AUDIO_DATA, or 0 without COMPUTERCARD_AUDIO_BANK
+	static constexpr uint32_t audioDataBytes =
+		Features::audioBank ? audioBankBytes - reserveBytes - audioBankComputerCardBytes : 0;
+
+	/// True if data of the given size fits in the main RAM left for the card
+	static constexpr bool Fits(uint32_t bytes) {return bytes <= cardBytes;}
+
+	/// Main RAM left for the card after data of the given size, or 0 if it does not fit
+	static constexpr uint32_t Headroom(uint32_t bytes) {return Fits(bytes) ? cardBytes - bytes : 0;}
+
+	/// True if data of the given size, placed with COMPUTERCARD_AUDIO_DATA, fits in SRAM3
+	static constexpr bool FitsAudioBank(uint32_t bytes) {return bytes <= audioDataBytes;}
 };
 
 
@@ -331,10 +2205,14 @@ private:
 #include "hardware/adc.h"
 #include "hardware/clocks.h"
 #include "hardware/dma.h"
-#include "hardware/flash.h"
 #include "hardware/i2c.h"
 #include "hardware/irq.h"
 #include "hardware/spi.h"
+#ifdef COMPUTERCARD_PROFILER_SYSTICK
+#include "hardware/structs/systick.h"
+#endif
+
+#include <cstdio>
 
 // Input normalisation probe pin
 #define NORMALISATION_PROBE 4
@@ -388,10 +2266,40 @@ private:
 #define EEPROM_NUM_BYTES 88
 
 #define EEPROM_PAGE_ADDRESS 0x50
+#define EEPROM_WRITE_PAGE_BYTES 16
+
+// ADC calibration (COMPUTERCARD_ADC_CALIBRATION), in the EEPROM after the CV output calibration:
+// ID (2 bytes), length of the encoded ADCCalibration (2 bytes), the ADCCalibration, CRC (2 bytes)
+#define EEPROM_ADC_CAL_ADDR 256
+#define EEPROM_ADC_CAL_ID 2002
 
 
 
 ComputerCard *ComputerCard::thisptr;
+ComputerCard::Tracer ComputerCard::trace;
+
+// Overrun counts, in RAM that is not cleared at startup, so that they survive a reset.
+// Valid only if the magic number and check word match, e.g. not after power-on.
+static struct
+{
+	uint32_t magic;
+	ComputerCard::DiagnosticsRecord record;
+	uint32_t check;
+} __uninitialized_ram(computercard_diagnostics);
+
+static constexpr uint32_t diagnosticsMagic = 0xD1A60C05;
+
+static uint32_t __not_in_flash_func(DiagnosticsCheck)(const ComputerCard::DiagnosticsRecord &r)
+{
+	uint32_t words[] = {r.runs, r.overruns, r.resyncs, r.runOverruns, r.runResyncs};
+	uint32_t h = 2166136261u; // FNV-1a, over words
+	for (uint32_t w : words) h = (h ^ w) * 16777619u;
+	return h;
+}
+
+uint16_t ComputerCard::ADC_Buffer[2][8*ComputerCard::maxBlockSize] COMPUTERCARD_AUDIO_DATA;
+uint16_t ComputerCard::SPI_Buffer[2][2*ComputerCard::maxBlockSize] COMPUTERCARD_AUDIO_DATA;
+uint32_t ComputerCard::CV_Levels[ComputerCard::cvLevelsSize] COMPUTERCARD_AUDIO_DATA;
 
 // Return pseudo-random bit for normalisation probe
 uint32_t __not_in_flash_func(ComputerCard::next_norm_probe)()
@@ -401,21 +2309,76 @@ uint32_t __not_in_flash_func(ComputerCard::next_norm_probe)()
 	return lcg_seed >> 31;
 }
 
+#if !PICO_NO_HARDWARE
+#include <malloc.h>
+#include <unistd.h>
+
+// Set by the linker script (memmap_default.ld in the Pico SDK, or memmap_audio_bank.ld)
+extern "C" char __data_start__[], __data_end__[], __bss_start__[], __bss_end__[], __HeapLimit[];
+extern "C" char __StackTop[], __StackBottom[], __StackOneTop[], __StackOneBottom[];
+
+// Stack of the core that called Run(), and the lowest address in use when it was called.
+// The rest of the stack, below that, is filled with stackPaint, so that MemoryUsage can find how deep it has since grown.
+static uint32_t *computercard_stackBottom, *computercard_stackTop, *computercard_stackLowest;
+static constexpr uint32_t stackPaint = 0x5A5AC0DE;
+#endif
+
+static void __attribute__((noinline)) PaintStack()
+{
+#if !PICO_NO_HARDWARE
+	bool core1 = get_core_num() == 1;
+	uint32_t here;
+	uint32_t *lowest = &here - 16; // below this function's own frame
+	uint32_t *bottom = reinterpret_cast<uint32_t *>(core1 ? __StackOneBottom : __StackBottom);
+	for (uint32_t *p = bottom; p < lowest; p++) *p = stackPaint;
+	computercard_stackBottom = bottom;
+	computercard_stackTop = reinterpret_cast<uint32_t *>(core1 ? __StackOneTop : __StackTop);
+	computercard_stackLowest = lowest;
+#endif
+}
+
 // Main audio core function
 void __not_in_flash_func(ComputerCard::AudioWorker)()
 {
+	// For MemoryUsage: mark the stack not yet used
+	PaintStack();
+
+	// ProcessControl every controlSamples samples, in whole blocks
+	controlCalls = (controlSamples + blockSize - 1) / blockSize;
+
+	// Start a new run in the diagnostics record
+	DiagnosticsRecord &diag = computercard_diagnostics.record;
+	diag.runs++;
+	diag.runOverruns = diag.runResyncs = 0;
+	computercard_diagnostics.check = DiagnosticsCheck(diag);
+
+	// Convert all four inputs in turn, or only the two audio inputs
+	adcRoundRobin = audioOnlyADC ? 0b0000011U : 0b0001111U;
+	audioStride = audioOnlyADC ? 2 : 4;
+	audioDecimator[0].SetFactor(adcFrameWords / audioStride);
+	audioDecimator[1].SetFactor(adcFrameWords / audioStride);
 
 	adc_select_input(0);
-	adc_set_round_robin(0b0001111U);
+	adc_set_round_robin(adcRoundRobin);
 
 	// enabled, with DMA request when FIFO contains data, no erro flag, no byte shift
 	adc_fifo_setup(true, true, 1, false, false);
 
 
-	// ADC clock runs at 48MHz
-	// 48MHz ÷ (124+1) = 384kHz ADC sample rate
-	//                 = 8×48kHz audio sample rate
-	adc_set_clkdiv(124);
+	// ADC clock runs at 48MHz, and takes adcFrameWords readings per audio sample
+	// e.g. 48MHz ÷ (124+1) = 384kHz ADC sample rate
+	//                      = 8×48kHz audio sample rate
+	// 96kHz uses 4×96kHz = 384kHz, as 8×96kHz would exceed the ADC's 500kHz maximum
+	adc_set_clkdiv(48000000.0f / float(adcFrameWords * sampleRate) - 1.0f);
+
+	// Each knob is read every 4 mux steps, and each CV every 2
+	uint32_t muxRate = sampleRate / muxSamples;
+	mainKnobFilter.SetRate(muxRate / 4);
+	xKnobFilter.SetRate(muxRate / 4);
+	yKnobFilter.SetRate(muxRate / 4);
+	switchFilter.SetRate(muxRate / 4);
+	cv1Filter.SetRate(muxRate / 2);
+	cv2Filter.SetRate(muxRate / 2);
 
 	// claim and setup DMAs for reading to ADC, and writing to SPI DAC
 	adc_dma = dma_claim_unused_channel(true);
@@ -433,80 +2396,412 @@ void __not_in_flash_func(ComputerCard::AudioWorker)()
 	// Synchronise ADC DMA the ADC samples
 	channel_config_set_dreq(&adc_dmacfg, DREQ_ADC);
 
-	// Setup DMA for 8 ADC samples
-	dma_channel_configure(adc_dma, &adc_dmacfg, ADC_Buffer[dmaPhase], &adc_hw->fifo, 8, true);
+	// Setup DMA for adcFrameWords ADC samples per audio sample
+	dma_channel_configure(adc_dma, &adc_dmacfg, ADC_Buffer[dmaPhase], &adc_hw->fifo, adcFrameWords * blockSize, true);
+
+	// Turn on IRQ for ADC DMA
+	dma_channel_set_irq0_enabled(adc_dma, true);
+
+	// Call buffer_full ISR when ADC DMA finished
+	irq_set_enabled(DMA_IRQ_0, true);
+	irq_set_exclusive_handler(DMA_IRQ_0, ComputerCard::AudioCallback);
+
+
+
+	// Set up DMA for SPI
+	spi_dmacfg = dma_channel_get_default_config(spi_dma);
+	channel_config_set_transfer_data_size(&spi_dmacfg, DMA_SIZE_16);
+
+	if (blockSize == 1)
+	{
+		// SPI DMA timed to SPI TX
+		channel_config_set_dreq(&spi_dmacfg, SPI_DREQ);
+
+		// Set up DMA to transmit 2 samples to SPI
+		dma_channel_configure(spi_dma, &spi_dmacfg, &spi_get_hw(SPI_PORT)->dr, NULL, 2, false);
+	}
+	else
+	{
+		// In block mode, a whole block of DAC words can't be sent at the SPI rate.
+		// Instead, DAC writes are paced by a DMA timer at 2× sample rate (one word per channel per sample),
+		// and two chained DMA channels alternate between the two halves of SPI_Buffer.
+		spi_dma_b = dma_claim_unused_channel(true);
+		spi_timer = dma_claim_unused_timer(true);
+
+		// Timer rate is sys_clk × num/den, so reduce (2× sample rate)/sys_clk to lowest terms
+		uint32_t sys_hz = clock_get_hz(clk_sys);
+		uint32_t dacWordRate = 2 * sampleRate;
+		uint32_t a = sys_hz, b = dacWordRate;
+		while (b)
+		{
+			uint32_t t = a % b;
+			a = b;
+			b = t;
+		}
+		// The timer's numerator and denominator are 16 bits. Any other rate would drift against the ADC,
+		// until the DAC read each half of SPI_Buffer while it was being written.
+		if (sys_hz / a > 0xFFFF)
+			panic("ComputerCard: block mode can't pace the DAC at %lu words/s from a %lu Hz system clock",
+				  (unsigned long)dacWordRate, (unsigned long)sys_hz);
+		dma_timer_set_fraction(spi_timer, dacWordRate / a, sys_hz / a);
+		channel_config_set_dreq(&spi_dmacfg, dma_get_timer_dreq(spi_timer));
+
+		// Each channel's read address wraps within SPI_Buffer, so that if an interrupt is so late that the
+		// other channel chains back to this one before it is rewound, it reads stale samples from SPI_Buffer
+		// rather than whatever follows it in RAM. The interrupt's resync then restarts the DAC in step.
+		channel_config_set_ring(&spi_dmacfg, false, __builtin_ctz(spiBufferBytes));
+
+		dma_channel_config spi_dmacfg_b = spi_dmacfg;
+		channel_config_set_chain_to(&spi_dmacfg, spi_dma_b);
+		channel_config_set_chain_to(&spi_dmacfg_b, spi_dma);
+		dma_channel_configure(spi_dma, &spi_dmacfg, &spi_get_hw(SPI_PORT)->dr, SPI_Buffer[0], 2 * blockSize, false);
+		dma_channel_configure(spi_dma_b, &spi_dmacfg_b, &spi_get_hw(SPI_PORT)->dr, SPI_Buffer[1], 2 * blockSize, false);
+
+		// Output 0V until the first processed block arrives
+		for (unsigned i = 0; i < blockSize; i++)
+		{
+			SPI_Buffer[0][2*i] = SPI_Buffer[1][2*i] = dacval(0, DAC_CHANNEL_A);
+			SPI_Buffer[0][2*i+1] = SPI_Buffer[1][2*i+1] = dacval(0, DAC_CHANNEL_B);
+		}
+
+		// Start DAC output alongside the ADC
+		StartBlockDAC(dmaPhase);
+	}
+
+	// Profiler budget is the time between interrupts: one sample, or one block
+	if (useProfiler)
+	{
+#ifdef COMPUTERCARD_PROFILER_SYSTICK
+		systick_hw->rvr = 0x00FFFFFF;
+		systick_hw->csr = 0x5; // enable, counting processor clock
+#endif
+		profileBudget = uint32_t((uint64_t(COMPUTERCARD_PROFILER_TICK_HZ) * blockSize) / sampleRate);
+		profile.Reset(profileBudget);
+	}
+
+	if constexpr (Features::preciseCV) StartCVDMA();
+
+	adc_run(true);
+
+	while (1)
+	{
+		// If ready to restart
+		if (runADCMode == RUN_ADC_MODE_REQUEST_ADC_RESTART)
+		{
+			runADCMode = RUN_ADC_MODE_RUNNING;
+
+			dma_hw->ints0 = 1u << adc_dma; // reset adc interrupt flag
+			dma_channel_set_write_addr(adc_dma, ADC_Buffer[dmaPhase], true); // start writing into new buffer
+			if (blockSize == 1)
+			{
+				dma_channel_set_read_addr(spi_dma, SPI_Buffer[dmaPhase], true); // start reading from new buffer
+			}
+			else
+			{
+				StartBlockDAC(dmaPhase);
+			}
+
+			RestartADC();
+		}
+		else if (runADCMode == RUN_ADC_MODE_ADC_STOPPED)
+		{
+			break;
+		}
+
+		Background();
+		tight_loop_contents();
+	}
+}
+
+void ComputerCard::Abort()
+{
+	runADCMode = RUN_ADC_MODE_REQUEST_ADC_STOP;
+}
+
+// In block mode, (re)start the chain of DAC DMA transfers from the given half of SPI_Buffer
+void __not_in_flash_func(ComputerCard::StartBlockDAC)(uint8_t phase)
+{
+	hw_write_masked(&dma_hw->ch[spi_dma].al1_ctrl, spi_dma_b << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB, DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS);
+	hw_write_masked(&dma_hw->ch[spi_dma_b].al1_ctrl, spi_dma << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB, DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS);
+	dma_channel_set_read_addr(spi_dma_b, SPI_Buffer[1], false);
+	dma_channel_set_read_addr(spi_dma, SPI_Buffer[0], false);
+	dma_channel_start(phase ? spi_dma_b : spi_dma);
+}
+
+// In block mode, stop the chain of DAC DMA transfers
+void __not_in_flash_func(ComputerCard::StopBlockDAC)()
+{
+	// Unchain the two DAC channels first, so that aborting one can't trigger the other
+	hw_write_masked(&dma_hw->ch[spi_dma].al1_ctrl, spi_dma << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB, DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS);
+	hw_write_masked(&dma_hw->ch[spi_dma_b].al1_ctrl, spi_dma_b << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB, DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS);
+	dma_channel_abort(spi_dma);
+	dma_channel_abort(spi_dma_b);
+}
+
+// Start ADC conversions, from the first input of a frame
+void __not_in_flash_func(ComputerCard::RestartADC)()
+{
+	adc_set_round_robin(0);
+	adc_select_input(0);
+	adc_set_round_robin(adcRoundRobin);
+	adc_run(true);
+}
+
+// With COMPUTERCARD_PRECISE_CV, start DMA of CV output levels to the PWM, one at each PWM wrap
+void ComputerCard::StartCVDMA()
+{
+	uint slice = pwm_gpio_to_slice_num(CV_OUT_1);
+	cv_dma = dma_claim_unused_channel(true);
+
+	// Levels to keep queued: those of one call to BufferFull, at ~61kHz, and one more
+	uint64_t pwmPeriod = uint64_t(pwm_hw->slice[slice].top + 1) * sampleRate;
+	uint32_t wrapsPerCall = uint32_t((uint64_t(clock_get_hz(clk_sys)) * blockSize + pwmPeriod - 1) / pwmPeriod);
+	cvLead = wrapsPerCall + 1;
+	if (2 * cvLead > cvLevelsSize)
+		panic("ComputerCard: %lu CV output PWM wraps per interrupt don't fit in CV_Levels", (unsigned long)wrapsPerCall);
+
+	// Reading round CV_Levels, paced by the PWM wrap, and transferring for as long as possible
+	// (2^32 wraps, about 19 hours at 125MHz, after which FillCVLevels restarts it)
+	dma_channel_config cfg = dma_channel_get_default_config(cv_dma);
+	channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+	channel_config_set_read_increment(&cfg, true);
+	channel_config_set_write_increment(&cfg, false);
+	channel_config_set_ring(&cfg, false, __builtin_ctz(sizeof(CV_Levels)));
+	channel_config_set_dreq(&cfg, pwm_get_dreq(slice));
+	dma_channel_configure(cv_dma, &cfg, &pwm_hw->slice[slice].cc, CV_Levels, 0xFFFFFFFF, false);
+
+	cvWrite = 0;
+	FillCVLevels();
+}
+
+// Queue CV output levels ahead of the DMA, running the sigma-delta modulator once per PWM wrap,
+// so that every level is output for the same time, as the modulator's noise shaping assumes
+void __not_in_flash_func(ComputerCard::FillCVLevels)()
+{
+	uint32_t read = uint32_t(dma_hw->ch[cv_dma].read_addr - uintptr_t(CV_Levels)) / sizeof(uint32_t);
+	uint32_t queued = (cvWrite - read) & (cvLevelsSize - 1);
+
+	// After an interrupt so late that the DMA has overtaken the queued levels, start again from the DMA
+	if (queued > cvLead)
+	{
+		cvWrite = read;
+		queued = 0;
+	}
+
+	for (; queued < cvLead; queued++)
+	{
+		uint32_t cc = 0;
+		for (int i = 0; i < 2; i++)
+		{
+			cc |= uint32_t(cvModulator[i].Next(cvPrecise[i])) << (16 * pwm_gpio_to_channel(CV_OUT_1 - i));
+		}
+		CV_Levels[cvWrite] = cc;
+		cvWrite = (cvWrite + 1) & (cvLevelsSize - 1);
+	}
 
-	// Turn on IRQ for ADC DMA
-	dma_channel_set_irq0_enabled(adc_dma, true);
+	if (!dma_channel_is_busy(cv_dma)) dma_channel_set_trans_count(cv_dma, 0xFFFFFFFF, true);
+}
 
-	// Call buffer_full ISR when ADC DMA finished
-	irq_set_enabled(DMA_IRQ_0, true);
-	irq_set_exclusive_handler(DMA_IRQ_0, ComputerCard::AudioCallback);
+// Default block callback: run ProcessSample on each frame in turn
+void __not_in_flash_func(ComputerCard::ProcessBlock)(const Frame *in, Frame *out, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		adcInL = in[i].audio[0];
+		adcInR = in[i].audio[1];
 
+		ProcessSample();
 
+		out[i].audio[0] = dacOut[0];
+		out[i].audio[1] = dacOut[1];
 
-	// Set up DMA for SPI
-	spi_dmacfg = dma_channel_get_default_config(spi_dma);
-	channel_config_set_transfer_data_size(&spi_dmacfg, DMA_SIZE_16);
+		// Pulse and switch are only read once per block,
+		// so report edges and changes on the first frame only
+		last_pulse[0] = pulse[0];
+		last_pulse[1] = pulse[1];
+		lastSwitchVal = switchVal;
+	}
+}
 
-	// SPI DMA timed to SPI TX
-	channel_config_set_dreq(&spi_dmacfg, SPI_DREQ);
+	  
 
-	// Set up DMA to transmit 2 samples to SPI
-	dma_channel_configure(spi_dma, &spi_dmacfg, &spi_get_hw(SPI_PORT)->dr, NULL, 2, false);
+// Count an overrun, or a resync of the ADC, in the persistent diagnostics record
+void __not_in_flash_func(ComputerCard::RecordOverrun)(bool resync)
+{
+	DiagnosticsRecord &r = computercard_diagnostics.record;
+	if (resync)
+	{
+		r.resyncs++;
+		r.runResyncs++;
+	}
+	else
+	{
+		r.overruns++;
+		r.runOverruns++;
+	}
+	computercard_diagnostics.check = DiagnosticsCheck(r);
+}
 
-	adc_run(true);
+ComputerCard::DiagnosticsRecord ComputerCard::Diagnostics()
+{
+	// Updated only by the audio interrupt, so re-read if it changes during the copy
+	DiagnosticsRecord copy;
+	do
+	{
+		copy = computercard_diagnostics.record;
+		__dmb();
+	} while (computercard_diagnostics.check != DiagnosticsCheck(copy));
+	return copy;
+}
 
-	while (1)
+ComputerCard::MemoryStats ComputerCard::MemoryUsage()
+{
+	MemoryStats m = {};
+#if !PICO_NO_HARDWARE
+	m.staticBytes = uint32_t((__data_end__ - __data_start__) + (__bss_end__ - __bss_start__));
+	struct mallinfo mi = mallinfo();
+	m.heapBytes = uint32_t(mi.uordblks);
+	m.heapFreeBytes = uint32_t(__HeapLimit - static_cast<char *>(sbrk(0))) + uint32_t(mi.fordblks);
+	if (computercard_stackTop)
 	{
-		// If ready to restart
-		if (runADCMode == RUN_ADC_MODE_REQUEST_ADC_RESTART)
-		{
-			runADCMode = RUN_ADC_MODE_RUNNING;
+		// The deepest word no longer holding stackPaint, or, if the stack had already outgrown its space
+		// (e.g. by holding a large card object) when Run() was called, the lowest address in use then
+		uint32_t *deepest = computercard_stackBottom;
+		while (deepest < computercard_stackLowest && *deepest == stackPaint) deepest++;
+		if (computercard_stackLowest < deepest) deepest = computercard_stackLowest;
+		m.stackBytes = uint32_t(computercard_stackTop - computercard_stackBottom) * 4;
+		m.stackUsedBytes = uint32_t(computercard_stackTop - deepest) * 4;
+	}
+#endif
+	return m;
+}
 
-			dma_hw->ints0 = 1u << adc_dma; // reset adc interrupt flag
-			dma_channel_set_write_addr(adc_dma, ADC_Buffer[dmaPhase], true); // start writing into new buffer
-			dma_channel_set_read_addr(spi_dma, SPI_Buffer[dmaPhase], true); // start reading from new buffer
+int ComputerCard::MemoryReport(char *buf, size_t len)
+{
+	MemoryStats m = MemoryUsage();
+	return snprintf(buf, len, "static=%luB heap=%luB heapfree=%luB stack=%lu/%luB%s", (unsigned long)m.staticBytes,
+					(unsigned long)m.heapBytes, (unsigned long)m.heapFreeBytes, (unsigned long)m.stackUsedBytes,
+					(unsigned long)m.stackBytes, m.stackBytes && m.stackUsedBytes >= m.stackBytes ? " (overflowed)" : "");
+}
 
-			adc_set_round_robin(0);
-			adc_select_input(0);
-			adc_set_round_robin(0b0001111U);
-			adc_run(true);
-		}
-		else if (runADCMode == RUN_ADC_MODE_ADC_STOPPED)
-		{
-			break;
-		}
-		   
+// Audio ISR, with BufferFull timed for the profiler
+void __not_in_flash_func(ComputerCard::ProfiledBufferFull)()
+{
+	uint32_t start = COMPUTERCARD_PROFILER_TICKS();
+	BufferFull();
+	uint32_t ticks = (COMPUTERCARD_PROFILER_TICKS() - start) & COMPUTERCARD_PROFILER_TICK_MASK;
+
+	// If the ADC DMA has completed again already, the next interrupt is late
+	bool overrun = dma_hw->ints0 & (1u << adc_dma);
 
+	// Sequence count is odd during the update, so ProfilerStats can detect a torn copy
+	profileSeq = profileSeq + 1;
+	__dmb();
+	if (profileResetRequest)
+	{
+		profile.Reset(profileBudget);
+		profileResetRequest = false;
 	}
+	profile.Record(ticks, overrun);
+	__dmb();
+	profileSeq = profileSeq + 1;
 }
 
-void ComputerCard::Abort()
+ComputerCard::ProfileStats ComputerCard::ProfilerStats()
 {
-	runADCMode = RUN_ADC_MODE_REQUEST_ADC_STOP;
+	ProfileStats copy;
+	uint32_t seq;
+	do
+	{
+		seq = profileSeq;
+		__dmb();
+		copy = profile;
+		__dmb();
+	} while ((seq & 1) || seq != profileSeq);
+	return copy;
 }
 
-	  
+void ComputerCard::ProfilerLEDs()
+{
+	ProfileStats st = ProfilerStats();
+	uint32_t percent = st.count ? st.Percent(st.maxTicks) : 0;
+	for (int i = 0; i < 5; i++)
+	{
+		LedOn(i, percent > uint32_t(20 * i));
+	}
+	LedOn(5, st.overruns > 0);
+}
+
+int ComputerCard::ProfilerReport(char *buf, size_t len)
+{
+	ProfileStats st = ProfilerStats();
+
+	// Times printed in microseconds, to one decimal place
+	uint64_t hz = COMPUTERCARD_PROFILER_TICK_HZ;
+	auto tenthsUs = [hz](uint32_t ticks) {return (unsigned long)((uint64_t(ticks) * 10000000) / hz);};
+	unsigned long tmin = tenthsUs(st.count ? st.minTicks : 0), tmean = tenthsUs(st.MeanTicks());
+	unsigned long tmax = tenthsUs(st.maxTicks), tbudget = tenthsUs(st.budgetTicks);
+
+	int n = snprintf(buf, len, "n=%lu min=%lu.%luus mean=%lu.%luus max=%lu.%luus (%lu%% of %lu.%luus) overruns=%lu hist=",
+					 (unsigned long)st.count, tmin / 10, tmin % 10, tmean / 10, tmean % 10, tmax / 10, tmax % 10,
+					 (unsigned long)st.Percent(st.maxTicks), tbudget / 10, tbudget % 10, (unsigned long)st.overruns);
+	for (unsigned i = 0; i < ProfileStats::numBins && n >= 0; i++)
+	{
+		size_t used = size_t(n) < len ? size_t(n) : len;
+		n += snprintf(buf + used, len - used, i ? ",%lu" : "%lu", (unsigned long)st.histogram[i]);
+	}
+	return n;
+}
 
-// Per-audio-sample ISR, called when two sets of ADC samples have been collected from all four inputs
+// Per-audio-sample ISR, called when one frame of ADC samples (two sets from all four inputs,
+// or one set at 96kHz) has been collected
+// (or, in block mode, once per block, when blockSize such frames have been collected)
 void __not_in_flash_func(ComputerCard::BufferFull)()
 {
-	static int startupCounter = 8; // Decreases by 1 each sample, can do startup things when nonzero.
+	static int startupCounter = 8; // Decreases by 1 each mux step (each sample below 96kHz), can do startup things when nonzero.
 	static int mux_state = 0;
-	static int norm_probe_count = 0;
-
-	// Internal variables for IIR filters on knobs/cv
-	static volatile int32_t knobssm[4] = { 0, 0, 0, 0 };
-	static volatile int32_t cvsm[2] = { 0, 0 };
+	static unsigned mux_count = 0;
+	static unsigned norm_probe_count = 0;
+	static unsigned control_count = 0;
+	static bool control_due = false;
+	bool busy = false; // doing occasional work that ProcessControl should avoid
+
+	// Filter a new reading. At startup, filters are set straight to the reading, rather than rising from zero.
+	// In block mode, the filter is run once per sample in the block, to keep the same cutoff.
+	auto smooth = [&](auto &filter, int32_t x)
+	{
+		if (startupCounter) filter.Seed(x);
+		else filter.Update(x, blockSize);
+		return filter.Value();
+	};
 	__attribute__((unused)) static int np = 0, np1 = 0, np2 = 0;
+	uint8_t jackChanges = 0; // bit set for each input whose Connected state has changed
 
 	adc_select_input(0);
 
-	// Advance external mux to next state
-	int next_mux_state = (mux_state + 1) & 0x3;
-	gpio_put(MX_A, next_mux_state & 1);
-	gpio_put(MX_B, next_mux_state & 2);
+	// Advance external mux to next state, every muxSamples calls.
+	// Knobs and CV are only read on these calls, from a frame sampled entirely with the mux in mux_state.
+	// With the audio-only ADC, the mux is left still, and never read.
+	bool muxStep = (++mux_count >= muxSamples);
+	if (muxStep) mux_count = 0;
+	bool readMux = muxStep && !audioOnlyADC;
+	int next_mux_state = muxStep ? ((mux_state + 1) & 0x3) : mux_state;
+	if (!audioOnlyADC)
+	{
+		gpio_put(MX_A, next_mux_state & 1);
+		gpio_put(MX_B, next_mux_state & 2);
+	}
+
+	// If this interrupt is so late that the ADC FIFO has filled while no DMA transfer was running,
+	// readings have been lost, and the next buffer would not start at the first input of a frame.
+	// Stop the ADC and empty the FIFO, to restart it in step with the new buffer below.
+	// (The buffer about to be processed was complete, so is unaffected.)
+	bool resync = adc_fifo_get_level() >= 4;
+	if (resync)
+	{
+		adc_run(false);
+		adc_fifo_drain();
+	}
 
 	// Set up new writes into next buffer
 	uint8_t cpuPhase = dmaPhase;
@@ -514,28 +2809,125 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 
 	dma_hw->ints0 = 1u << adc_dma; // reset adc interrupt flag
 	dma_channel_set_write_addr(adc_dma, ADC_Buffer[dmaPhase], true); // start writing into new buffer
-	dma_channel_set_read_addr(spi_dma, SPI_Buffer[dmaPhase], true); // start reading from new buffer
+	if (blockSize == 1)
+	{
+		dma_channel_set_read_addr(spi_dma, SPI_Buffer[dmaPhase], true); // start reading from new buffer
+	}
+	else
+	{
+		// The DAC DMA channel for this half of SPI_Buffer has just finished.
+		// Rewind it, ready for when the other channel chains back to it.
+		dma_channel_set_read_addr(cpuPhase ? spi_dma_b : spi_dma, SPI_Buffer[cpuPhase], false);
+	}
+
+	if (resync)
+	{
+		// In block mode, also restart the DAC, so that outputs stay a fixed time after inputs
+		if (blockSize > 1)
+		{
+			StopBlockDAC();
+			StartBlockDAC(dmaPhase);
+		}
+		RestartADC();
+		RecordOverrun(true);
+		TraceInstant(TraceResync);
+	}
+
+	////////////////////////////////////////
+	// Per-unit ADC calibration: count raw readings for CaptureADC, then correct every reading in the buffer
+
+	if constexpr (Features::adcCalibration)
+	{
+		uint16_t *buf = ADC_Buffer[cpuPhase];
+		if (uint32_t *histogram = adcCaptureHistogram)
+		{
+			Input ci = adcCaptureInput;
+			if (ci == Audio1 || ci == Audio2)
+			{
+				// Last reading of the input in each frame
+				unsigned w = adcFrameWords - audioStride + (ci == Audio1 ? 1 : 0);
+				for (unsigned i = 0; i < blockSize; i++) histogram[buf[adcFrameWords * i + w] & 0xFFF]++;
+			}
+			else if (readMux && (mux_state % 2) == (ci == CV2 ? 1 : 0))
+			{
+				histogram[buf[adcFrameWords * (blockSize - 1) + 3] & 0xFFF]++;
+			}
+		}
+		if (useADCCalibration)
+		{
+			for (unsigned i = 0; i < adcFrameWords * blockSize; i++)
+			{
+				uint16_t code = buf[i] & 0xFFF;
+				buf[i] = uint16_t(code + adcCorrection[code]);
+			}
+		}
+	}
 
 	////////////////////////////////////////
 	// Collect various inputs and put them in variables for the DSP
 
-	// Set CV inputs, with ~240Hz LPF on CV input
+	// Knobs, switch and CV come from the last frame in the buffer:
+	// words 0-3 are audio R, audio L, knob/switch, CV, repeated in words 4-7 for 8-word frames.
+	// With the audio-only ADC, frames are audio R, audio L, repeated.
+	uint16_t *adc = ADC_Buffer[cpuPhase] + adcFrameWords * (blockSize - 1);
+	uint16_t *lastSet = adc + adcFrameWords - 4; // last conversion of each input
+	unsigned lastAudio = adcFrameWords - audioStride; // offset of the last conversion of each audio input
+
+	// Set CV inputs, by default with ~250Hz LPF
 	int cvi = mux_state % 2;
 
-	// Attempted compensation of ADC DNL errors. Not really tested.
-	uint16_t adc512=ADC_Buffer[cpuPhase][3]+512;
-	if (!(adc512 % 0x01FF)) ADC_Buffer[cpuPhase][3] += 4;
-	ADC_Buffer[cpuPhase][3] += (adc512>>10) << 3;
-	
-	cvsm[cvi] = (15 * (cvsm[cvi]) + 16 * ADC_Buffer[cpuPhase][3]) >> 4;
-	cv[cvi] = 2048 - (cvsm[cvi] >> 4);
+	if (readMux)
+	{
+		// Attempted compensation of ADC DNL errors. Not really tested.
+		// A per-unit calibration (COMPUTERCARD_ADC_CALIBRATION) replaces this.
+		if (Features::dnlCorrection && !(Features::adcCalibration && useADCCalibration))
+		{
+			uint16_t adc512=adc[3]+512;
+			if (!(adc512 % 0x01FF)) adc[3] += 4;
+			adc[3] += (adc512>>10) << 3;
+		}
+
+		if (cvi == 0) cv[0] = 2048 - smooth(cv1Filter, adc[3]);
+		else cv[1] = 2048 - smooth(cv2Filter, adc[3]);
+		if (Features::adcCalibration && useADCCalibration) cv[cvi] = cv[cvi] - adcOffset[2 + cvi];
+	}
 
 
-	// Set audio inputs, by averaging the two samples collected.
+	// Set audio inputs, by averaging the first and last samples collected (or doubling the one sample at 96kHz),
+	// or with COMPUTERCARD_AUDIO_DECIMATION, by filtering all of them.
 	// Invert to counteract inverting op-amp input configuration
-	adcInR = -(((ADC_Buffer[cpuPhase][0] + ADC_Buffer[cpuPhase][4]) - 0x1000) >> 1);
+	auto audioIn = [&](const uint16_t *frame, int w) -> int16_t
+	{
+		int32_t x;
+		if constexpr (Features::audioDecimation)
+		{
+			x = 0x800 - ((audioDecimator[w].Next(frame + w, audioStride, adcFrameWords / audioStride) + 8) >> 4);
+			x = x < -2047 ? -2047 : (x > 2048 ? 2048 : x);
+		}
+		else
+		{
+			x = -(((frame[w] + frame[w + lastAudio]) - 0x1000) >> 1);
+		}
+		// Word 0 is audio 2, word 1 audio 1
+		if (Features::adcCalibration && useADCCalibration) x -= adcOffset[1 - w];
+		return int16_t(x);
+	};
 
-	adcInL = -(((ADC_Buffer[cpuPhase][1] + ADC_Buffer[cpuPhase][5]) - 0x1000) >> 1);
+	if (blockSize == 1)
+	{
+		adcInR = audioIn(adc, 0);
+
+		adcInL = audioIn(adc, 1);
+	}
+	else
+	{
+		for (unsigned i = 0; i < blockSize; i++)
+		{
+			uint16_t *frame = ADC_Buffer[cpuPhase] + adcFrameWords * i;
+			blockIn[i].audio[0] = audioIn(frame, 1);
+			blockIn[i].audio[1] = audioIn(frame, 0);
+		}
+	}
 
 	// Set pulse inputs
 	last_pulse[0] = pulse[0];
@@ -543,10 +2935,17 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 	pulse[0] = !gpio_get(PULSE_1_INPUT);
 	pulse[1] = !gpio_get(PULSE_2_INPUT);
 
-	// Set knobs, with ~60Hz LPF
-	int knob = mux_state;
-	knobssm[knob] = (127 * (knobssm[knob]) + 16 * ADC_Buffer[cpuPhase][6]) >> 7;
-	knobs[knob] = knobssm[knob] >> 4;
+	// Set knobs, by default with ~15Hz LPF
+	if (readMux)
+	{
+		switch (mux_state)
+		{
+		case 0: knobs[0] = smooth(mainKnobFilter, lastSet[2]); break;
+		case 1: knobs[1] = smooth(xKnobFilter, lastSet[2]); break;
+		case 2: knobs[2] = smooth(yKnobFilter, lastSet[2]); break;
+		default: knobs[3] = smooth(switchFilter, lastSet[2]); break;
+		}
+	}
 
 	// Set switch value
 	switchVal = static_cast<Switch>((knobs[3]>1000) + (knobs[3]>3000));
@@ -554,13 +2953,13 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 	{
 		// Don't detect switch changes in first few cycles
 		lastSwitchVal = switchVal;
-		// Should initialise knob and CV smoothing filters here too
 	}
 	
 	////////////////////////////
 	// Normalisation probe
+	// (in block mode, this runs once per block, so detection takes blockSize times longer)
 
-	if (useNormProbe)
+	if (Features::normalisationProbe && useNormProbe)
 	{
 		// Set normalisation probe output value
 		// and update np to the expected history string
@@ -571,23 +2970,27 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 			np = (np<<1)+(normprobe&0x1);
 		}
 
-		// CV sampled at 24kHz comes in over two successive samples
-		if (norm_probe_count == 14 || norm_probe_count == 15)
+		// CV1 and CV2 are read on alternate mux steps, so come in over the last two steps of the cycle
+		if (readMux && norm_probe_count >= normProbePeriod - 2 * muxSamples)
 		{
-			plug_state[2+cvi] = (plug_state[2+cvi]<<1)+(ADC_Buffer[cpuPhase][3]<1800);
+			plug_state[2+cvi] = (plug_state[2+cvi]<<1)+(adc[3]<1800);
 		}
 
-		// Audio and pulse measured every sample at 48kHz
-		if (norm_probe_count == 15)
+		// Audio and pulse measured every sample
+		if (norm_probe_count == normProbePeriod - 1)
 		{
-			plug_state[Input::Audio1] = (plug_state[Input::Audio1]<<1)+(ADC_Buffer[cpuPhase][5]<1800);
-			plug_state[Input::Audio2] = (plug_state[Input::Audio2]<<1)+(ADC_Buffer[cpuPhase][4]<1800);
+			busy = true;
+			plug_state[Input::Audio1] = (plug_state[Input::Audio1]<<1)+(adc[1 + lastAudio]<1800);
+			plug_state[Input::Audio2] = (plug_state[Input::Audio2]<<1)+(adc[lastAudio]<1800);
 			plug_state[Input::Pulse1] = (plug_state[Input::Pulse1]<<1)+(pulse[0]);
 			plug_state[Input::Pulse2] = (plug_state[Input::Pulse2]<<1)+(pulse[1]);
 
 			for (int i=0; i<6; i++)
 			{
-				connected[i] = (np != plug_state[i]);
+				// (CV inputs aren't read by the audio-only ADC, so are never detected)
+				bool c = (np != plug_state[i]) && !(audioOnlyADC && (i == Input::CV1 || i == Input::CV2));
+				if (c != connected[i]) jackChanges |= 1u << i;
+				connected[i] = c;
 			}
 		}
 		
@@ -598,21 +3001,126 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 		if (Disconnected(Input::CV2)) cv[1] = 0;
 		if (Disconnected(Input::Pulse1)) pulse[0] = 0;
 		if (Disconnected(Input::Pulse2)) pulse[1] = 0;
+
+		if (blockSize > 1)
+		{
+			for (unsigned i = 0; i < blockSize; i++)
+			{
+				if (Disconnected(Input::Audio1)) blockIn[i].audio[0] = 0;
+				if (Disconnected(Input::Audio2)) blockIn[i].audio[1] = 0;
+			}
+		}
 	}
 	
+	////////////////////////////
+	// Events, called only when an input changes, before the DSP so that they can affect it
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (pulse[i] != last_pulse[i])
+		{
+			if (pulse[i]) OnPulseRise(i);
+			else OnPulseFall(i);
+		}
+	}
+	if (switchVal != lastSwitchVal) OnSwitch(switchVal);
+	if (jackChanges)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (!(jackChanges & (1u << i))) continue;
+			if (connected[i]) OnJackInserted(static_cast<Input>(i));
+			else OnJackRemoved(static_cast<Input>(i));
+		}
+	}
+	if (useEventQueue)
+	{
+		// Block processing applies everything due during the block at its start
+		Event e;
+		uint32_t due;
+		while (eventQueue.PopDue(sampleCount + blockSize - 1, e, &due))
+		{
+			if (int32_t(due - sampleCount) < 0) lateEvents = lateEvents + 1;
+			OnEvent(e);
+		}
+	}
+
 	////////////////////////////////////////
-	// Run the DSP
-	ProcessSample();
+	// Control-rate processing, every controlCalls calls, delayed by one call if this one is busy
+
+	if (controlCalls)
+	{
+		if (control_count == 0) control_due = true;
+		if (++control_count >= controlCalls) control_count = 0;
+		if (control_due && !busy)
+		{
+			control_due = false;
+			ProcessControl();
+		}
+	}
 
 	////////////////////////////////////////
-	// Collect DSP outputs and put them in the DAC SPI buffer
-	// CV/Pulse outputs are done immediately in ProcessSample
+	// Run the DSP, then collect DSP outputs and put them in the DAC SPI buffer
+	// CV/Pulse outputs are done immediately in ProcessSample/ProcessBlock
 
 	// Invert dacout to counteract inverting output configuration
-	SPI_Buffer[cpuPhase][0] = dacval(-dacOut[0], DAC_CHANNEL_A);
-	SPI_Buffer[cpuPhase][1] = dacval(-dacOut[1], DAC_CHANNEL_B);
+	if (blockSize == 1)
+	{
+		ProcessSample();
+
+		if constexpr (Features::audioDither)
+		{
+			SPI_Buffer[cpuPhase][0] = dacval(dacDither[0].Next(-dacOut[0]), DAC_CHANNEL_A);
+			SPI_Buffer[cpuPhase][1] = dacval(dacDither[1].Next(-dacOut[1]), DAC_CHANNEL_B);
+		}
+		else
+		{
+			SPI_Buffer[cpuPhase][0] = dacval(-dacOut[0], DAC_CHANNEL_A);
+			SPI_Buffer[cpuPhase][1] = dacval(-dacOut[1], DAC_CHANNEL_B);
+		}
+	}
+	else
+	{
+		ProcessBlock(blockIn, blockOut, blockSize);
+
+		for (unsigned i = 0; i < blockSize; i++)
+		{
+			if constexpr (Features::audioDither)
+			{
+				SPI_Buffer[cpuPhase][2*i] = dacval(dacDither[0].Next(-blockOut[i].audio[0]), DAC_CHANNEL_A);
+				SPI_Buffer[cpuPhase][2*i+1] = dacval(dacDither[1].Next(-blockOut[i].audio[1]), DAC_CHANNEL_B);
+			}
+			else
+			{
+				SPI_Buffer[cpuPhase][2*i] = dacval(-blockOut[i].audio[0], DAC_CHANNEL_A);
+				SPI_Buffer[cpuPhase][2*i+1] = dacval(-blockOut[i].audio[1], DAC_CHANNEL_B);
+			}
+		}
+	}
+
+	if constexpr (Features::preciseCV)
+	{
+		// Sigma-delta modulation, so that the average PWM level has the fractional part of the requested level
+		FillCVLevels();
+	}
 
 	mux_state = next_mux_state;
+	sampleCount = sampleCount + blockSize;
+
+	if (diagnosticsResetRequest)
+	{
+		computercard_diagnostics.record = DiagnosticsRecord{1, 0, 0, 0, 0};
+		computercard_diagnostics.check = DiagnosticsCheck(computercard_diagnostics.record);
+		diagnosticsResetRequest = false;
+	}
+
+	// If the ADC DMA has completed again already, this interrupt has overrun
+	if (dma_hw->ints0 & (1u << adc_dma))
+	{
+		RecordOverrun(false);
+		TraceInstant(TraceOverrun, sampleCount);
+		OnOverrun();
+	}
 
 	// If Abort called, stop ADC and DMA
 	if (runADCMode == RUN_ADC_MODE_REQUEST_ADC_STOP)
@@ -623,17 +3131,29 @@ void __not_in_flash_func(ComputerCard::BufferFull)()
 
 		dma_hw->ints0 = 1u << adc_dma; // reset adc interrupt flag
 		dma_channel_cleanup(adc_dma);
+		if (blockSize > 1)
+		{
+			StopBlockDAC();
+			dma_channel_cleanup(spi_dma_b);
+			dma_channel_unclaim(spi_dma_b);
+			dma_timer_unclaim(spi_timer);
+		}
 		dma_channel_cleanup(spi_dma);
+		if constexpr (Features::preciseCV)
+		{
+			dma_channel_cleanup(cv_dma);
+			dma_channel_unclaim(cv_dma);
+		}
 		irq_remove_handler(DMA_IRQ_0, ComputerCard::AudioCallback);
 		
 		runADCMode = RUN_ADC_MODE_ADC_STOPPED;
 	}
 
-	norm_probe_count = (norm_probe_count + 1) & 0xF;
+	if (++norm_probe_count >= normProbePeriod) norm_probe_count = 0;
 
 	lastSwitchVal = switchVal;
 	
-	if (startupCounter) startupCounter--;
+	if (startupCounter && muxStep) startupCounter--;
 }
 
 ComputerCard::HardwareVersion_t ComputerCard::ProbeHardwareVersion()
@@ -675,20 +3195,64 @@ ComputerCard::HardwareVersion_t ComputerCard::ProbeHardwareVersion()
 	}
 }
 
-ComputerCard::ComputerCard()
+ComputerCard::ComputerCard(SampleRate_t rate)
 {
-		
+	// Set here as well as in Run, so that a second core launched from a card's constructor can use ThisPtr()
+	thisptr = this;
+
 	runADCMode = RUN_ADC_MODE_RUNNING;
 
+	sampleRate = rate;
+	adcFrameWords = (rate > Rate48kHz) ? 4 : 8;
+	muxSamples = (rate > Rate48kHz) ? 2 : 1;
+	normProbePeriod = (16 * rate) / Rate48kHz; // 8, 10, 16 or 32 samples
+
 	adc_run(false);
 	adc_select_input(0);
 
 
 	useNormProbe = false;
+	blockSize = 1;
+	sampleCount = 0;
+	useProfiler = false;
+	audioOnlyADC = false;
+	audioStride = 4;
+	controlSamples = 0;
+	controlCalls = 0;
+	useEventQueue = false;
+	eventLatency = 0;
+	lateEvents = 0;
+	profileResetRequest = false;
+	diagnosticsResetRequest = false;
+	TraceName(TraceAudioInterrupt, "audio interrupt");
+	TraceName(TraceOverrun, "overrun");
+	TraceName(TraceResync, "ADC resync");
+
+	// Clear the diagnostics record if it did not survive the reset (e.g. at power-on)
+	if (computercard_diagnostics.magic != diagnosticsMagic
+		|| computercard_diagnostics.check != DiagnosticsCheck(computercard_diagnostics.record))
+	{
+		computercard_diagnostics.magic = diagnosticsMagic;
+		computercard_diagnostics.record = DiagnosticsRecord{0, 0, 0, 0, 0};
+		computercard_diagnostics.check = DiagnosticsCheck(computercard_diagnostics.record);
+	}
+	profileSeq = 0;
+	profile.Reset(1);
 	for (int i=0; i<6; i++)
 	{
 		connected[i] = false;
 	}
+	for (int i=0; i<2; i++)
+	{
+		cvPrecise[i] = 2047 << 7; // 0V, as CVOut(i, 0)
+	}
+	useADCCalibration = false;
+	adcCaptureHistogram = nullptr;
+	adcCaptureInput = Audio1;
+	for (int i=0; i<4; i++)
+	{
+		adcOffset[i] = 0;
+	}
 
 	
 	// Initialize PWM for LEDs, in pairs due pinout and PWM hardware
@@ -771,7 +3335,7 @@ ComputerCard::ComputerCard()
 	gpio_set_function(DAC_CS, GPIO_FUNC_SPI);
 
 	// Setup I2C for EEPROM
-	i2c_init(i2c0, 100 * 1000);
+	i2c_init(i2c0, COMPUTERCARD_EEPROM_I2C_HZ);
 	gpio_set_function(EEPROM_SDA, GPIO_FUNC_I2C);
 	gpio_set_function(EEPROM_SCL, GPIO_FUNC_I2C);
 
@@ -823,25 +3387,16 @@ ComputerCard::ComputerCard()
 
 
 
-// Read a byte from EEPROM
-uint8_t ComputerCard::ReadByteFromEEPROM(unsigned int eeAddress)
+// Read bytes from EEPROM in a single sequential read, which the EEPROM
+// continues from one address to the next. Returns false if the EEPROM does not respond.
+bool ComputerCard::ReadEEPROMBlock(unsigned int eeAddress, uint8_t *buf, unsigned int length)
 {
 	uint8_t deviceAddress = EEPROM_PAGE_ADDRESS | ((eeAddress >> 8) & 0x0F);
-	uint8_t data = 0xFF;
 
 	uint8_t addr_low_byte = eeAddress & 0xFF;
-	i2c_write_blocking(i2c0, deviceAddress, &addr_low_byte, 1, false);
-
-	i2c_read_blocking(i2c0, deviceAddress, &data, 1, false);
-	return data;
-}
+	if (i2c_write_blocking(i2c0, deviceAddress, &addr_low_byte, 1, false) != 1) return false;
 
-// Read a 16-bit integer from EEPROM
-int ComputerCard::ReadIntFromEEPROM(unsigned int eeAddress)
-{
-	uint8_t highByte = ReadByteFromEEPROM(eeAddress);
-	uint8_t lowByte = ReadByteFromEEPROM(eeAddress + 1);
-	return (highByte << 8) | lowByte;
+	return i2c_read_blocking(i2c0, deviceAddress, buf, length, false) == int(length);
 }
 
 uint16_t ComputerCard::CRCencode(const uint8_t *data, int length)
@@ -884,16 +3439,131 @@ int ComputerCard::ReadEEPROM()
 	calibrationTable[1][2].voltage = 20; // +2V
 	calibrationTable[1][2].dacSetting = 174400;
 
-	if (ReadIntFromEEPROM(EEPROM_ADDR_ID) != EEPROM_VAL_ID)
+	numCalibrationPoints[0] = numCalibrationPoints[1] = 3;
+
+	int result = ReadEEPROMCalibration();
+	for (int channel = 0; channel < calMaxChannels; channel++)
+	{
+		CalcCalCoeffs(channel);
+		CalcNoteTable(channel);
+	}
+	if constexpr (Features::adcCalibration)
+	{
+		ReadEEPROMADCCalibration();
+	}
+	return result;
+}
+
+// Use the ADC calibration in the EEPROM, if valid
+int ComputerCard::ReadEEPROMADCCalibration()
+{
+	uint8_t buf[6 + ADCCalibration::maxEncodedSize];
+	if (!ReadEEPROMBlock(EEPROM_ADC_CAL_ADDR, buf, 4))
+	{
+		return 1;
+	}
+	unsigned length = (buf[2] << 8) | buf[3];
+	if (((buf[0] << 8) | buf[1]) != EEPROM_ADC_CAL_ID || length > ADCCalibration::maxEncodedSize)
+	{
+		return 1;
+	}
+
+	if (!ReadEEPROMBlock(EEPROM_ADC_CAL_ADDR + 4, buf + 4, length + 2))
+	{
+		return 1;
+	}
+	uint16_t foundCRC = ((uint16_t)buf[4 + length] << 8) | buf[5 + length];
+	if (CRCencode(buf, 4 + length) != foundCRC)
+	{
+		return 1;
+	}
+
+	ADCCalibration cal;
+	if (!cal.Decode(buf + 4, length))
 	{
 		return 1;
 	}
+	UseADCCalibration(&cal);
+	return 0;
+}
+
+// Write bytes to the EEPROM, one page at a time, waiting for each page to be written.
+// Returns false if the EEPROM does not respond.
+bool ComputerCard::WriteEEPROMBlock(unsigned int eeAddress, const uint8_t *buf, unsigned int length)
+{
+	while (length)
+	{
+		// Writes must not cross a page boundary
+		unsigned n = EEPROM_WRITE_PAGE_BYTES - (eeAddress % EEPROM_WRITE_PAGE_BYTES);
+		if (n > length) n = length;
+
+		uint8_t deviceAddress = EEPROM_PAGE_ADDRESS | ((eeAddress >> 8) & 0x0F);
+		uint8_t page[1 + EEPROM_WRITE_PAGE_BYTES];
+		page[0] = eeAddress & 0xFF;
+		memcpy(page + 1, buf, n);
+		if (i2c_write_blocking(i2c0, deviceAddress, page, n + 1, false) != int(n + 1)) return false;
+
+		// The EEPROM doesn't respond until it has finished writing (up to 5ms)
+		uint32_t start = time_us_32();
+		while (i2c_write_blocking(i2c0, deviceAddress, page, 1, false) != 1)
+		{
+			if (time_us_32() - start > 20000) return false;
+		}
+
+		eeAddress += n;
+		buf += n;
+		length -= n;
+	}
+	return true;
+}
+
+void ComputerCard::UseADCCalibration(const ADCCalibration *cal)
+{
+	if constexpr (Features::adcCalibration)
+	{
+		useADCCalibration = false;
+		if (cal)
+		{
+			cal->Expand(adcCorrection);
+			for (int i = 0; i < 4; i++) adcOffset[i] = cal->offset[i];
+			useADCCalibration = true;
+		}
+	}
+}
+
+bool ComputerCard::SaveADCCalibration(const ADCCalibration &cal)
+{
+	uint8_t buf[6 + ADCCalibration::maxEncodedSize];
+	unsigned length = cal.Encode(buf + 4);
+	buf[0] = EEPROM_ADC_CAL_ID >> 8;
+	buf[1] = EEPROM_ADC_CAL_ID & 0xFF;
+	buf[2] = uint8_t(length >> 8);
+	buf[3] = uint8_t(length);
+	uint16_t crc = CRCencode(buf, 4 + length);
+	buf[4 + length] = uint8_t(crc >> 8);
+	buf[5 + length] = uint8_t(crc);
+	if (!WriteEEPROMBlock(EEPROM_ADC_CAL_ADDR, buf, 6 + length)) return false;
+
+	uint8_t check[6 + ADCCalibration::maxEncodedSize];
+	if (!ReadEEPROMBlock(EEPROM_ADC_CAL_ADDR, check, 6 + length) || memcmp(buf, check, 6 + length)) return false;
+
+	UseADCCalibration(&cal);
+	return true;
+}
+
+// Replace the default calibration table with the one in the EEPROM, if valid
+int ComputerCard::ReadEEPROMCalibration()
+{
 	uint8_t buf[EEPROM_NUM_BYTES];
-	for (int i = 0; i < EEPROM_NUM_BYTES; i++)
+	if (!ReadEEPROMBlock(0, buf, EEPROM_NUM_BYTES))
 	{
-		buf[i] = ReadByteFromEEPROM(i);
+		return 1;
 	}
 
+	if (((buf[EEPROM_ADDR_ID] << 8) | buf[EEPROM_ADDR_ID + 1]) != EEPROM_VAL_ID)
+	{
+		return 1;
+	}
 
 	uint16_t calculatedCRC = CRCencode(buf, 86);
 	uint16_t foundCRC = ((uint16_t)buf[EEPROM_ADDR_CRC_H] << 8) | buf[EEPROM_ADDR_CRC_L];
@@ -908,7 +3578,11 @@ int ComputerCard::ReadEEPROM()
 	for (uint8_t channel = 0; channel < calMaxChannels; channel++)
 	{
 		int channelOffset = bufferIndex + (41 * channel); // channel 0 = 4, channel 1 = 45
-		numCalibrationPoints[channel] = buf[channelOffset++];
+
+		// Each channel's 41 bytes hold a count and up to 8 five-byte points
+		uint8_t numPoints = buf[channelOffset++];
+		if (numPoints > 8) numPoints = 8;
+		numCalibrationPoints[channel] = numPoints;
 		for (uint8_t point = 0; point < numCalibrationPoints[channel]; point++)
 		{
 			// Unpack Pack targetVoltage (int8_t) from buf
@@ -925,7 +3599,6 @@ int ComputerCard::ReadEEPROM()
 			calibrationTable[channel][point].voltage = targetVoltage;
 			calibrationTable[channel][point].dacSetting = dacSetting;
 		}
-		CalcCalCoeffs(channel);
 	}
 
 	return 0;
@@ -965,12 +3638,52 @@ void ComputerCard::CalcCalCoeffs(int channel)
 }
 
 
-uint32_t ComputerCard::MIDIToDac(int midiNote, int channel)
+// Precalculate the DAC setting for each MIDI note (note 60 = 0V, 1V/octave),
+// from the least-squares line or from straight lines joining neighbouring calibration points
+void ComputerCard::CalcNoteTable(int channel)
 {
-	int32_t dacValue = ((calCoeffs[channel].mi * (midiNote - 60)) >> 4) + calCoeffs[channel].bi;
-	if (dacValue > 524287) dacValue = 524287;
-	if (dacValue < 0) dacValue = 0;
-	return dacValue;
+	// Calibration points in order of voltage, without repeated voltages
+	CalPoint p[calMaxPoints];
+	int n = 0;
+	if constexpr (Features::piecewiseCalibration)
+	{
+		// Insertion sort, skipping any point at the same voltage as an earlier one
+		for (int i = 0; i < numCalibrationPoints[channel]; i++)
+		{
+			CalPoint c = calibrationTable[channel][i];
+			bool repeated = false;
+			for (int j = 0; j < n; j++) repeated |= (p[j].voltage == c.voltage);
+			if (repeated) continue;
+
+			int j = n++;
+			for (; j > 0 && p[j - 1].voltage > c.voltage; j--) p[j] = p[j - 1];
+			p[j] = c;
+		}
+	}
+
+	for (int note = 0; note < 128; note++)
+	{
+		int32_t dacValue;
+		if (n >= 2)
+		{
+			// Voltages in 1/120ths of a volt: calibration points are in tenths, and notes in twelfths
+			int32_t v = (note - 60) * 10;
+
+			// Segment from point i to point i+1, with the first and last extended beyond the end points
+			int i = 0;
+			while (i < n - 2 && v > p[i + 1].voltage * 12) i++;
+			int64_t dv = (p[i + 1].voltage - p[i].voltage) * 12;
+			int64_t num = int64_t(p[i + 1].dacSetting - p[i].dacSetting) * (v - p[i].voltage * 12);
+			dacValue = p[i].dacSetting + int32_t((num >= 0 ? num + dv / 2 : num - dv / 2) / dv);
+		}
+		else
+		{
+			dacValue = ((calCoeffs[channel].mi * (note - 60)) >> 4) + calCoeffs[channel].bi;
+		}
+		if (dacValue > 524287) dacValue = 524287;
+		if (dacValue < 0) dacValue = 0;
+		noteDac[channel][note] = dacValue;
+	}
 }
 
 #endif
@@ -0,0 +1,214 @@
+// Use the calibration as soon as it is measured, so that the offsets are measured with it
+#define COMPUTERCARD_ADC_CALIBRATION 1
+// Sigma-delta CV output, so that the sweep passes evenly through every ADC code
+#define COMPUTERCARD_PRECISE_CV 2
+
+#include "ComputerCard.h"
+#include "pico/stdlib.h"
+#include <cstdio>
+
+/*
+
+ADC calibration: measures the non-linearity of this Computer's ADC and
+the offsets of its audio and CV inputs, and stores them in the EEPROM,
+to be used by every card built with COMPUTERCARD_ADC_CALIBRATION.
+
+Step 1: patch CV out 1 to CV in 1, and push the switch down.
+CV out 1 sweeps slowly up and down across its whole range four times
+(32 seconds), while every reading of CV in 1 is counted. From these
+counts, ADCCalibration::Build finds the codes that are wider or
+narrower than they should be, and the correction for every code.
+
+Step 2: remove all cables, and push the switch down. For one second,
+the audio and CV inputs are averaged, with the new corrections, to
+measure their offsets from 0. The calibration is then written to the
+EEPROM and read back.
+
+Progress and results, including the codes at which the correction
+changes, are printed over USB serial. The calibration can be repeated
+at any time by restarting the card.
+
+
+User interface:
+---------------
+
+Switch down:   Start the next step
+CV out 1:      Sweep (step 1)
+CV in 1:       Sweep, from CV out 1 (step 1)
+LEDs:          LED 0 flashing: waiting for step 1
+               LEDs 0 and 1 flashing: waiting for step 2
+               Bar graph: progress of the current step
+               All lit: calibration saved
+               All flashing: calibration failed
+
+ */
+
+class ADCCalibrationCard : public ComputerCard
+{
+	enum Step {WaitSweep, Sweeping, Swept, WaitMeasure, Measuring, Measured, Done, Failed};
+
+	static constexpr uint32_t passSamples = 8 * 48000; // one sweep across the range
+	static constexpr uint32_t sweepSamples = 4 * passSamples;
+	static constexpr uint32_t measureSamples = 48000;
+
+	volatile Step step;
+	Step reported;
+	uint32_t stepStart;
+	uint32_t histogram[ADCCalibration::numCodes];
+	int32_t sums[4];
+	ADCCalibration cal;
+
+public:
+	ADCCalibrationCard()
+	{
+		step = WaitSweep;
+		reported = Failed;
+		stepStart = 0;
+		for (int i = 0; i < 4; i++) sums[i] = 0;
+		for (unsigned i = 0; i < ADCCalibration::numCodes; i++) histogram[i] = 0;
+
+		// Start without a calibration, to measure the raw ADC
+		UseADCCalibration(nullptr);
+		stdio_init_all();
+	}
+
+	virtual void ProcessSample()
+	{
+		bool next = SwitchChanged() && SwitchVal() == Switch::Down;
+		uint32_t t = SampleCount() - stepStart;
+		uint32_t progress = 0; // of the current step, 0-6
+
+		switch (step)
+		{
+		case WaitSweep:
+			if (next)
+			{
+				stepStart = SampleCount();
+				CaptureADC(CV1, histogram);
+				step = Sweeping;
+			}
+			break;
+
+		case Sweeping:
+		{
+			// Triangle wave across the whole range of CVOutPrecise
+			uint32_t pos = t % (2 * passSamples);
+			uint32_t tri = pos < passSamples ? pos : 2 * passSamples - pos;
+			CVOutPrecise(0, int32_t(-262144 + (uint64_t(tri) * 524287) / passSamples));
+			progress = (t * 6) / sweepSamples;
+			if (t >= sweepSamples)
+			{
+				CaptureADC(CV1, nullptr);
+				CVOut1(0);
+				step = Swept;
+			}
+			break;
+		}
+
+		case WaitMeasure:
+			if (next)
+			{
+				stepStart = SampleCount();
+				step = Measuring;
+			}
+			break;
+
+		case Measuring:
+			sums[0] += AudioIn1();
+			sums[1] += AudioIn2();
+			sums[2] += CVIn1();
+			sums[3] += CVIn2();
+			progress = (t * 6) / measureSamples;
+			if (t + 1 >= measureSamples) step = Measured;
+			break;
+
+		default:
+			break;
+		}
+
+		bool flash = (SampleCount() / 8000) & 1;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			bool on;
+			switch (step)
+			{
+			case WaitSweep: on = i == 0 && flash; break;
+			case WaitMeasure: on = i < 2 && flash; break;
+			case Done: on = true; break;
+			case Failed: on = flash; break;
+			default: on = i < progress; break;
+			}
+			LedOn(i, on);
+		}
+	}
+
+	// Calculation, EEPROM and USB serial, outside the audio interrupt
+	virtual void Background()
+	{
+		Step s = step;
+		if (s == Swept)
+		{
+			cal.Clear();
+			if (cal.Build(histogram))
+			{
+				UseADCCalibration(&cal);
+				PrintCorrections();
+				step = WaitMeasure;
+			}
+			else
+			{
+				printf("Calibration failed: too few readings, too narrow a range, or too many corrections.\n");
+				printf("Is CV out 1 patched to CV in 1?\n");
+				step = Failed;
+			}
+		}
+		else if (s == Measured)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				int32_t mean = sums[i] / int32_t(measureSamples);
+				cal.offset[i] = int16_t(mean);
+			}
+			printf("Offsets: audio 1 %d, audio 2 %d, CV 1 %d, CV 2 %d\n", cal.offset[0], cal.offset[1], cal.offset[2], cal.offset[3]);
+			if (SaveADCCalibration(cal))
+			{
+				printf("Calibration saved (%u bytes)\n", cal.EncodedSize());
+				step = Done;
+			}
+			else
+			{
+				printf("Calibration could not be written to the EEPROM\n");
+				step = Failed;
+			}
+		}
+
+		if (step != reported)
+		{
+			reported = step;
+			if (reported == WaitSweep) printf("Step 1: patch CV out 1 to CV in 1, and push the switch down\n");
+			if (reported == WaitMeasure) printf("Step 2: remove all cables, and push the switch down\n");
+		}
+	}
+
+	void PrintCorrections()
+	{
+		uint64_t total = 0;
+		for (unsigned i = 0; i < ADCCalibration::numCodes; i++) total += histogram[i];
+		printf("%llu readings, %u runs of corrections:\n", (unsigned long long)total, cal.NumRuns());
+		int last = 1000;
+		for (unsigned code = 0; code < ADCCalibration::numCodes; code++)
+		{
+			int c = cal.Correction(code);
+			if (c != last) printf("  from code %4u: %+d\n", code, c);
+			last = c;
+		}
+	}
+};
+
+
+int main()
+{
+	// Too large for the stack
+	static ADCCalibrationCard ac;
+	ac.Run();
+}
@@ -0,0 +1,87 @@
+#include "ComputerCard.h"
+
+/*
+
+Block processing example.
+
+By default, ComputerCard calls ProcessSample once for every sample
+at 48kHz. Each call has a fixed overhead (interrupt entry, DMA setup,
+reading the knobs and jacks), which can be a significant part of the
+~20μs available for cards doing heavy processing.
+
+After EnableBlockProcessing(n), ProcessBlock is instead called once
+every n samples, with arrays of n input and output frames. Knobs,
+switch, CV and pulse inputs are then updated once per block, and
+audio latency becomes two blocks (2n samples).
+
+In this example, the main knob sets the gain of a stereo VCA.
+As the knob is only read once per block, the gain is ramped linearly
+across each block to avoid 'zipper' noise.
+
+
+User interface:
+---------------
+
+Main knob:              Gain
+Audio in 1/2:           Audio input
+Audio out 1/2:          Audio input × gain
+LEDs 0/1:               Audio out 1/2 level
+
+ */
+
+class BlockProcessing : public ComputerCard
+{
+	// Gain used at the end of the last block, 0-4095
+	int32_t lastGain;
+
+public:
+	BlockProcessing()
+	{
+		lastGain = 0;
+	}
+
+	// Not called, as ProcessBlock below doesn't call it
+	virtual void ProcessSample()
+	{
+	}
+
+	virtual void ProcessBlock(const Frame *in, Frame *out, size_t n)
+	{
+		int32_t gain = KnobVal(Knob::Main);
+
+		// Linearly interpolate gain from last block to this one
+		int32_t gainStep = (gain - lastGain) / int32_t(n);
+		int32_t g = lastGain;
+
+		int32_t peak[2] = {0, 0};
+		for (size_t i = 0; i < n; i++)
+		{
+			g += gainStep;
+			for (int c = 0; c < 2; c++)
+			{
+				out[i].audio[c] = (in[i].audio[c] * g) >> 12;
+
+				int32_t level = out[i].audio[c] < 0 ? -out[i].audio[c] : out[i].audio[c];
+				if (level > 2047) level = 2047;
+				if (level > peak[c]) peak[c] = level;
+			}
+		}
+		lastGain = g;
+
+		LedBrightness(0, peak[0] * 2);
+		LedBrightness(1, peak[1] * 2);
+	}
+};
+
+
+int main()
+{
+	BlockProcessing bp;
+
+	// Process audio in blocks of 16 samples (333μs)
+	bp.EnableBlockProcessing(16);
+
+	bp.Run();
+}
+
+  
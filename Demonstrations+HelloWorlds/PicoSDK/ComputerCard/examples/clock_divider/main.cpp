@@ -0,0 +1,119 @@
+#include "ComputerCard.h"
+
+/*
+
+Clock divider, using event callbacks instead of checking the inputs
+in ProcessSample.
+
+ComputerCard calls the On... functions below only when an input
+changes, so ProcessSample is empty: nothing happens on samples where
+the inputs are unchanged.
+
+User interface:
+---------------
+
+Pulse in 1:       Clock
+Pulse in 2:       Reset
+Main knob:        Division for pulse out 1 (1 to 16)
+Knob X:           Division for pulse out 2 (1 to 16)
+Switch down:      Reset
+Pulse out 1/2:    Divided clocks, high for the first clock pulse of each division
+LED 0/1:          Pulse out 1/2
+LED 4:            Lit while a clock cable is plugged into pulse in 1
+
+A reset arriving up to 5ms after a clock is applied to that clock, so that
+clock and reset signals from a sequencer which are not quite simultaneous
+still start each division on the right clock pulse.
+
+ */
+
+class ClockDivider : public ComputerCard
+{
+	static constexpr uint32_t resetWindow = 240; // 5ms at 48kHz
+
+	uint32_t count[2];
+	uint32_t lastClockTime;
+
+public:
+	ClockDivider()
+	{
+		count[0] = count[1] = 0;
+		lastClockTime = 0;
+	}
+
+	void SetOutput(int i, bool high)
+	{
+		PulseOut(i, high);
+		LedOn(i, high);
+	}
+
+	// Division from 1 to 16, set by the main knob or knob X
+	uint32_t Division(int i)
+	{
+		return 1 + ((KnobVal(i ? Knob::X : Knob::Main) * 16) >> 12);
+	}
+
+	void Reset()
+	{
+		// A clock just before the reset is treated as the first clock of the new division
+		bool lateReset = (SampleCount() - lastClockTime) < resetWindow;
+		for (int i = 0; i < 2; i++)
+		{
+			count[i] = lateReset ? 1 : 0;
+			SetOutput(i, lateReset && PulseIn1());
+		}
+	}
+
+	virtual void OnPulseRise(int i)
+	{
+		if (i == 1)
+		{
+			Reset();
+			return;
+		}
+
+		lastClockTime = SampleCount();
+		for (int j = 0; j < 2; j++)
+		{
+			if (count[j] >= Division(j)) count[j] = 0;
+			SetOutput(j, count[j] == 0);
+			count[j]++;
+		}
+	}
+
+	virtual void OnPulseFall(int i)
+	{
+		if (i == 0)
+		{
+			SetOutput(0, false);
+			SetOutput(1, false);
+		}
+	}
+
+	virtual void OnSwitch(Switch s)
+	{
+		if (s == Switch::Down) Reset();
+	}
+
+	virtual void OnJackInserted(Input i)
+	{
+		if (i == Input::Pulse1) LedOn(4);
+	}
+
+	virtual void OnJackRemoved(Input i)
+	{
+		if (i == Input::Pulse1) LedOff(4);
+	}
+	// Everything is done in the callbacks above
+	virtual void ProcessSample()
+	{
+	}
+};
+
+
+int main()
+{
+	ClockDivider cd;
+	cd.EnableNormalisationProbe();
+	cd.Run();
+}
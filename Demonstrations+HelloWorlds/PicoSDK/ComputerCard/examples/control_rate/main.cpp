@@ -0,0 +1,78 @@
+#include "ComputerCard.h"
+#include <cmath>
+
+/*
+
+Control-rate processing example: a lowpass filter.
+
+ProcessSample runs every sample, but many calculations only need to
+follow the knobs and CV, which change far more slowly than audio.
+After EnableControlRate(n), ProcessControl is called once every n
+samples, just before ProcessSample, and is the place for these.
+
+Here, ProcessControl turns the main knob and CV 1 into a filter cutoff
+frequency, and calculates the filter coefficient using floating-point
+exponentials, which are slow on the RP2040. A LinearRamp carries the
+coefficient from one ProcessControl call to the next, so that the
+filter changes smoothly at every sample.
+
+
+User interface:
+---------------
+
+Main knob:              Cutoff frequency (20Hz to 20kHz)
+CV in 1:                Cutoff frequency (added to main knob)
+Audio in 1/2:           Audio input
+Audio out 1/2:          Lowpass-filtered audio (two-pole, 12dB/octave)
+LED 0:                  Cutoff frequency
+
+ */
+
+class ControlRate : public ComputerCard
+{
+	LinearRamp coeff;    // filter coefficient, 16 fractional bits
+	int32_t lp[2][2];    // two one-pole stages for each channel, 8 fractional bits
+
+public:
+	ControlRate()
+	{
+		for (int c = 0; c < 2; c++) lp[c][0] = lp[c][1] = 0;
+	}
+
+	virtual void ProcessControl()
+	{
+		int32_t cutoff = KnobVal(Knob::Main) + CVIn1();
+		if (cutoff < 0) cutoff = 0;
+		if (cutoff > 4095) cutoff = 4095;
+
+		// 20Hz × 2^10 = 20kHz, over the range of the knob
+		float hz = 20.0f * exp2f(float(cutoff) * (10.0f / 4096.0f));
+		float a = 1.0f - expf(-6.2831853f * hz / float(SampleRate()));
+		coeff.Set(int32_t(a * 65536.0f), ControlPeriod());
+
+		LedBrightness(0, uint16_t(cutoff));
+	}
+
+	virtual void ProcessSample()
+	{
+		int32_t a = coeff.Next();
+		for (int c = 0; c < 2; c++)
+		{
+			int32_t x = AudioIn(c) << 8;
+			lp[c][0] += int32_t((int64_t(a) * (x - lp[c][0])) >> 16);
+			lp[c][1] += int32_t((int64_t(a) * (lp[c][0] - lp[c][1])) >> 16);
+			AudioOut(c, int16_t(lp[c][1] >> 8));
+		}
+	}
+};
+
+
+int main()
+{
+	ControlRate cr;
+
+	// Recalculate the filter every 32 samples (0.67ms)
+	cr.EnableControlRate(32);
+
+	cr.Run();
+}
@@ -97,42 +97,9 @@ public:
 			{
 				// Read MIDI input
 				tud_midi_stream_read(packet, sizeof(packet));
-				MIDIMessage m(packet);
-
-				// Handle MIDI note on/off and mod wheel
-				switch (m.command)
-				{
-				case MIDIMessage::NoteOn:
-					if (m.velocity > 0) // real note on
-					{
-						CVOut1MIDINote(m.note);
-						LedOn(1);
-						PulseOut1(true);
-					}
-					else // note on with velocity 0 = note off
-					{
-						LedOff(1);
-						PulseOut1(false);
-					}
-					break;
-					
-				case MIDIMessage::NoteOff:
-					LedOff(1);
-					PulseOut1(false);
-					break;
-					
-				case MIDIMessage::CC:
-					// Mod wheel -> CV out 2
-					if (m.cc == 1)
-					{
-						CVOut2(m.value << 4);
-						LedBrightness(3, m.value << 4);
-					}
-					break;
-					
-				default:
-					break;
-				}
+
+				// Pass the message to OnEvent, in the audio interrupt, to be applied on an exact sample
+				PostEvent(Event{{packet[0], packet[1], packet[2], 0}});
 			}
 
 			// Read main knob, and if value has changed, send 
@@ -147,6 +114,49 @@ public:
 		}
 	}
 
+	// Called in the audio interrupt with each MIDI message sent by USBCore,
+	// a fixed number of samples after it arrived
+	virtual void OnEvent(const Event &e)
+	{
+		uint8_t packet[3] = {e.data[0], e.data[1], e.data[2]};
+		MIDIMessage m(packet);
+
+		// Handle MIDI note on/off and mod wheel
+		switch (m.command)
+		{
+		case MIDIMessage::NoteOn:
+			if (m.velocity > 0) // real note on
+			{
+				CVOut1MIDINote(m.note);
+				LedOn(1);
+				PulseOut1(true);
+			}
+			else // note on with velocity 0 = note off
+			{
+				LedOff(1);
+				PulseOut1(false);
+			}
+			break;
+
+		case MIDIMessage::NoteOff:
+			LedOff(1);
+			PulseOut1(false);
+			break;
+
+		case MIDIMessage::CC:
+			// Mod wheel -> CV out 2
+			if (m.cc == 1)
+			{
+				CVOut2(m.value << 4);
+				LedBrightness(3, m.value << 4);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
 	
 	// 48kHz audio processing function
 	virtual void ProcessSample()
@@ -163,6 +173,11 @@ public:
 int main()
 {
 	MIDIDevice md;
+
+	// Apply MIDI messages 4 samples (~83us) after USBCore receives them,
+	// which is more than PostEvent can take, so none arrive late
+	md.EnableEventQueue(4);
+
 	md.Run();
 }
 
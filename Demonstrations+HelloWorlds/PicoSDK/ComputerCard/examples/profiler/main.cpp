@@ -0,0 +1,121 @@
+#include "ComputerCard.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include <cstdio>
+
+/*
+
+Profiler example, showing how close ProcessSample comes to the
+~20.8μs available for each 48kHz sample.
+
+ProcessSample runs a chain of simple one-pole lowpass filters on
+audio input 1, with the number of filters set by the main knob, so that
+turning the knob up increases the processing load.
+
+If the interrupt overruns, OnOverrun lowers the limit on the number of
+filters to three quarters of the number in use, as a card might switch
+to a cheaper quality setting, until the switch is pushed down.
+
+With the profiler enabled, ComputerCard times every audio interrupt.
+Once per second, the second core shows the results on the LEDs and
+prints a summary over USB serial, followed by the filter limit, the
+overrun counts from the diagnostics record, including those from before
+the last reset, and the RAM in use, e.g.:
+
+n=48000 min=3.1us mean=6.4us max=7.0us (33% of 20.8us) overruns=0 hist=0,0,0,... | filters<=200, this run: 0 overruns 0 resyncs, all 3 runs: 2 overruns 1 resyncs | static=... heap=... heapfree=... stack=.../2048B
+
+User interface:
+---------------
+
+Main knob:     Number of filters (processing load)
+Audio in 1:    Filter input
+Audio out 1:   Filter output
+Switch down:   Reset profiler statistics, and filter limit
+LEDs 0-4:      Longest interrupt time, each LED = 20% of the time available
+LED 5:         Lit if any interrupt has overrun
+
+ */
+
+class Profiler : public ComputerCard
+{
+	static constexpr int maxFilters = 200;
+	int32_t state[maxFilters];
+	volatile int filterLimit; // lowered after each overrun
+	int numFilters;
+
+public:
+	Profiler()
+	{
+		for (int i = 0; i < maxFilters; i++) state[i] = 0;
+		filterLimit = maxFilters;
+		numFilters = 0;
+
+		EnableProfiler();
+
+		// Start the second core, to report profiler results
+		multicore_launch_core1(core1);
+	}
+
+	// Boilerplate to call member function as second core
+	static void core1()
+	{
+		((Profiler *)ThisPtr())->ReportingCore();
+	}
+
+	// Code for second RP2040 core, blocking
+	void ReportingCore()
+	{
+		// USB serial is run from this core, so that its interrupts don't delay the audio
+		stdio_init_all();
+
+		char report[256], memory[96];
+		uint32_t lastReport = time_us_32();
+		while (1)
+		{
+			if (time_us_32() - lastReport >= 1000000)
+			{
+				lastReport += 1000000;
+				ProfilerLEDs();
+				ProfilerReport(report, sizeof(report));
+				DiagnosticsRecord d = Diagnostics();
+				MemoryReport(memory, sizeof(memory));
+				printf("%s | filters<=%d, this run: %lu overruns %lu resyncs, all %lu runs: %lu overruns %lu resyncs | %s\n",
+					   report, filterLimit, (unsigned long)d.runOverruns, (unsigned long)d.runResyncs,
+					   (unsigned long)d.runs, (unsigned long)d.overruns, (unsigned long)d.resyncs, memory);
+			}
+		}
+	}
+
+	virtual void ProcessSample()
+	{
+		numFilters = (KnobVal(Knob::Main) * maxFilters) >> 12;
+		if (numFilters > filterLimit) numFilters = filterLimit;
+
+		int32_t x = AudioIn1();
+		for (int i = 0; i < numFilters; i++)
+		{
+			state[i] += (x - state[i]) >> 2;
+			x = state[i];
+		}
+		AudioOut1(x);
+
+		if (SwitchChanged() && SwitchVal() == Switch::Down)
+		{
+			ResetProfiler();
+			filterLimit = maxFilters;
+		}
+	}
+
+	// Called when ProcessSample has taken too long: use fewer filters from now on
+	virtual void OnOverrun()
+	{
+		filterLimit = (numFilters * 3) / 4;
+	}
+};
+
+
+int main()
+{
+	Profiler p;
+	p.Run();
+}
@@ -20,7 +20,8 @@ pushed much into audio rate.
 
 
 In this example, the ProcessSample function does no interpolation - only a 
-zero-order hold of the last value from the second core calculation.
+zero-order hold of the last value from the second core calculation, passed
+between the cores with a Mailbox.
 
 A more sophisticated example would use linear (or better) interpolation of
 these (non-equally-spaced) values.
@@ -41,13 +42,12 @@ constexpr float twopi = (float)M_TWOPI;
 class SecondCore : public ComputerCard
 {
 	// Variables for communication between the two cores
-	volatile int16_t out; // output from slow core to 48kHz core.
-	volatile uint32_t sampleCount; // count of number of audio samples per 'slow core' loop
+	Mailbox<int16_t> out; // output from slow core to 48kHz core.
+	volatile uint32_t sampleCount; // count of audio samples, only written by the 48kHz core
 	
 public:
 	SecondCore()
 	{
-		out = 0;
 		sampleCount = 0;
 		// Start the second core
 		multicore_launch_core1(core1);
@@ -64,6 +64,7 @@ public:
 	void SlowProcessingCore()
 	{
 		float phase = 0.0f;
+		uint32_t lastSampleCount = sampleCount;
 		
 		while (1)
 		{
@@ -81,11 +82,11 @@ public:
 			// exponentiate a sum of sines with coefficients set by knob X
 			float outf = expf(sinf(phase) + wobbles * (KnobVal(Knob::X)/4096.0f));
 			
-			out = int16_t(outf * 270); // Copy output over to signed 12-bit integer value
+			out.Write(int16_t(outf * 270)); // Copy output over to signed 12-bit integer value
 
 			// Count how many audio samples passed since last loop
-			uint32_t samplesPassed = sampleCount;
-			sampleCount -= samplesPassed; 
+			uint32_t samplesPassed = sampleCount - lastSampleCount;
+			lastSampleCount += samplesPassed;
 
 			// dt is time elapsed, in seconds, since last loop
 			float dt = samplesPassed/48000.0f;
@@ -115,11 +116,13 @@ public:
 	// 48kHz audio processing function
 	virtual void ProcessSample()
 	{
-		// Simply copy output of LFO calculation to the four analogue outputs
-		CVOut1(out);
-		CVOut2(out);
-		AudioOut1(out);
-		AudioOut2(out);
+		// Simply copy latest output of LFO calculation to the four analogue outputs
+		int16_t lfo;
+		out.Read(lfo);
+		CVOut1(lfo);
+		CVOut2(lfo);
+		AudioOut1(lfo);
+		AudioOut2(lfo);
 
 		// Increment sample count to provide time reference independent
 		// of the execution 
@@ -0,0 +1,122 @@
+#include "ComputerCard.h"
+#include "pico/multicore.h"
+#include <cmath>
+
+/*
+
+Audio processing on the second core, using a pair of lock-free ring
+buffers to pass audio between the cores.
+
+Unlike the second_core example, where the second core produces a slow
+control signal, here every audio sample is processed on the second core.
+This allows processing which takes longer than a single sample time,
+as long as it keeps up on average, at the cost of some extra latency.
+
+ProcessSample pushes each input sample into one ring, and pops an
+output sample from the other. The second core pops input samples in
+batches, processes them, and pushes the results back.
+
+The processing here is a stereo tanh waveshaper, which is slow on the
+RP2040 as tanhf uses software floating point.
+
+User interface:
+---------------
+
+Main knob:        Drive
+Audio in 1/2:     Input
+Audio out 1/2:    Distorted output
+LED 0:            Lit once audio is flowing through the second core
+LED 1:            Lights if the second core failed to keep up (output dropout)
+
+ */
+
+class SecondCoreAudio : public ComputerCard
+{
+	// Output starts once this many processed samples are waiting (~0.7ms latency)
+	static constexpr unsigned latency = 32;
+	static constexpr unsigned batchSize = 16;
+
+	// Rings between the cores: the 48kHz core pushes into toCore1 and pops from fromCore1
+	SPSCRing<Frame, 128> toCore1, fromCore1;
+
+	bool started;
+	uint32_t dropoutTimer;
+
+	static SecondCoreAudio *instance;
+
+public:
+	SecondCoreAudio()
+	{
+		started = false;
+		dropoutTimer = 0;
+
+		// ThisPtr() is only set once Run is called, so use our own pointer for the second core
+		instance = this;
+		multicore_launch_core1(core1);
+	}
+
+	static void core1()
+	{
+		instance->AudioCore();
+	}
+
+	// Code for second RP2040 core, blocking
+	void AudioCore()
+	{
+		Frame frames[batchSize];
+		while (1)
+		{
+			unsigned n = toCore1.Pop(frames, batchSize);
+			if (n == 0) continue;
+
+			float drive = 1.0f + KnobVal(Knob::Main) * (20.0f / 4095.0f);
+			float gain = 2047.0f / tanhf(drive);
+			for (unsigned i = 0; i < n; i++)
+			{
+				for (int c = 0; c < 2; c++)
+				{
+					float x = frames[i].audio[c] * (1.0f / 2048.0f);
+					frames[i].audio[c] = int16_t(tanhf(drive * x) * gain);
+				}
+			}
+
+			// Can't overflow, as fromCore1 has room for everything in toCore1
+			fromCore1.Push(frames, n);
+		}
+	}
+
+	// 48kHz audio processing function
+	virtual void ProcessSample()
+	{
+		Frame in = {{AudioIn1(), AudioIn2()}};
+		toCore1.Push(in);
+
+		if (!started)
+		{
+			started = fromCore1.Size() >= latency;
+		}
+
+		Frame out = {{0, 0}};
+		if (started && !fromCore1.Pop(out))
+		{
+			// Second core didn't keep up: wait for the buffer to refill
+			started = false;
+			dropoutTimer = 24000;
+		}
+		AudioOut1(out.audio[0]);
+		AudioOut2(out.audio[1]);
+
+		LedOn(0, started);
+		LedOn(1, dropoutTimer > 0);
+		if (dropoutTimer) dropoutTimer--;
+	}
+};
+
+SecondCoreAudio *SecondCoreAudio::instance;
+
+
+int main()
+{
+	SecondCoreAudio sca;
+	sca.Run();
+}
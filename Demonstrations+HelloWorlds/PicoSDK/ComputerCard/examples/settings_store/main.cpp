@@ -0,0 +1,69 @@
+#include "ComputerCard.h"
+
+/*
+
+Settings stored in flash: two voltages that are remembered when
+the Computer is switched off.
+
+The values are set in ProcessSample, which only changes them in RAM.
+The Background callback, which runs outside the audio interrupt,
+then writes them to flash with FlashSettings::Commit.
+
+This card is built to run entirely from RAM (copy_to_ram in
+CMakeLists.txt), so that audio carries on while flash is written.
+
+
+User interface:
+---------------
+
+Main knob / Knob X:     Voltage to store for CV out 1 / CV out 2
+Switch down:            Store the knob positions
+CV out 1/2:             Stored voltages (0V until first stored)
+LED 0/1:                CV out 1/2
+LED 5:                  Lit while the voltages are written to flash
+
+ */
+
+class SettingsStore : public ComputerCard
+{
+	enum Key {CV1Value, CV2Value, NumKeys};
+
+	FlashSettings<NumKeys> settings;
+	volatile bool saving;
+
+public:
+	SettingsStore()
+	{
+		settings.Load();
+		saving = false;
+	}
+
+	virtual void ProcessSample()
+	{
+		if (SwitchChanged() && SwitchVal() == Switch::Down)
+		{
+			settings.Set(CV1Value, KnobVal(Knob::Main) - 2048);
+			settings.Set(CV2Value, KnobVal(Knob::X) - 2048);
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			int32_t v = settings.Get(CV1Value + i);
+			CVOut(i, int16_t(v));
+			LedBrightness(i, uint16_t(v + 2048));
+		}
+		LedOn(5, saving);
+	}
+
+	virtual void Background()
+	{
+		saving = !settings.Commit();
+	}
+};
+
+
+int main()
+{
+	SettingsStore ss;
+	ss.Run();
+}
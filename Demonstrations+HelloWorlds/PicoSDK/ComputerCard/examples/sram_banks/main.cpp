@@ -0,0 +1,155 @@
+#include "ComputerCard.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "hardware/structs/busctrl.h"
+#include <cstdio>
+
+/*
+
+SRAM bank benchmark, measuring how much the audio interrupt is slowed
+down by the second core's memory accesses, with and without the
+memory layout of memmap_audio_bank.ld.
+
+The RP2040's RAM is made of banks that can each serve one access per
+cycle. When the two cores (or a core and DMA) access the same bank at
+once, one of them waits. Here, ProcessSample runs a memory-heavy load,
+reading 128 taps from a 16kB delay line, while the second core
+repeatedly copies 48kB from one half of a 96kB buffer to the other, as
+a card streaming sample or delay memory might.
+
+This card is built twice (see CMakeLists.txt):
+- sram_banks is linked with memmap_audio_bank.ld. The card object,
+  which holds the delay line, is placed with COMPUTERCARD_AUDIO_DATA
+  in SRAM bank 3, along with the interrupt's code and ComputerCard's
+  DMA buffers, and the second core's buffer is in banks 0-2.
+- sram_banks_striped uses the default layout, in which every variable
+  is striped across banks 0-3.
+
+Once per second, the second core prints the profiler summary over USB
+serial, with the number of accesses to SRAM banks 0-3 that had to wait
+for another bus master (from the bus fabric's performance counters,
+which saturate at 16777215), e.g.
+
+core 1 copying: n=48000 min=... mean=... | contested: sram0=... sram1=... sram2=... sram3=...
+
+The difference in mean interrupt time between the switch up (second
+core idle) and in the middle (second core copying) is the time the
+audio interrupt spends waiting for the second core. Compare it between
+the two builds.
+
+
+User interface:
+---------------
+
+Switch up:      Second core idle (only reporting)
+Switch middle:  Second core copying memory
+Switch down:    Second core copying memory
+                (moving the switch resets the profiler statistics)
+Audio in 1:     Delay line input
+Audio out 1:    Average of the delay taps
+LEDs 0-4:       Longest interrupt time, each LED = 20% of the time available
+LED 5:          Lit if any interrupt has overrun
+
+ */
+
+// Second core's working memory, in banks 0-2 with memmap_audio_bank.ld
+static uint32_t bulk[2][12288];
+
+class SramBanks : public ComputerCard
+{
+	static constexpr unsigned delaySize = 8192; // 16kB, a power of two
+	static constexpr unsigned numTaps = 128;
+	int16_t delay[delaySize];
+	unsigned writePos;
+	volatile bool copying;
+
+public:
+	SramBanks()
+	{
+		// Not initialised at startup when in the audio bank, so clear here
+		for (unsigned i = 0; i < delaySize; i++) delay[i] = 0;
+		writePos = 0;
+		copying = false;
+
+		EnableProfiler();
+
+		// Start the second core, to load memory and report results
+		multicore_launch_core1(core1);
+	}
+
+	// Boilerplate to call member function as second core
+	static void core1()
+	{
+		((SramBanks *)ThisPtr())->LoadingCore();
+	}
+
+	// Code for second RP2040 core, blocking
+	void LoadingCore()
+	{
+		// USB serial is run from this core, so that its interrupts don't delay the audio
+		stdio_init_all();
+
+		const bus_ctrl_perf_counter_t events[4] = {
+			arbiter_sram0_perf_event_access_contested,
+			arbiter_sram1_perf_event_access_contested,
+			arbiter_sram2_perf_event_access_contested,
+			arbiter_sram3_perf_event_access_contested};
+		for (int i = 0; i < 4; i++)
+		{
+			busctrl_hw->counter[i].sel = events[i];
+			busctrl_hw->counter[i].value = 0; // any write clears
+		}
+
+		char report[256];
+		uint32_t lastReport = time_us_32();
+		while (1)
+		{
+			if (copying) memcpy(bulk[1], bulk[0], sizeof(bulk[0]));
+
+			if (time_us_32() - lastReport >= 1000000)
+			{
+				lastReport += 1000000;
+				unsigned contested[4];
+				for (int i = 0; i < 4; i++)
+				{
+					contested[i] = busctrl_hw->counter[i].value;
+					busctrl_hw->counter[i].value = 0;
+				}
+				ProfilerLEDs();
+				ProfilerReport(report, sizeof(report));
+				printf("%s: %s | contested: sram0=%u sram1=%u sram2=%u sram3=%u\n",
+					   copying ? "core 1 copying" : "core 1 idle", report,
+					   contested[0], contested[1], contested[2], contested[3]);
+			}
+		}
+	}
+
+	virtual void __not_in_flash_func(ProcessSample)()
+	{
+		// Taps spread evenly through the delay line
+		int32_t sum = 0;
+		for (unsigned i = 0; i < numTaps; i++)
+		{
+			sum += delay[(writePos - 1 - i * (delaySize / numTaps)) & (delaySize - 1)];
+		}
+		delay[writePos] = int16_t(AudioIn1());
+		writePos = (writePos + 1) & (delaySize - 1);
+		AudioOut1(int16_t(sum / int32_t(numTaps)));
+
+		copying = SwitchVal() != Switch::Up;
+		if (SwitchChanged()) ResetProfiler();
+	}
+};
+
+// Check at compile time that the card object (in SRAM3 with memmap_audio_bank.ld) and the second core's buffer fit
+static_assert(ComputerCard::MemoryBudget::Fits(sizeof(bulk) + (ComputerCard::Features::audioBank ? 0 : sizeof(SramBanks))),
+			  "sram_banks needs too much RAM");
+static_assert(!ComputerCard::Features::audioBank || ComputerCard::MemoryBudget::FitsAudioBank(sizeof(SramBanks)),
+			  "SramBanks is too large for SRAM3");
+
+int main()
+{
+	// Too large for the stack. Static, and in the audio bank with memmap_audio_bank.ld.
+	static SramBanks sb COMPUTERCARD_AUDIO_DATA;
+	sb.Run();
+}
@@ -0,0 +1,2 @@
+// The sram_banks example, built with the default memory layout for comparison (see CMakeLists.txt)
+#include "../sram_banks/main.cpp"
@@ -0,0 +1,152 @@
+// Keep 2048 trace records (24kB) for each core
+#define COMPUTERCARD_TRACE_SIZE 2048
+
+#include "ComputerCard.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include <cstdio>
+
+/*
+
+Trace example, recording the audio interrupt, the second core's loop
+and USB serial activity on one timeline.
+
+With COMPUTERCARD_TRACE_SIZE set, ComputerCard records the start and
+end of every audio interrupt in a trace buffer in RAM. This card adds
+its own records:
+- in ProcessSample, a span around a chain of lowpass filters, whose
+  length is set by the main knob, so that the interrupt grows as the
+  knob is turned up;
+- on the second core, a span for the work done each millisecond, and
+  a counter of the time between these loops;
+- spans around polling USB serial and dumping the trace, and an
+  instant for each character received.
+
+Typing 'd' into a serial terminal, or pushing the switch down, dumps
+the trace as text over USB serial, then clears it. To view it, save
+the dump to a file (e.g. with the terminal's logging), convert it with
+the host program trace_decode:
+
+  trace_decode dump.txt trace.json
+
+and open trace.json in https://ui.perfetto.dev or chrome://tracing.
+Each core is shown as a separate track. The audio core writes four
+records per sample, so its ring holds the last ~10ms, and the second
+core's the last ~400ms.
+
+
+User interface:
+---------------
+
+Main knob:     Number of filters (processing load)
+Audio in 1:    Filter input
+Audio out 1:   Filter output
+Switch down:   Dump trace over USB serial
+LED 0:         Flashes once per second, from the second core
+
+ */
+
+class Trace : public ComputerCard
+{
+	static constexpr int maxFilters = 100;
+	int32_t state[maxFilters];
+	volatile bool dumpRequest;
+
+	// This card's trace IDs
+	enum
+	{
+		TraceFilters = TraceUser,
+		TraceCore1Work,
+		TraceCore1Period,
+		TraceUSBPoll,
+		TraceUSBReceive,
+		TraceDumpSpan
+	};
+
+public:
+	Trace()
+	{
+		for (int i = 0; i < maxFilters; i++) state[i] = 0;
+		dumpRequest = false;
+
+		TraceName(TraceFilters, "filters");
+		TraceName(TraceCore1Work, "core 1 work");
+		TraceName(TraceCore1Period, "core 1 loop period (us)");
+		TraceName(TraceUSBPoll, "USB poll");
+		TraceName(TraceUSBReceive, "USB receive");
+		TraceName(TraceDumpSpan, "trace dump");
+
+		// Start the second core, for USB serial and slow work
+		multicore_launch_core1(core1);
+	}
+
+	// Boilerplate to call member function as second core
+	static void core1()
+	{
+		((Trace *)ThisPtr())->SecondCore();
+	}
+
+	// Code for second RP2040 core, blocking
+	void SecondCore()
+	{
+		// USB serial is run from this core, so that its interrupts don't delay the audio
+		stdio_init_all();
+
+		uint32_t lastLoop = time_us_32();
+		while (1)
+		{
+			// Run once per millisecond, so that the trace buffer holds a useful length of time
+			uint32_t now = time_us_32();
+			if (now - lastLoop < 1000) continue;
+			TraceCounter(TraceCore1Period, now - lastLoop);
+			lastLoop = now;
+
+			// Some slow work, here just setting the LED
+			TraceBegin(TraceCore1Work);
+			LedOn(0, (now % 1000000) < 100000);
+			TraceEnd(TraceCore1Work);
+
+			TraceBegin(TraceUSBPoll);
+			int c = getchar_timeout_us(0);
+			TraceEnd(TraceUSBPoll);
+			if (c >= 0) TraceInstant(TraceUSBReceive, uint32_t(c));
+
+			if (c == 'd' || dumpRequest)
+			{
+				dumpRequest = false;
+				TraceBegin(TraceDumpSpan);
+				unsigned n = TraceDump([](const char *line) {fputs(line, stdout);});
+				TraceClear();
+				TraceEnd(TraceDumpSpan, n);
+				fflush(stdout);
+			}
+		}
+	}
+
+	virtual void ProcessSample()
+	{
+		int numFilters = (KnobVal(Knob::Main) * maxFilters) >> 12;
+
+		TraceBegin(TraceFilters, uint32_t(numFilters));
+		int32_t x = AudioIn1();
+		for (int i = 0; i < numFilters; i++)
+		{
+			state[i] += (x - state[i]) >> 2;
+			x = state[i];
+		}
+		TraceEnd(TraceFilters);
+		AudioOut1(x);
+
+		if (SwitchChanged() && SwitchVal() == Switch::Down)
+		{
+			dumpRequest = true;
+		}
+	}
+};
+
+
+int main()
+{
+	Trace t;
+	t.Run();
+}
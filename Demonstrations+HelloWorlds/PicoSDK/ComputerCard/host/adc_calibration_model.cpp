@@ -0,0 +1,365 @@
+/*
+Model of ComputerCard's per-unit ADC calibration (COMPUTERCARD_ADC_CALIBRATION),
+against modelled RP2040 ADC non-linearity.
+
+Part 1 models several units, each with its own widths for the four wide
+codes (at 512, 1536, 2560 and 3584) and small random variations in the
+width of every other code. For each, a noisy input swept evenly across
+most of the range is read to make the histogram for ADCCalibration::Build,
+and the calibration is encoded and decoded as it would be in the EEPROM.
+The program reports the size of the calibration and, for raw readings,
+the fixed COMPUTERCARD_DNL_CORRECTION and the calibration, the RMS and
+largest error of readings of a slow ramp from the straight line best
+fitting them. (Readings within a wide code are uncertain by up to half its
+width whatever the correction, so the largest errors improve less.)
+
+Part 2 runs the same steps as the adc_calibration example through
+ComputerCard on the emulated hardware, with the ADC's transfer function
+(cchost::State::adcTransfer) given wide codes: a sweep of CV input 1
+counted with CaptureADC, offsets measured with no cables, and the result
+saved to the EEPROM with SaveADCCalibration. A second run, started with
+that EEPROM, reads a ramp on CV input 1; a third, with an empty EEPROM,
+shows the uncalibrated readings for comparison.
+
+Usage: adc_calibration_model
+Exits with status 1 if a calibration could not be built, did not survive
+encoding or the EEPROM, or did not make the readings more accurate.
+*/
+
+#define COMPUTERCARD_ADC_CALIBRATION 1
+#include "ComputerCard.h"
+#include "host_driver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+static const unsigned wideCodes[4] = {512, 1536, 2560, 3584};
+
+// Fixed correction used without a calibration, as in BufferFull
+static int DNLCorrection(int code)
+{
+	uint16_t adc512 = uint16_t(code + 512);
+	if (!(adc512 % 0x01FF)) code += 4;
+	return code + ((adc512 >> 10) << 3);
+}
+
+// Straight line fit of readings y against inputs x: returns RMS error, and largest error in *maxError
+static double LineError(const std::vector<double> &x, const std::vector<double> &y, double *maxError)
+{
+	double n = double(x.size()), sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		sx += x[i];
+		sy += y[i];
+		sxx += x[i] * x[i];
+		sxy += x[i] * y[i];
+	}
+	double m = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+	double b = (sy - m * sx) / n;
+	double sum2 = 0;
+	*maxError = 0;
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		double e = y[i] - (m * x[i] + b);
+		sum2 += e * e;
+		*maxError = std::max(*maxError, fabs(e));
+	}
+	return sqrt(sum2 / n);
+}
+
+////////////////////////////////////////
+// Part 1: ADCCalibration alone
+
+// ADC whose codes have given widths, in units of an ideal code
+struct ModelADC
+{
+	std::vector<double> upper; // input level at the top of each code
+
+	explicit ModelADC(uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::normal_distribution<double> smallDNL(0.0, 0.03);
+		std::uniform_real_distribution<double> wideWidth(6.0, 12.0);
+		double level = 0;
+		for (unsigned code = 0; code < ADCCalibration::numCodes; code++)
+		{
+			double width = 1.0 + smallDNL(rng);
+			if (std::find(wideCodes, wideCodes + 4, code) != wideCodes + 4) width = wideWidth(rng);
+			level += width;
+			upper.push_back(level);
+		}
+	}
+
+	int Read(double level) const
+	{
+		size_t code = std::upper_bound(upper.begin(), upper.end(), level) - upper.begin();
+		return int(std::min(code, size_t(ADCCalibration::numCodes - 1)));
+	}
+};
+
+static bool ModelUnits()
+{
+	const int numUnits = 6;
+	const double noise = 0.7; // RMS noise on each reading, in codes
+	const unsigned readings = 600000; // ~150 per code; an evenly swept input on one ADC channel
+
+	printf("Part 1: modelled units (%u readings per calibration, %.1f codes RMS noise)\n", readings, noise);
+	printf("unit  wide code widths      runs  bytes   RMS / max error (codes): raw         fixed DNL       calibrated\n");
+	bool ok = true;
+	for (int unit = 0; unit < numUnits; unit++)
+	{
+		ModelADC adc(1000 + unit);
+		std::mt19937 rng(unit);
+		std::normal_distribution<double> noiseDist(0.0, noise);
+
+		// Sweep across most of the range, as CV out 1 to CV in 1 would
+		double lo = adc.upper[100], hi = adc.upper[ADCCalibration::numCodes - 100];
+		static uint32_t histogram[ADCCalibration::numCodes];
+		std::fill(histogram, histogram + ADCCalibration::numCodes, 0);
+		for (unsigned n = 0; n < readings; n++)
+		{
+			double level = lo + (hi - lo) * (n + 0.5) / readings;
+			histogram[adc.Read(level + noiseDist(rng))]++;
+		}
+
+		ADCCalibration cal;
+		bool built = cal.Build(histogram);
+
+		// Through the EEPROM encoding
+		uint8_t buf[ADCCalibration::maxEncodedSize];
+		unsigned size = cal.Encode(buf);
+		ADCCalibration decoded;
+		bool same = decoded.Decode(buf, size) && decoded.NumRuns() == cal.NumRuns();
+		for (unsigned code = 0; code < ADCCalibration::numCodes && same; code++)
+		{
+			same = decoded.Correction(code) == cal.Correction(code);
+		}
+		static int8_t table[ADCCalibration::numCodes];
+		decoded.Expand(table);
+
+		// Slow noiseless ramp over the swept range
+		std::vector<double> x, raw, fixed, calibrated;
+		for (double level = lo; level < hi; level += 0.1)
+		{
+			int code = adc.Read(level);
+			x.push_back(level);
+			raw.push_back(code);
+			fixed.push_back(DNLCorrection(code));
+			calibrated.push_back(code + table[code]);
+		}
+		double maxRaw, maxFixed, maxCal;
+		double rmsRaw = LineError(x, raw, &maxRaw);
+		double rmsFixed = LineError(x, fixed, &maxFixed);
+		double rmsCal = LineError(x, calibrated, &maxCal);
+
+		char widths[64];
+		snprintf(widths, sizeof(widths), "%.1f %.1f %.1f %.1f",
+				 adc.upper[512] - adc.upper[511], adc.upper[1536] - adc.upper[1535],
+				 adc.upper[2560] - adc.upper[2559], adc.upper[3584] - adc.upper[3583]);
+		// The fixed correction suits some units well; the calibration should do at least as well on every unit
+		bool good = built && same && rmsCal <= rmsFixed + 0.05 && rmsCal < rmsRaw / 2;
+		ok = ok && good;
+		printf("%4d  %-20s  %4u  %5u   %5.2f / %5.2f   %5.2f / %5.2f   %5.2f / %5.2f%s\n", unit, widths, cal.NumRuns(),
+			   size + 6, rmsRaw, maxRaw, rmsFixed, maxFixed, rmsCal, maxCal,
+			   good ? "" : (built ? (same ? "  FAIL" : "  FAIL (encoding)") : "  FAIL (build)"));
+	}
+	return ok;
+}
+
+////////////////////////////////////////
+// Part 2: through ComputerCard
+
+static const unsigned hostWideWidths[4] = {7, 10, 8, 11};
+static const int hostOffset = 6; // codes added to every reading
+static const uint32_t sweepSamples = 16 * 48000;
+static const uint32_t measureStart = sweepSamples + 4800; // once the inputs have settled after unplugging
+static const uint32_t measureSamples = 48000;
+static const double rampStart = 0.5, rampSeconds = 8.0, rampFrom = -1900, rampTo = 1900;
+
+static uint32_t histogram[ADCCalibration::numCodes];
+
+// Settings and results for the next run
+static bool calibrating;
+static bool saved, calibratedAtStart;
+static std::vector<int32_t> cvReadings;
+
+class ModelCard : public ComputerCard
+{
+	ADCCalibration cal;
+	int32_t sums[4] = {0, 0, 0, 0};
+	int stage = 0;
+
+public:
+	ModelCard()
+	{
+		calibratedAtStart = ADCCalibrated();
+		if (calibrating)
+		{
+			UseADCCalibration(nullptr);
+			CaptureADC(CV1, histogram);
+		}
+	}
+
+protected:
+	virtual void ProcessSample()
+	{
+		uint32_t t = SampleCount();
+		if (!calibrating)
+		{
+			cvReadings.push_back(CVIn1());
+			return;
+		}
+		if (t >= measureStart && t < measureStart + measureSamples)
+		{
+			sums[0] += AudioIn1();
+			sums[1] += AudioIn2();
+			sums[2] += CVIn1();
+			sums[3] += CVIn2();
+		}
+	}
+
+	virtual void Background()
+	{
+		if (!calibrating) return;
+		uint32_t t = SampleCount();
+		if (stage == 0 && t >= sweepSamples)
+		{
+			CaptureADC(CV1, nullptr);
+			if (cal.Build(histogram)) UseADCCalibration(&cal);
+			stage = 1;
+		}
+		else if (stage == 1 && t >= measureStart + measureSamples)
+		{
+			for (int i = 0; i < 4; i++) cal.offset[i] = int16_t(sums[i] / int32_t(measureSamples));
+			saved = ADCCalibrated() && SaveADCCalibration(cal);
+			stage = 2;
+		}
+	}
+};
+
+static std::unique_ptr<ModelCard> card;
+
+static int CardMain()
+{
+	card.reset(new ModelCard);
+	card->Run();
+	return 0;
+}
+
+// Run the card with the given EEPROM contents, which are updated from the emulated EEPROM afterwards
+static void RunCard(uint8_t *eeprom, double seconds)
+{
+	cchost::HostDriver driver;
+	if (calibrating)
+	{
+		// Sweep from CV out 1 (modelled here as a ramp), then unplug
+		driver.automation.Add(cchost::CV1, 0, -2048, false);
+		driver.automation.Add(cchost::CV1, sweepSamples / 48000.0, 2047, true);
+		driver.automation.Add(cchost::PlugCV1, 0, 1, false);
+		driver.automation.Add(cchost::PlugCV1, sweepSamples / 48000.0, 0, false);
+	}
+	else
+	{
+		driver.automation.Add(cchost::CV1, rampStart, rampFrom, false);
+		driver.automation.Add(cchost::CV1, rampStart + rampSeconds, rampTo, true);
+		driver.automation.Add(cchost::PlugCV1, 0, 0, false);
+		driver.automation.Add(cchost::PlugCV1, rampStart, 1, false);
+	}
+	cchost::HostOptions opts;
+	opts.outAudio = "";
+	opts.seconds = seconds;
+	std::string error;
+	if (!driver.Open(opts, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		exit(1);
+	}
+	memcpy(driver.state.eeprom, eeprom, sizeof(driver.state.eeprom));
+
+	// Wide codes: the input levels of several codes read as one, and the codes above are reached later.
+	// An offset moves every reading up a few codes.
+	int code = hostOffset, left = 1;
+	for (int level = 0; level < 4096; level++)
+	{
+		driver.state.adcTransfer[level] = uint16_t(std::min(code, 4095));
+		if (--left == 0)
+		{
+			code++;
+			const unsigned *w = std::find(wideCodes, wideCodes + 4, unsigned(code));
+			left = w != wideCodes + 4 ? int(hostWideWidths[w - wideCodes]) : 1;
+		}
+	}
+
+	driver.Run(CardMain);
+	driver.Close();
+	memcpy(eeprom, driver.state.eeprom, sizeof(driver.state.eeprom));
+}
+
+// Check run: offset with no cable, and error of readings of the ramp
+static void CheckReadings(const char *name, double *offset, double *rms, double *maxError)
+{
+	const double rate = 48000;
+	double sum = 0;
+	unsigned n = 0;
+	std::vector<double> x, y;
+	for (size_t i = 0; i < cvReadings.size(); i++)
+	{
+		double t = i / rate;
+		if (t > 0.1 && t < rampStart)
+		{
+			sum += cvReadings[i];
+			n++;
+		}
+		// Leave time for the CV input filter to settle at the start of the ramp
+		if (t > rampStart + 0.05 && t < rampStart + rampSeconds)
+		{
+			x.push_back(rampFrom + (rampTo - rampFrom) * (t - rampStart) / rampSeconds);
+			y.push_back(cvReadings[i]);
+		}
+	}
+	*offset = sum / n;
+	*rms = LineError(x, y, maxError);
+	printf("%-26s  %+6.2f  %14.2f / %5.2f\n", name, *offset, *rms, *maxError);
+}
+
+static bool ModelHost()
+{
+	printf("\nPart 2: ComputerCard on emulated hardware, wide codes %u %u %u %u codes wide, offset %+d\n",
+		   hostWideWidths[0], hostWideWidths[1], hostWideWidths[2], hostWideWidths[3], hostOffset);
+
+	static uint8_t eeprom[2048];
+	memset(eeprom, 0xFF, sizeof(eeprom));
+	calibrating = true;
+	RunCard(eeprom, (measureStart + measureSamples + 4800) / 48000.0);
+	printf("Calibration saved to EEPROM: %s\n", saved ? "yes" : "no");
+
+	printf("%-26s  %6s  %23s\n", "", "offset", "ramp RMS / max error");
+	calibrating = false;
+	double offsetCal, rmsCal, maxCal, offsetRaw, rmsRaw, maxRaw;
+	cvReadings.clear();
+	RunCard(eeprom, rampStart + rampSeconds + 0.1);
+	bool loaded = calibratedAtStart;
+	CheckReadings(loaded ? "calibrated (from EEPROM)" : "NOT loaded from EEPROM", &offsetCal, &rmsCal, &maxCal);
+
+	static uint8_t empty[2048];
+	memset(empty, 0xFF, sizeof(empty));
+	cvReadings.clear();
+	RunCard(empty, rampStart + rampSeconds + 0.1);
+	CheckReadings("fixed DNL correction", &offsetRaw, &rmsRaw, &maxRaw);
+
+	return saved && loaded && fabs(offsetCal) < 1 && rmsCal < 1.0 && rmsCal < rmsRaw;
+}
+
+int main()
+{
+	bool ok = ModelUnits();
+	ok = ModelHost() && ok;
+	if (!ok) printf("FAIL\n");
+	return ok ? 0 : 1;
+}
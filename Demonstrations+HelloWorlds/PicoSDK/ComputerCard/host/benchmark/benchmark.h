@@ -0,0 +1,204 @@
+/*
+Shared definitions for card_benchmark (see card_benchmark.cpp),
+golden_render (see golden_render.cpp), patch_sim (see patch_sim.cpp),
+headroom_report (see headroom_report.cpp), card_fuzz (see card_fuzz.cpp)
+and memory_report (see memory_report.cpp).
+
+Each benchmark registers itself with a static BenchmarkRegistration, and
+is run by card_benchmark for a given length of emulated time. It returns
+the host time per sample taken by the card's DSP or, for cards run
+through ComputerCard, the time per sample of the whole audio interrupt
+and of the interrupt of a card doing nothing.
+
+Each released card built on ComputerCard also registers its main function
+with a static CardRegistration, for the other programs. The DSP of the
+released cards not built on ComputerCard is run directly, by RunDSP (see
+dsp_card.cpp).
+*/
+
+#ifndef CARD_BENCHMARK_H
+#define CARD_BENCHMARK_H
+
+#include "host_driver.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	// One run of a benchmark. Directly timed DSP gives nsPerSample; cards run through ComputerCard give the
+	// interrupt times of the card and of a card doing nothing, from which card_benchmark finds nsPerSample.
+	struct Measurement
+	{
+		double nsPerSample = 0;
+		double interruptNsPerSample = 0;      // whole audio interrupt, or 0 if not run through ComputerCard
+		double emptyInterruptNsPerSample = 0; // audio interrupt with an empty ProcessSample
+	};
+
+	struct Benchmark
+	{
+		const char *name;
+		Measurement (*run)(int arg, double seconds);
+		int arg; // passed to run, e.g. an oscillator shape
+	};
+
+	inline std::vector<Benchmark> &Registry()
+	{
+		static std::vector<Benchmark> benchmarks;
+		return benchmarks;
+	}
+
+	struct BenchmarkRegistration
+	{
+		BenchmarkRegistration(const char *name, Measurement (*run)(int, double), int arg = 0)
+		{
+			Registry().push_back({name, run, arg});
+		}
+	};
+
+	// A released card built on ComputerCard, and its main function (see card.cpp)
+	struct Card
+	{
+		const char *name;
+		int (*main)();
+		const char *dir; // directory of its source, for headroom_report, or null
+	};
+
+	inline std::vector<Card> &Cards()
+	{
+		static std::vector<Card> cards;
+		return cards;
+	}
+
+	struct CardRegistration
+	{
+		CardRegistration(const char *name, int (*main)(), const char *dir = nullptr)
+		{
+			Cards().push_back({name, main, dir});
+		}
+	};
+
+	// A released card not built on ComputerCard, whose DSP is run directly (see dsp_card.cpp)
+	struct DSPCard
+	{
+		const char *name;
+		cchost::DSP *(*create)();
+		int samplesPerCall; // samples rendered by each call of its DSP
+	};
+
+	// Twists and Reverb, by name
+	const std::vector<DSPCard> &DSPCards();
+
+	// Fixed input automation used for every card: knobs sweep across their range, the switch visits
+	// each position, audio and CV inputs receive triangle waves, and the pulse inputs are clocked.
+	// Every jack is plugged in.
+	inline void SetInputs(cchost::Automation &a, double seconds)
+	{
+		using namespace cchost;
+		a.Add(Main, 0, 0, false);
+		a.Add(Main, seconds, 4095, true);
+		a.Add(X, 0, 4095, false);
+		a.Add(X, seconds, 0, true);
+		a.Add(Y, 0, 1024, false);
+		a.Add(Y, seconds / 2, 4095, true);
+		a.Add(Y, seconds, 1024, true);
+
+		a.Add(Switch, 0, 1, false);
+		a.Add(Switch, seconds * 0.25, 2, false);
+		a.Add(Switch, seconds * 0.5, 0, false);
+		a.Add(Switch, seconds * 0.55, 1, false);
+
+		// 110Hz and 165Hz audio, 0.5Hz and 2Hz CV
+		const double audioHz[2] = {110, 165}, cvHz[2] = {0.5, 2};
+		for (int i = 0; i < 2; i++)
+		{
+			for (double t = 0; t < seconds; t += 0.5 / audioHz[i])
+			{
+				a.Add(Control(Audio1 + i), t, (int(t * audioHz[i] * 2 + 0.5) & 1) ? -1500 : 1500, t > 0);
+			}
+			for (double t = 0; t < seconds; t += 0.5 / cvHz[i])
+			{
+				a.Add(Control(CV1 + i), t, (int(t * cvHz[i] * 2 + 0.5) & 1) ? -2000 : 2000, t > 0);
+			}
+		}
+		a.Add(Pulse1Hz, 0, 8, false);
+		a.Add(Pulse2Hz, 0, 3, false);
+
+		for (int i = 0; i < 6; i++) a.Add(Control(PlugAudio1 + i), 0, 1, false);
+	}
+
+	// Run a card's main function on the emulated hardware for the given emulated time, with the given
+	// input automation, and return the host time per sample spent in its audio interrupt. Outputs are
+	// written to the given files, as by the host build's --out-audio, --out-cv and --out-events, or not
+	// if empty. If given, cables is also told each sample's outputs (see cchost::PatchCables).
+	inline double RunCard(int (*cardMain)(), const cchost::Automation &automation, double seconds,
+						  const std::string &outAudio = "", const std::string &outCV = "",
+						  const std::string &outEvents = "", cchost::PatchCables *cables = nullptr)
+	{
+		cchost::HostDriver driver;
+		driver.cables = cables;
+
+		// A card constructed before main (e.g. a global) has already set up the hardware, in the default state
+		driver.state = cchost::defaultState;
+
+		driver.automation = automation;
+		cchost::HostOptions opts;
+		opts.outAudio = outAudio;
+		opts.outCV = outCV;
+		opts.outEvents = outEvents;
+		opts.seconds = seconds;
+		std::string error;
+		if (!driver.Open(opts, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			exit(1);
+		}
+		driver.Run(cardMain);
+		driver.Close();
+		uint64_t samples = driver.SamplesRendered();
+		return samples ? double(driver.state.irqHostNs) / double(samples) : 0;
+	}
+
+	// As above, with the inputs above (SetInputs)
+	inline double RunCard(int (*cardMain)(), double seconds, const std::string &outAudio = "",
+						  const std::string &outCV = "", const std::string &outEvents = "",
+						  cchost::PatchCables *cables = nullptr)
+	{
+		cchost::Automation automation;
+		SetInputs(automation, seconds);
+		return RunCard(cardMain, automation, seconds, outAudio, outCV, outEvents, cables);
+	}
+
+	// As RunCard, for DSP run directly at 48kHz
+	inline void RunDSP(cchost::DSP &dsp, const cchost::Automation &automation, double seconds,
+					   const std::string &outAudio = "", const std::string &outCV = "",
+					   const std::string &outEvents = "", cchost::PatchCables *cables = nullptr)
+	{
+		cchost::HostDriver driver;
+		driver.cables = cables;
+		driver.automation = automation;
+		cchost::HostOptions opts;
+		opts.outAudio = outAudio;
+		opts.outCV = outCV;
+		opts.outEvents = outEvents;
+		opts.seconds = seconds;
+		std::string error;
+		if (!driver.Open(opts, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			exit(1);
+		}
+		driver.RunDSP(dsp, 48000);
+		driver.Close();
+	}
+
+	// Host time per sample in the audio interrupt of a card that does nothing in ProcessSample
+	double NullCardInterruptNs(double seconds);
+
+	// Main function of the card above, e.g. to measure what any card built on ComputerCard uses
+	int NullCardMain();
+}
+
+#endif
@@ -0,0 +1,131 @@
+/*
+One released card for card_benchmark, golden_render, patch_sim,
+headroom_report, card_fuzz and memory_report, compiled for each card (see
+add_benchmark_card in host.cmake) with:
+    BENCH_CARD     the card's name, e.g. goldfish
+    BENCH_SOURCE   its source file containing main(), e.g. "main.cpp",
+                   found through the card's directory on the include path
+    BENCH_CHECKED  defined for headroom_report only: the card's int16_t and
+                   int32_t are checked integers (see checked_int.h)
+    BENCH_DIR      with BENCH_CHECKED, the card's directory
+
+The card's source is included unmodified, inside a namespace of its own,
+so that cards' names don't clash. Headers the cards include are included
+first, outside the namespace, so that the cards' own #includes of them do
+nothing. ComputerCard.h, with its implementation, is included first inside
+the namespace, so each card has a ComputerCard of its own, as it would in
+its own firmware, built with the card's feature settings:
+    COMPUTERCARD_*  definitions given to add_benchmark_card in host.cmake,
+                    the same as those the card makes before including
+                    ComputerCard.h (checked below)
+Every card is built on this directory's version of ComputerCard.h. Cards
+still carrying a copy of their own are built on it too, rather than on the
+copy, whose AudioWorker loop never calls tight_loop_contents, so never lets
+emulated time advance. The copies have the same include guard, so are
+skipped.
+
+The card's interrupt time is compared with that of a card doing nothing
+in ProcessSample (see null_card.cpp), to find the time taken by the card's
+own processing.
+*/
+
+#include "benchmark.h"
+#include "pico_host.h"
+
+#include "hardware/adc.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/flash.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/spi.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef BENCH_CHECKED
+#include "checked_int.h"
+#include <array>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#endif
+
+#define BENCH_STRING_(x) #x
+#define BENCH_STRING(x) BENCH_STRING_(x)
+#define BENCH_NAMESPACE_(x) card_##x
+#define BENCH_NAMESPACE(x) BENCH_NAMESPACE_(x)
+
+namespace BENCH_NAMESPACE(BENCH_CARD)
+{
+#include "../../ComputerCard.h"
+
+#ifdef BENCH_CHECKED
+#define int16_t checked::Int<int16_t>
+#define int32_t checked::Int<int32_t>
+#include BENCH_SOURCE
+#undef int16_t
+#undef int32_t
+#else
+#include BENCH_SOURCE
+#endif
+
+	// Settings the card makes itself, which by now have replaced those from host.cmake, must match them
+	static_assert(ComputerCard::Features::normalisationProbe == bool(COMPUTERCARD_NORMALISATION_PROBE) &&
+					  ComputerCard::Features::dnlCorrection == bool(COMPUTERCARD_DNL_CORRECTION) &&
+					  ComputerCard::Features::adcCalibration == bool(COMPUTERCARD_ADC_CALIBRATION) &&
+					  ComputerCard::Features::clampCVOutputs == bool(COMPUTERCARD_CLAMP_CV_OUTPUTS) &&
+					  ComputerCard::Features::preciseCVOrder == COMPUTERCARD_PRECISE_CV &&
+					  ComputerCard::Features::audioDitherMode == COMPUTERCARD_AUDIO_DITHER &&
+					  ComputerCard::Features::audioDecimation == bool(COMPUTERCARD_AUDIO_DECIMATION) &&
+					  ComputerCard::Features::piecewiseCalibration == bool(COMPUTERCARD_PIECEWISE_CALIBRATION),
+				  "card's COMPUTERCARD_* settings differ from those given to add_benchmark_card in host.cmake");
+
+	// Clear the stack that the card's main will use, so that variables the card leaves uninitialised
+	// (e.g. members of a card constructed in main) hold the same values on every run
+	static void __attribute__((noinline)) ClearStack()
+	{
+		volatile uint8_t stack[65536];
+		for (size_t i = 0; i < sizeof(stack); i++) stack[i] = 0;
+	}
+
+	static int CardMain()
+	{
+		ClearStack();
+		main();
+		return 0;
+	}
+
+	static bench::Measurement Run(int, double seconds)
+	{
+		bench::Measurement m;
+		m.interruptNsPerSample = bench::RunCard(CardMain, seconds);
+		m.emptyInterruptNsPerSample = bench::NullCardInterruptNs(seconds);
+		return m;
+	}
+
+	static bench::BenchmarkRegistration registration(BENCH_STRING(BENCH_CARD), Run);
+#ifdef BENCH_CHECKED
+	static bench::CardRegistration cardRegistration(BENCH_STRING(BENCH_CARD), CardMain, BENCH_DIR);
+#else
+	static bench::CardRegistration cardRegistration(BENCH_STRING(BENCH_CARD), CardMain);
+#endif
+}
@@ -0,0 +1,290 @@
+/*
+Benchmark of the DSP of the released cards, on the host.
+
+Cards built on ComputerCard (Benjolin, Bumpers, CVMod, Fifths, Goldfish,
+SlowMod, Talker) run unmodified on the emulated hardware, with the same
+fixed input automation every time (see bench::SetInputs). The host time
+spent in their audio interrupt is measured, less that of a card doing
+nothing on the same version of ComputerCard.h, leaving the time taken by
+the card's own processing. Other DSP cores (reverb_process, each shape of
+Twists' MacroOscillator::Render, Talker's speech synthesis) are timed
+directly (see kernels.cpp).
+
+Results are given as host ns per sample and as an estimate of RP2040
+cycles per sample, scaled from the host time of a reference loop whose
+RP2040 cost is known (see ReferenceLoop), or from one benchmark whose
+RP2040 cost has been measured on hardware (--calibrate). The estimate
+suits integer code: floating-point code is emulated in software on the
+RP2040, so takes many times longer than the estimate.
+
+Usage: card_benchmark [options]
+    --seconds S          emulated time to run each benchmark (default 2)
+    --repeats N          runs of each benchmark, keeping the fastest (default 3)
+    --filter TEXT        only run benchmarks whose names contain TEXT
+    --json FILE          write the results as JSON
+    --compare FILE       compare with results from an earlier --json, and exit
+                         with status 1 if any benchmark has become slower
+    --threshold PERCENT  slowdown reported by --compare (default 10)
+    --calibrate NAME=CYCLES
+                         scale the RP2040 estimates so that benchmark NAME
+                         takes CYCLES cycles per sample
+    --list               list the benchmarks
+
+Comparisons are made relative to the reference loop, so that results from
+a faster or slower host (or a busier one) can still be compared.
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// Reference loop: Cortex-M0+ takes about referenceCycles cycles for each iteration
+// (six shifts and exclusive-ors, a zero-extend, a shift, a single-cycle multiply, an add, and the loop branch)
+static const double referenceCycles = 13;
+
+// Also seeds the loop, so that the compiler can't treat it as a pure function and reuse an earlier result
+static volatile uint32_t sink;
+
+static uint32_t __attribute__((noinline)) ReferenceLoop(uint32_t iterations)
+{
+	uint32_t x = sink | 1, acc = 0;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		acc += (x & 0xFFFF) * (x >> 16);
+	}
+	return acc;
+}
+
+// Host ns per iteration of the reference loop, fastest of several runs
+static double ReferenceNs()
+{
+	const int runs = 5;
+	const uint32_t iterations = 10000000;
+	double best = 0;
+	for (int i = 0; i < runs; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		sink = ReferenceLoop(iterations);
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+		if (i == 0 || ns < best) best = ns;
+	}
+	return best;
+}
+
+struct Result
+{
+	std::string name;
+	bench::Measurement m;
+};
+
+static bool WriteJSON(const char *filename, const std::vector<Result> &results, double seconds, int repeats,
+					  double referenceNs, double cyclesPerNs)
+{
+	FILE *f = fopen(filename, "w");
+	if (!f) return false;
+	fprintf(f, "{\n  \"seconds\": %g,\n  \"repeats\": %d,\n  \"referenceNs\": %.4f,\n  \"rp2040CyclesPerNs\": %.4f,\n  \"results\": [\n",
+			seconds, repeats, referenceNs, cyclesPerNs);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result &r = results[i];
+		fprintf(f, "    {\"name\": \"%s\", \"nsPerSample\": %.3f, \"interruptNsPerSample\": %.3f, \"rp2040Cycles\": %.0f}%s\n",
+				r.name.c_str(), r.m.nsPerSample, r.m.interruptNsPerSample, r.m.nsPerSample * cyclesPerNs,
+				i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	return fclose(f) == 0;
+}
+
+// Number following "key": at or after p, or -1 if none
+static double JSONNumber(const char *p, const char *key)
+{
+	std::string quoted = std::string("\"") + key + "\":";
+	const char *k = strstr(p, quoted.c_str());
+	return k ? atof(k + quoted.size()) : -1;
+}
+
+// Read results written by WriteJSON: names and ns per sample, and the reference time
+static bool ReadJSON(const char *filename, std::map<std::string, double> &nsPerSample, double &referenceNs)
+{
+	FILE *f = fopen(filename, "r");
+	if (!f) return false;
+	std::string text;
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+	fclose(f);
+
+	referenceNs = JSONNumber(text.c_str(), "referenceNs");
+	const char *p = text.c_str();
+	while ((p = strstr(p, "\"name\": \"")) != nullptr)
+	{
+		p += strlen("\"name\": \"");
+		const char *end = strchr(p, '"');
+		if (!end) break;
+		nsPerSample[std::string(p, end)] = JSONNumber(end, "nsPerSample");
+		p = end;
+	}
+	return referenceNs > 0;
+}
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr,
+			"Usage: %s [--seconds S] [--repeats N] [--filter TEXT] [--json FILE]\n"
+			"       [--compare FILE] [--threshold PERCENT] [--calibrate NAME=CYCLES] [--list]\n",
+			prog);
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 2, threshold = 10;
+	int repeats = 3;
+	const char *filter = "", *jsonFile = nullptr, *compareFile = nullptr;
+	std::string calibrateName;
+	double calibrateCycles = 0;
+	bool list = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!strcmp(a, "--list"))
+		{
+			list = true;
+			continue;
+		}
+		if (!v)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		if (!strcmp(a, "--seconds")) seconds = atof(v);
+		else if (!strcmp(a, "--repeats")) repeats = atoi(v);
+		else if (!strcmp(a, "--filter")) filter = v;
+		else if (!strcmp(a, "--json")) jsonFile = v;
+		else if (!strcmp(a, "--compare")) compareFile = v;
+		else if (!strcmp(a, "--threshold")) threshold = atof(v);
+		else if (!strcmp(a, "--calibrate") && strchr(v, '='))
+		{
+			calibrateName = std::string(v, strchr(v, '='));
+			calibrateCycles = atof(strchr(v, '=') + 1);
+		}
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+	if (seconds <= 0 || repeats < 1)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<bench::Benchmark> benchmarks = bench::Registry();
+	std::stable_sort(benchmarks.begin(), benchmarks.end(),
+					 [](const bench::Benchmark &a, const bench::Benchmark &b) { return strcmp(a.name, b.name) < 0; });
+	if (list)
+	{
+		for (const bench::Benchmark &b : benchmarks) printf("%s\n", b.name);
+		return 0;
+	}
+
+	std::map<std::string, double> baseline;
+	double baselineReferenceNs = 0;
+	if (compareFile && !ReadJSON(compareFile, baseline, baselineReferenceNs))
+	{
+		fprintf(stderr, "cannot read results from %s\n", compareFile);
+		return 1;
+	}
+
+	double referenceNs = ReferenceNs();
+
+	std::vector<Result> results;
+	for (const bench::Benchmark &b : benchmarks)
+	{
+		if (!strstr(b.name, filter)) continue;
+		Result r;
+		r.name = b.name;
+		// Fastest of each time, as anything else running on the host only slows the benchmark down
+		for (int i = 0; i < repeats; i++)
+		{
+			bench::Measurement m = b.run(b.arg, seconds);
+			if (i == 0 || m.nsPerSample < r.m.nsPerSample) r.m.nsPerSample = m.nsPerSample;
+			if (i == 0 || m.interruptNsPerSample < r.m.interruptNsPerSample) r.m.interruptNsPerSample = m.interruptNsPerSample;
+			if (i == 0 || m.emptyInterruptNsPerSample < r.m.emptyInterruptNsPerSample) r.m.emptyInterruptNsPerSample = m.emptyInterruptNsPerSample;
+		}
+		if (r.m.interruptNsPerSample > 0) r.m.nsPerSample = std::max(0.0, r.m.interruptNsPerSample - r.m.emptyInterruptNsPerSample);
+		results.push_back(r);
+	}
+
+	double cyclesPerNs = referenceCycles / referenceNs;
+	if (!calibrateName.empty())
+	{
+		auto r = std::find_if(results.begin(), results.end(), [&](const Result &r) { return r.name == calibrateName; });
+		if (r == results.end() || r->m.nsPerSample <= 0)
+		{
+			fprintf(stderr, "cannot calibrate: no result for %s\n", calibrateName.c_str());
+			return 1;
+		}
+		cyclesPerNs = calibrateCycles / r->m.nsPerSample;
+	}
+
+	printf("Reference loop %.3fns per iteration; RP2040 estimate %.2f cycles per host ns%s\n",
+		   referenceNs, cyclesPerNs, calibrateName.empty() ? "" : " (calibrated)");
+	printf("%-28s  %10s  %14s  %13s", "benchmark", "ns/sample", "interrupt ns", "RP2040 cycles");
+	if (compareFile) printf("  %9s", "change");
+	printf("\n");
+
+	int regressions = 0;
+	for (const Result &r : results)
+	{
+		printf("%-28s  %10.2f  ", r.name.c_str(), r.m.nsPerSample);
+		if (r.m.interruptNsPerSample > 0) printf("%14.2f", r.m.interruptNsPerSample);
+		else printf("%14s", "-");
+		printf("  %13.0f", r.m.nsPerSample * cyclesPerNs);
+
+		if (compareFile)
+		{
+			auto base = baseline.find(r.name);
+			if (base == baseline.end() || base->second < 0)
+			{
+				printf("  %9s", "new");
+			}
+			else
+			{
+				// Relative to the reference loop, as the hosts may differ.
+				// Times of a few ns are mostly timing noise, so aren't judged.
+				double now = r.m.nsPerSample / referenceNs, then = base->second / baselineReferenceNs;
+				double change = then > 0 ? 100.0 * (now / then - 1) : 0;
+				bool slower = change > threshold && r.m.nsPerSample > 2 && base->second > 2;
+				printf("  %+8.1f%%%s", change, slower ? "  SLOWER" : "");
+				if (slower) regressions++;
+			}
+		}
+		printf("\n");
+	}
+
+	if (jsonFile && !WriteJSON(jsonFile, results, seconds, repeats, referenceNs, cyclesPerNs))
+	{
+		fprintf(stderr, "cannot write %s\n", jsonFile);
+		return 1;
+	}
+	if (regressions)
+	{
+		printf("%d benchmark%s slower than %s by more than %g%%\n", regressions, regressions > 1 ? "s" : "", compareFile, threshold);
+		return 1;
+	}
+	return 0;
+}
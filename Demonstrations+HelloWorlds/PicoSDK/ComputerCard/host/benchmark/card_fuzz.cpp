@@ -0,0 +1,688 @@
+/*
+Input fuzzer for the released cards, looking for calls to their DSP that
+take far longer than usual (performance cliffs), before they cause audio
+dropouts on hardware.
+
+Each target is run with randomly generated control scripts (see
+host_driver.h): knobs held, stepped, swept, or chattering between their
+extremes; the switch changing or chattering, including momentary down
+presses; audio and CV inputs silent, at DC, as full-scale square or
+triangle waves of any frequency up to 12kHz, or as noise; pulse inputs
+clocked at up to 24kHz, toggled at random, or in bursts; and jacks plugged
+and unplugged.
+
+Targets are the cards built on ComputerCard (see card.cpp), whose calls
+are their audio interrupts, timed by the host emulation, and the DSP of
+Twists (MacroOscillator::Render, one call per block of 24 samples, with
+the shape set by the main knob) and Reverb (reverb_process, one call per
+sample, with its input from the difference of the audio inputs), run
+directly (see dsp_card.cpp) and timed around each call.
+
+Each script is run --repeats times, each run in a process of its own, and
+each call's time is the fastest of its runs, so that the host's own
+interruptions aren't mistaken for slow calls. Each run's process first
+touches all of its writable memory, so that its first write to each page
+(copying the page from the parent process) isn't timed as part of a call.
+Calls in the first --warmup seconds, which run with cold caches and may
+include a card's one-off initialisation, are ignored. The slowest calls are listed
+with the times of the typical (median) call, and the slowest is reduced to
+a minimal reproducer: the script is cut to end shortly after that call,
+then keyframes are removed, a chunk at a time, as long as a call of at
+least --keep of the slowest time remains. The reproducer is written to
+DIR/TARGET.txt, as a control script that card_fuzz --replay can run again
+(as can a card's host build, with --script).
+
+Usage: card_fuzz [options] [TARGET...]
+    --scripts N     random scripts per target (default 16)
+    --seconds S     length of each script (default 0.5)
+    --repeats N     runs of each script, keeping each call's fastest time
+                    (default 3)
+    --seed N        seed for the scripts (default 1)
+    --top N         slowest calls to list (default 5)
+    --keep F        fraction of the slowest time a reduced script must
+                    still reach (default 0.7)
+    --trials N      most runs of reduced scripts (default 60)
+    --warmup S      time at the start of each run whose calls are ignored
+                    (default 0.01)
+    --out DIR       directory for reproducers (default fuzz)
+    --replay FILE   run a script (e.g. a reproducer) instead of fuzzing
+    --list          list the targets
+
+Times are host times: card_benchmark relates them to RP2040 cycles.
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+typedef std::vector<std::string> Script; // lines of a control script
+
+static const char *controlNames[cchost::NumControls] = {
+	"main", "x", "y", "switch",
+	"audio1", "audio2", "cv1", "cv2", "pulse1", "pulse2",
+	"pulse1.hz", "pulse2.hz",
+	"plug.audio1", "plug.audio2", "plug.cv1", "plug.cv2", "plug.pulse1", "plug.pulse2"};
+
+static const double scriptRate = 48000; // for times in samples in generated scripts
+
+////////////////////////////////////////
+// Script generation
+
+// splitmix64
+class Random
+{
+public:
+	explicit Random(uint64_t seed) : state(seed) {}
+
+	uint64_t Next()
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	double Uniform() { return double(Next() >> 11) / double(1ull << 53); } // [0, 1)
+	int Int(int n) { return int(Uniform() * n); }                           // [0, n)
+	int Range(int lo, int hi) { return lo + Int(hi - lo + 1); }             // [lo, hi]
+
+	// Log-uniform between lo and hi
+	double Log(double lo, double hi) { return lo * std::pow(hi / lo, Uniform()); }
+
+private:
+	uint64_t state;
+};
+
+static std::string Line(double seconds, cchost::Control c, double value, bool ramp = false)
+{
+	char buf[96];
+	snprintf(buf, sizeof(buf), "%.6f %s %g%s", seconds, controlNames[c], value, ramp ? " ramp" : "");
+	return buf;
+}
+
+// A window of the script: a random start, and a length of up to maxSeconds
+static void Window(Random &r, double seconds, double maxSeconds, double &start, double &end)
+{
+	start = r.Uniform() * seconds;
+	end = std::min(seconds, start + r.Uniform() * maxSeconds);
+}
+
+// Alternate between two values every period seconds, through a window
+static void Chatter(Random &r, Script &s, cchost::Control c, double seconds, double a, double b, double period)
+{
+	double start, end;
+	Window(r, seconds, 0.05, start, end);
+	int i = 0;
+	for (double t = start; t < end && i < 4000; t += period, i++) s.push_back(Line(t, c, i & 1 ? b : a));
+}
+
+static void Knob(Random &r, Script &s, cchost::Control c, double seconds)
+{
+	switch (r.Int(4))
+	{
+	case 0: // held
+		s.push_back(Line(0, c, r.Range(0, 4095)));
+		break;
+	case 1: // stepped, or ramped, to random values
+		for (int i = r.Range(1, 20); i > 0; i--) s.push_back(Line(r.Uniform() * seconds, c, r.Range(0, 4095), r.Int(2)));
+		break;
+	case 2: // swept from one end to the other
+	{
+		double start, end;
+		Window(r, seconds, seconds, start, end);
+		bool up = r.Int(2);
+		s.push_back(Line(start, c, up ? 0 : 4095));
+		s.push_back(Line(end, c, up ? 4095 : 0, true));
+		break;
+	}
+	default: // chattering between its ends
+		Chatter(r, s, c, seconds, 0, 4095, r.Range(1, 64) / scriptRate);
+		break;
+	}
+}
+
+static void Switch(Random &r, Script &s, double seconds)
+{
+	switch (r.Int(3))
+	{
+	case 0:
+		s.push_back(Line(0, cchost::Switch, r.Int(3)));
+		break;
+	case 1:
+		for (int i = r.Range(1, 10); i > 0; i--) s.push_back(Line(r.Uniform() * seconds, cchost::Switch, r.Int(3)));
+		break;
+	default: // chattering, e.g. held down and released repeatedly
+	{
+		int a = r.Int(3), b = (a + r.Range(1, 2)) % 3;
+		Chatter(r, s, cchost::Switch, seconds, a, b, r.Range(1, 480) / scriptRate);
+		break;
+	}
+	}
+}
+
+static void Signal(Random &r, Script &s, cchost::Control c, double seconds)
+{
+	switch (r.Int(4))
+	{
+	case 0: // silent
+		break;
+	case 1: // DC, often at full scale
+		s.push_back(Line(0, c, r.Int(2) ? (r.Int(2) ? 2047 : -2048) : r.Range(-2048, 2047)));
+		break;
+	case 2: // square or triangle wave, often at full scale
+	{
+		double hz = r.Log(1, 12000), amplitude = r.Int(2) ? 2047 : r.Range(1, 2047);
+		bool ramp = r.Int(2);
+		double start, end;
+		Window(r, seconds, seconds, start, end);
+		int i = 0;
+		for (double t = start; t < end && i < 4000; t += 0.5 / hz, i++) s.push_back(Line(t, c, i & 1 ? -amplitude : amplitude, ramp && i));
+		break;
+	}
+	default: // noise
+	{
+		double period = r.Range(1, 8) / scriptRate, start, end;
+		Window(r, seconds, 0.02, start, end);
+		for (double t = start; t < end; t += period) s.push_back(Line(t, c, r.Range(-2048, 2047)));
+		break;
+	}
+	}
+}
+
+static void Pulse(Random &r, Script &s, int i, double seconds)
+{
+	cchost::Control pulse = cchost::Control(cchost::Pulse1 + i), hz = cchost::Control(cchost::Pulse1Hz + i);
+	switch (r.Int(4))
+	{
+	case 0: // none
+		break;
+	case 1: // clocked
+		s.push_back(Line(0, hz, std::round(r.Log(0.5, 24000) * 10) / 10));
+		break;
+	case 2: // toggled at random
+		for (int n = r.Range(1, 40); n > 0; n--) s.push_back(Line(r.Uniform() * seconds, pulse, r.Int(2)));
+		break;
+	default: // burst of toggles
+		Chatter(r, s, pulse, seconds, 1, 0, r.Range(1, 8) / scriptRate);
+		break;
+	}
+}
+
+static Script Generate(Random &r, double seconds)
+{
+	Script s;
+	for (int c = cchost::Main; c <= cchost::Y; c++) Knob(r, s, cchost::Control(c), seconds);
+	Switch(r, s, seconds);
+	for (int c = cchost::Audio1; c <= cchost::CV2; c++) Signal(r, s, cchost::Control(c), seconds);
+	for (int i = 0; i < 2; i++) Pulse(r, s, i, seconds);
+
+	// Mostly plugged in, sometimes removed or inserted part way through
+	for (int c = cchost::PlugAudio1; c <= cchost::PlugPulse2; c++)
+	{
+		bool plugged = r.Uniform() < 0.85;
+		s.push_back(Line(0, cchost::Control(c), plugged));
+		if (r.Uniform() < 0.1) s.push_back(Line(r.Uniform() * seconds, cchost::Control(c), !plugged));
+	}
+	return s;
+}
+
+static bool Parse(const Script &s, cchost::Automation &a, std::string &error)
+{
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		if (!a.ParseLine(s[i], "line " + std::to_string(i + 1) + ": ", error)) return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+// Targets
+
+// Host times of each call of a run, in memory shared with the process making the run
+class CallTimes
+{
+public:
+	explicit CallTimes(uint64_t capacity) : capacity(capacity)
+	{
+		bytes = sizeof(uint64_t) + capacity * sizeof(float);
+		void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		base = p == MAP_FAILED ? nullptr : static_cast<uint8_t *>(p);
+	}
+
+	~CallTimes()
+	{
+		if (base) munmap(base, bytes);
+	}
+
+	bool IsOpen() const { return base != nullptr; }
+
+	void Set(uint64_t call, double ns)
+	{
+		if (call >= capacity) return;
+		reinterpret_cast<float *>(base + sizeof(uint64_t))[call] = float(ns);
+		Count() = std::max(Count(), call + 1);
+	}
+
+	uint64_t &Count() { return *reinterpret_cast<uint64_t *>(base); }
+	const float *Times() const { return reinterpret_cast<const float *>(base + sizeof(uint64_t)); }
+
+	const uint64_t capacity;
+
+private:
+	uint8_t *base;
+	size_t bytes;
+};
+
+struct Target
+{
+	const char *name;
+	int (*cardMain)();         // a card built on ComputerCard, or
+	const bench::DSPCard *dsp; // DSP run directly
+	int samplesPerCall;
+};
+
+// Each audio interrupt's host time, from the emulation's running total
+class InterruptTimer : public cchost::PatchCables
+{
+public:
+	explicit InterruptTimer(CallTimes &times) : times(times) {}
+
+	void Inputs(uint64_t, cchost::Inputs &) override {}
+
+	void Outputs(uint64_t sample, const cchost::OutputValues &) override
+	{
+		uint64_t total = cchost::currentDriver->state.irqHostNs;
+		times.Set(sample, double(total - last));
+		last = total;
+	}
+
+private:
+	CallTimes &times;
+	uint64_t last = 0;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double NsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Each call's host time, for DSP run directly. A call renders samplesPerCall samples.
+class DSPTimer : public cchost::DSP
+{
+public:
+	DSPTimer(cchost::DSP &dsp, int samplesPerCall, CallTimes &times) : dsp(dsp), samplesPerCall(samplesPerCall), times(times) {}
+
+	void Process(const cchost::Inputs &in, cchost::OutputValues &out) override
+	{
+		auto start = Clock::now();
+		dsp.Process(in, out);
+		double ns = NsSince(start);
+		// Only the last sample of each call's samples makes the call
+		if (++sample % samplesPerCall == 0) times.Set(sample / samplesPerCall - 1, ns);
+	}
+
+private:
+	cchost::DSP &dsp;
+	const int samplesPerCall;
+	CallTimes &times;
+	uint64_t sample = 0;
+};
+
+static std::vector<Target> Targets()
+{
+	std::vector<Target> targets;
+	for (const bench::Card &c : bench::Cards()) targets.push_back({c.name, c.main, nullptr, 1});
+	for (const bench::DSPCard &d : bench::DSPCards()) targets.push_back({d.name, nullptr, &d, d.samplesPerCall});
+	std::sort(targets.begin(), targets.end(), [](const Target &a, const Target &b) { return strcmp(a.name, b.name) < 0; });
+	return targets;
+}
+
+////////////////////////////////////////
+// Runs
+
+// Write to every page of the process's private writable memory, so that pages shared with the parent
+// process after fork are copied now, rather than during a timed call
+static void Prefault()
+{
+	std::ifstream maps("/proc/self/maps");
+	std::string line;
+	while (std::getline(maps, line))
+	{
+		std::istringstream fields(line);
+		std::string range, perms;
+		fields >> range >> perms;
+		if (perms.size() < 4 || perms[0] != 'r' || perms[1] != 'w' || perms[3] != 'p') continue;
+		uintptr_t start = std::stoull(range.substr(0, range.find('-')), nullptr, 16);
+		uintptr_t end = std::stoull(range.substr(range.find('-') + 1), nullptr, 16);
+		for (uintptr_t page = start; page < end; page += 4096)
+		{
+			volatile uint8_t *p = reinterpret_cast<volatile uint8_t *>(page);
+			*p = *p;
+		}
+	}
+}
+
+// One run of a script, in a child process, so that it starts from the same state as every other run
+static bool RunOnce(const Target &target, const Script &script, double seconds, CallTimes &times)
+{
+	times.Count() = 0;
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) return false;
+	if (pid == 0)
+	{
+		cchost::Automation automation;
+		std::string error;
+		if (!Parse(script, automation, error)) _exit(1);
+		Prefault();
+		if (target.cardMain)
+		{
+			InterruptTimer timer(times);
+			bench::RunCard(target.cardMain, automation, seconds, "", "", "", &timer);
+		}
+		else
+		{
+			std::unique_ptr<cchost::DSP> dsp(target.dsp->create());
+			DSPTimer timer(*dsp, target.samplesPerCall, times);
+			bench::RunDSP(timer, automation, seconds);
+		}
+		_exit(0);
+	}
+	int status;
+	return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Each call's fastest time over several runs
+static std::vector<float> Measure(const Target &target, const Script &script, double seconds, int repeats, CallTimes &times)
+{
+	std::vector<float> best;
+	for (int i = 0; i < repeats; i++)
+	{
+		if (!RunOnce(target, script, seconds, times))
+		{
+			fprintf(stderr, "%s failed to run\n", target.name);
+			exit(1);
+		}
+		size_t n = size_t(std::min(times.Count(), times.capacity));
+		if (i == 0) best.assign(times.Times(), times.Times() + n);
+		for (size_t c = 0; c < std::min(n, best.size()); c++) best[c] = std::min(best[c], times.Times()[c]);
+	}
+	return best;
+}
+
+// Slowest call after the first
+static size_t Slowest(const std::vector<float> &calls, size_t first)
+{
+	if (first >= calls.size()) return calls.size();
+	return size_t(std::max_element(calls.begin() + first, calls.end()) - calls.begin());
+}
+
+// Median call after the first
+static double Median(const std::vector<float> &calls, size_t first)
+{
+	if (first >= calls.size()) return 0;
+	std::vector<float> v(calls.begin() + first, calls.end());
+	std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+	return v[v.size() / 2];
+}
+
+// A slow call: the script making it, and where
+struct SlowCall
+{
+	size_t script;
+	size_t call;
+	double ns;
+};
+
+static double CallSeconds(const Target &target, size_t call)
+{
+	return double(call) * target.samplesPerCall / scriptRate;
+}
+
+// Calls made in the first given time of a run
+static size_t WarmupCalls(const Target &target, double warmup)
+{
+	return size_t(std::ceil(warmup * scriptRate / target.samplesPerCall));
+}
+
+// Remove keyframes from a script while its slowest call still takes at least slowNs, trying chunks of
+// halving size (delta debugging), with at most maxTrials runs (each of a script's repeats counting)
+static Script Reduce(const Target &target, Script script, double seconds, size_t warmup, double slowNs, int repeats,
+					 int maxTrials, CallTimes &times, int &trials)
+{
+	auto reproduces = [&](const Script &s) {
+		trials += repeats;
+		std::vector<float> calls = Measure(target, s, seconds, repeats, times);
+		size_t c = Slowest(calls, warmup);
+		return c < calls.size() && calls[c] >= slowNs;
+	};
+
+	size_t chunks = 2;
+	while (script.size() >= 1 && trials < maxTrials)
+	{
+		size_t chunk = (script.size() + chunks - 1) / chunks;
+		bool removed = false;
+		for (size_t start = 0; start < script.size() && trials < maxTrials; start += chunk)
+		{
+			Script candidate(script.begin(), script.begin() + start);
+			candidate.insert(candidate.end(), script.begin() + std::min(script.size(), start + chunk), script.end());
+			if (reproduces(candidate))
+			{
+				script = candidate;
+				chunks = std::max<size_t>(chunks - 1, 2);
+				removed = true;
+				break;
+			}
+		}
+		if (removed) continue;
+		if (chunk == 1) break;
+		chunks = std::min(chunks * 2, script.size());
+	}
+	return script;
+}
+
+static bool WriteScript(const std::string &filename, const Script &script, const std::string &header)
+{
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f) return false;
+	fputs(header.c_str(), f);
+	for (const std::string &line : script) fprintf(f, "%s\n", line.c_str());
+	return fclose(f) == 0;
+}
+
+// A script written by WriteScript (or any control script), and its length if given by a "# seconds" line
+static bool ReadScript(const std::string &filename, Script &script, double &seconds)
+{
+	std::ifstream in(filename);
+	if (!in) return false;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		double s;
+		if (sscanf(line.c_str(), "# seconds %lf", &s) == 1) seconds = s;
+		if (!line.empty() && line[0] != '#') script.push_back(line);
+	}
+	return true;
+}
+
+static void PrintCall(const Target &target, const char *where, size_t call, double ns, double typical)
+{
+	printf("    %9.0fns  %6.1fx  %s at %s %zu (%.4fs)\n", ns, typical > 0 ? ns / typical : 0, where,
+		   target.samplesPerCall > 1 ? "call" : "sample", call, CallSeconds(target, call));
+}
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr,
+			"Usage: %s [--scripts N] [--seconds S] [--repeats N] [--seed N] [--top N] [--keep F]\n"
+			"       [--trials N] [--warmup S] [--out DIR] [--replay FILE] [--list] [TARGET...]\n",
+			prog);
+}
+
+int main(int argc, char **argv)
+{
+	int scripts = 16, repeats = 3, top = 5, maxTrials = 60;
+	double seconds = 0.5, keep = 0.7, warmup = 0.01;
+	uint64_t seed = 1;
+	std::string outDir = "fuzz", replayFile;
+	bool list = false;
+	std::vector<std::string> names;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!strcmp(a, "--list")) list = true;
+		else if (a[0] != '-') names.push_back(a);
+		else if (!v)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		else if (!strcmp(a, "--scripts")) scripts = atoi(argv[++i]);
+		else if (!strcmp(a, "--seconds")) seconds = atof(argv[++i]);
+		else if (!strcmp(a, "--repeats")) repeats = atoi(argv[++i]);
+		else if (!strcmp(a, "--seed")) seed = strtoull(argv[++i], nullptr, 0);
+		else if (!strcmp(a, "--top")) top = atoi(argv[++i]);
+		else if (!strcmp(a, "--keep")) keep = atof(argv[++i]);
+		else if (!strcmp(a, "--trials")) maxTrials = atoi(argv[++i]);
+		else if (!strcmp(a, "--warmup")) warmup = atof(argv[++i]);
+		else if (!strcmp(a, "--out")) outDir = argv[++i];
+		else if (!strcmp(a, "--replay")) replayFile = argv[++i];
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (scripts < 1 || seconds <= 0 || repeats < 1 || keep <= 0 || warmup < 0 || warmup >= seconds)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Target> targets = Targets();
+	if (list)
+	{
+		for (const Target &t : targets) printf("%s\n", t.name);
+		return 0;
+	}
+	for (const std::string &name : names)
+	{
+		if (std::none_of(targets.begin(), targets.end(), [&](const Target &t) { return name == t.name; }))
+		{
+			fprintf(stderr, "no target called %s (see --list)\n", name.c_str());
+			return 1;
+		}
+	}
+
+	Script replay;
+	if (!replayFile.empty())
+	{
+		std::string error;
+		cchost::Automation check;
+		if (!ReadScript(replayFile, replay, seconds) || !Parse(replay, check, error))
+		{
+			fprintf(stderr, "cannot read script %s%s%s\n", replayFile.c_str(), error.empty() ? "" : ": ", error.c_str());
+			return 1;
+		}
+	}
+	else
+	{
+		mkdir(outDir.c_str(), 0777);
+	}
+
+	// Room for a card running at up to 96kHz
+	CallTimes times(uint64_t(seconds * 96000) + 1);
+	if (!times.IsOpen())
+	{
+		fprintf(stderr, "cannot map memory for call times\n");
+		return 1;
+	}
+
+	for (const Target &target : targets)
+	{
+		if (!names.empty() && std::find(names.begin(), names.end(), target.name) == names.end()) continue;
+		const size_t first = WarmupCalls(target, warmup);
+
+		if (!replayFile.empty())
+		{
+			std::vector<float> calls = Measure(target, replay, seconds, repeats, times);
+			double typical = Median(calls, first);
+			size_t slowest = Slowest(calls, first);
+			printf("%s: %s, %zu calls, typical %.0fns\n", target.name, replayFile.c_str(), calls.size(), typical);
+			if (slowest < calls.size()) PrintCall(target, "slowest", slowest, calls[slowest], typical);
+			continue;
+		}
+
+		// Run every script, keeping the slowest call of each
+		Random random(seed);
+		std::vector<Script> generated;
+		std::vector<SlowCall> slow;
+		std::vector<float> all;
+		for (int s = 0; s < scripts; s++)
+		{
+			generated.push_back(Generate(random, seconds));
+			std::vector<float> calls = Measure(target, generated.back(), seconds, repeats, times);
+			size_t c = Slowest(calls, first);
+			if (c >= calls.size()) continue;
+			slow.push_back({size_t(s), c, calls[c]});
+			all.insert(all.end(), calls.begin() + first, calls.end());
+		}
+		double typical = Median(all, 0);
+		std::sort(slow.begin(), slow.end(), [](const SlowCall &a, const SlowCall &b) { return a.ns > b.ns; });
+
+		printf("%s: %d scripts of %gs, %zu calls, typical %.0fns\n", target.name, scripts, seconds, all.size(), typical);
+		for (size_t i = 0; i < slow.size() && int(i) < top; i++)
+		{
+			std::string where = "script " + std::to_string(slow[i].script);
+			PrintCall(target, where.c_str(), slow[i].call, slow[i].ns, typical);
+		}
+		if (slow.empty()) continue;
+
+		// Reduce the slowest: first to end shortly after its slow call, then by removing keyframes
+		const SlowCall &worst = slow[0];
+		double length = std::min(seconds, CallSeconds(target, worst.call + 1) + 0.01);
+		int trials = 0;
+		Script reduced =
+			Reduce(target, generated[worst.script], length, first, worst.ns * keep, repeats, maxTrials, times, trials);
+		std::vector<float> calls = Measure(target, reduced, length, repeats, times);
+		size_t c = Slowest(calls, first);
+		const bool found = c < calls.size();
+
+		char header[512];
+		snprintf(header, sizeof(header),
+				 "# card_fuzz reproducer for %s: slowest %s %zu (%.4fs) took %.0fns, %.1fx the typical %.0fns\n"
+				 "# reduced from script %zu of seed %llu (%.0fns); replay with: card_fuzz --replay FILE %s\n"
+				 "# seconds %g\n",
+				 target.name, target.samplesPerCall > 1 ? "call" : "sample", c, CallSeconds(target, c),
+				 found ? calls[c] : 0.0, !found || typical <= 0 ? 0.0 : calls[c] / typical, typical,
+				 worst.script, (unsigned long long)seed, worst.ns, target.name, length);
+		std::string file = outDir + "/" + target.name + ".txt";
+		if (!WriteScript(file, reduced, header))
+		{
+			fprintf(stderr, "cannot write %s\n", file.c_str());
+			return 1;
+		}
+		printf("  reproducer: %zu of %zu keyframes, %gs, in %s (%d runs to reduce)\n", reduced.size(),
+			   generated[worst.script].size(), length, file.c_str(), trials);
+		if (found) PrintCall(target, "reproducer", c, calls[c], typical);
+	}
+	return 0;
+}
@@ -0,0 +1,360 @@
+/*
+Checked integers, for headroom_report (see headroom_report.cpp).
+
+checked::Int<T> stands in for a signed integer type T of up to 32 bits,
+e.g. by compiling a card with int32_t defined as checked::Int<int32_t>.
+It behaves as T, but records what it holds against the place it was
+declared (its Site): the range of values stored in it, the range of the
+results of arithmetic on it, and every wrap, where a value stored in it,
+or the result of arithmetic on it, is outside the range of its type.
+
+The result of arithmetic on checked integers is a checked::Expr, so that
+intermediate results (e.g. a product shifted down before being stored)
+are checked too. Arithmetic is checked in 64 bits, and wraps exactly as
+the unchecked code would. Results of unsigned, 64-bit or floating-point
+type are not checked.
+
+Class members are declared by their class's constructor, as far as the
+Site is concerned, so all of a class's checked members share the Site of
+its constructor. Similarly, a function parameter is declared by the call
+passing it, and a variable initialised with a function's result by the
+function's return statement (the result is constructed in place). Checked
+integers created during constant initialisation (e.g. tables) have no
+Site, and are not recorded.
+*/
+
+#ifndef CHECKED_INT_H
+#define CHECKED_INT_H
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+namespace checked
+{
+	// A place where checked integers are declared, and what they have held
+	struct Site
+	{
+		std::string file;
+		int line;
+		int bits; // width of the type declared
+		int64_t minStored = 0, maxStored = 0; // range of values stored
+		int64_t minExpr = 0, maxExpr = 0;     // range of results of arithmetic on values from here
+		uint64_t wraps = 0;                   // values stored outside the type's range
+		uint64_t exprWraps = 0;               // results of arithmetic outside the result type's range
+	};
+
+	inline std::map<std::tuple<std::string, int, int>, Site> &Sites()
+	{
+		static std::map<std::tuple<std::string, int, int>, Site> sites;
+		return sites;
+	}
+
+	inline Site *FindSite(const char *file, int line, int bits)
+	{
+		Site &s = Sites()[std::make_tuple(std::string(file), line, bits)];
+		if (!s.bits) s = Site{file, line, bits};
+		return &s;
+	}
+
+	// Called for every wrap, e.g. to log it. expr is true for arithmetic, false for a stored value.
+	inline void (*onWrap)(const Site &site, bool expr, int64_t value) = nullptr;
+
+	template <typename T>
+	constexpr bool InRange(int64_t v)
+	{
+		return v >= int64_t(std::numeric_limits<T>::min()) && v <= int64_t(std::numeric_limits<T>::max());
+	}
+
+	template <typename T>
+	inline void Stored(Site *s, int64_t v)
+	{
+		if (!s) return;
+		if (v < s->minStored) s->minStored = v;
+		if (v > s->maxStored) s->maxStored = v;
+		if (!InRange<T>(v))
+		{
+			s->wraps++;
+			if (onWrap) onWrap(*s, false, v);
+		}
+	}
+
+	template <typename T>
+	inline void Computed(Site *s, int64_t v)
+	{
+		if (!s) return;
+		if (v < s->minExpr) s->minExpr = v;
+		if (v > s->maxExpr) s->maxExpr = v;
+		if (!InRange<T>(v))
+		{
+			s->exprWraps++;
+			if (onWrap) onWrap(*s, true, v);
+		}
+	}
+
+	// Value of a floating-point number converted to an integer, limited to 64 bits
+	template <typename U>
+	constexpr int64_t Wide(U x)
+	{
+		if constexpr (std::is_floating_point<U>::value)
+		{
+			if (x >= U(INT64_MAX)) return INT64_MAX;
+			if (x <= U(INT64_MIN)) return INT64_MIN;
+			return int64_t(x);
+		}
+		else
+		{
+			return int64_t(x);
+		}
+	}
+
+	template <typename T>
+	class Int;
+
+	// Result of arithmetic on checked integers, remembering where its left-hand operand was declared
+	template <typename T>
+	class Expr
+	{
+	public:
+		constexpr Expr(T v, Site *site) : v(v), site(site) {}
+		constexpr operator T() const { return v; }
+		T v;
+		Site *site;
+	};
+
+	template <typename A>
+	struct Checked : std::false_type
+	{
+		typedef A type;
+	};
+	template <typename T>
+	struct Checked<Int<T>> : std::true_type
+	{
+		typedef T type;
+	};
+	template <typename T>
+	struct Checked<Expr<T>> : std::true_type
+	{
+		typedef T type;
+	};
+
+	template <typename A>
+	constexpr typename Checked<A>::type Raw(const A &a)
+	{
+		if constexpr (Checked<A>::value) return a.v;
+		else return a;
+	}
+
+	template <typename A>
+	constexpr Site *SiteOf(const A &a)
+	{
+		if constexpr (Checked<A>::value) return a.site;
+		else return nullptr;
+	}
+
+	template <typename T>
+	class Int
+	{
+		static_assert(std::is_signed<T>::value && sizeof(T) <= 4, "checked::Int is for signed types of up to 32 bits");
+
+	public:
+		constexpr Int(const char *file = __builtin_FILE(), int line = __builtin_LINE())
+			: v(0), site(__builtin_is_constant_evaluated() ? nullptr : FindSite(file, line, Bits))
+		{
+		}
+
+		// Not copied from o: the copy is a variable declared here
+		constexpr Int(const Int &o, const char *file = __builtin_FILE(), int line = __builtin_LINE())
+			: v(o.v), site(__builtin_is_constant_evaluated() ? nullptr : FindSite(file, line, Bits))
+		{
+			if (!__builtin_is_constant_evaluated()) Stored<T>(site, o.v);
+		}
+
+		template <typename U, typename = std::enable_if_t<std::is_arithmetic<U>::value || Checked<U>::value>>
+		constexpr Int(const U &x, const char *file = __builtin_FILE(), int line = __builtin_LINE())
+			: v(T(Raw(x))), site(__builtin_is_constant_evaluated() ? nullptr : FindSite(file, line, Bits))
+		{
+			if (!__builtin_is_constant_evaluated()) Stored<T>(site, Wide(Raw(x)));
+		}
+
+		Int &operator=(const Int &o)
+		{
+			v = o.v;
+			Stored<T>(site, o.v);
+			return *this;
+		}
+
+		template <typename U, typename = std::enable_if_t<std::is_arithmetic<U>::value || Checked<U>::value>>
+		Int &operator=(const U &x)
+		{
+			v = T(Raw(x));
+			Stored<T>(site, Wide(Raw(x)));
+			return *this;
+		}
+
+		constexpr operator T() const { return v; }
+
+		template <typename U> Int &operator+=(const U &x) { return *this = *this + x; }
+		template <typename U> Int &operator-=(const U &x) { return *this = *this - x; }
+		template <typename U> Int &operator*=(const U &x) { return *this = *this * x; }
+		template <typename U> Int &operator/=(const U &x) { return *this = *this / x; }
+		template <typename U> Int &operator%=(const U &x) { return *this = *this % x; }
+		template <typename U> Int &operator<<=(const U &x) { return *this = *this << x; }
+		template <typename U> Int &operator>>=(const U &x) { return *this = *this >> x; }
+		template <typename U> Int &operator&=(const U &x) { return *this = *this & x; }
+		template <typename U> Int &operator|=(const U &x) { return *this = *this | x; }
+		template <typename U> Int &operator^=(const U &x) { return *this = *this ^ x; }
+		Int &operator++() { return *this += 1; }
+		Int &operator--() { return *this -= 1; }
+		T operator++(int)
+		{
+			T old = v;
+			*this += 1;
+			return old;
+		}
+		T operator--(int)
+		{
+			T old = v;
+			*this -= 1;
+			return old;
+		}
+
+		T v;
+		Site *site;
+
+	private:
+		static constexpr int Bits = int(sizeof(T) * 8);
+	};
+
+	// Result of a binary operation: checked if a signed type of up to 32 bits, as computed exactly in wide
+	template <typename R, typename A, typename B>
+	constexpr auto Result(const A &a, const B &b, int64_t wide)
+	{
+		if constexpr (std::is_integral<R>::value && std::is_signed<R>::value && sizeof(R) <= 4)
+		{
+			Site *s = SiteOf(a) ? SiteOf(a) : SiteOf(b);
+			if (!__builtin_is_constant_evaluated()) Computed<R>(s, wide);
+			return Expr<R>(R(uint64_t(wide)), s); // wraps as the unchecked arithmetic would
+		}
+		else
+		{
+			return R(wide);
+		}
+	}
+
+	template <typename A, typename B>
+	using EnableChecked = std::enable_if_t<(Checked<A>::value || Checked<B>::value) &&
+										   (Checked<A>::value || std::is_arithmetic<A>::value) &&
+										   (Checked<B>::value || std::is_arithmetic<B>::value)>;
+
+	// Operators whose result can be computed exactly in 64 bits from integer operands
+#define CHECKED_BINARY(op)                                                                       \
+	template <typename A, typename B, typename = EnableChecked<A, B>>                            \
+	constexpr auto operator op(const A &a, const B &b)                                          \
+	{                                                                                            \
+		typedef decltype(Raw(a) op Raw(b)) R;                                                    \
+		if constexpr (std::is_integral<R>::value && std::is_signed<R>::value && sizeof(R) <= 4) \
+			return Result<R>(a, b, int64_t(Raw(a)) op int64_t(Raw(b)));                         \
+		else                                                                                     \
+			return Raw(a) op Raw(b);                                                             \
+	}
+	CHECKED_BINARY(+)
+	CHECKED_BINARY(-)
+	CHECKED_BINARY(*)
+	CHECKED_BINARY(&)
+	CHECKED_BINARY(|)
+	CHECKED_BINARY(^)
+#undef CHECKED_BINARY
+
+	template <typename A, typename B, typename = EnableChecked<A, B>>
+	constexpr auto operator/(const A &a, const B &b)
+	{
+		typedef decltype(Raw(a) / Raw(b)) R;
+		if constexpr (std::is_integral<R>::value && std::is_signed<R>::value && sizeof(R) <= 4)
+			return Result<R>(a, b, Raw(b) ? int64_t(Raw(a)) / int64_t(Raw(b)) : int64_t(Raw(a) / Raw(b)));
+		else
+			return Raw(a) / Raw(b);
+	}
+
+	template <typename A, typename B, typename = EnableChecked<A, B>>
+	constexpr auto operator%(const A &a, const B &b)
+	{
+		typedef decltype(Raw(a) % Raw(b)) R;
+		if constexpr (std::is_integral<R>::value && std::is_signed<R>::value && sizeof(R) <= 4)
+			return Result<R>(a, b, Raw(b) ? int64_t(Raw(a)) % int64_t(Raw(b)) : int64_t(Raw(a) % Raw(b)));
+		else
+			return Raw(a) % Raw(b);
+	}
+
+	// Shifts take the type of the left-hand operand. Left shifts of negative values are
+	// treated as multiplication, as the RP2040's compiler does.
+	template <typename A, typename B, typename = EnableChecked<A, B>>
+	constexpr auto operator<<(const A &a, const B &b)
+	{
+		typedef decltype(Raw(a) << Raw(b)) R;
+		if constexpr (std::is_integral<R>::value && std::is_signed<R>::value && sizeof(R) <= 4)
+		{
+			int n = int(Raw(b));
+			int64_t wide = n >= 0 && n < 32 ? int64_t(Raw(a)) * (int64_t(1) << n) : int64_t(uint64_t(Raw(a)) << (n & 31));
+			return Result<R>(a, b, wide);
+		}
+		else
+		{
+			return Raw(a) << Raw(b);
+		}
+	}
+
+	template <typename A, typename B, typename = EnableChecked<A, B>>
+	constexpr auto operator>>(const A &a, const B &b)
+	{
+		typedef decltype(Raw(a) >> Raw(b)) R;
+		if constexpr (std::is_integral<R>::value && std::is_signed<R>::value && sizeof(R) <= 4)
+			return Result<R>(a, b, int64_t(Raw(a) >> Raw(b)));
+		else
+			return Raw(a) >> Raw(b);
+	}
+
+	template <typename A, typename = std::enable_if_t<Checked<A>::value>>
+	constexpr auto operator-(const A &a)
+	{
+		typedef decltype(-Raw(a)) R;
+		return Result<R>(a, 0, -int64_t(Raw(a)));
+	}
+
+	template <typename A, typename = std::enable_if_t<Checked<A>::value>>
+	constexpr auto operator+(const A &a)
+	{
+		typedef decltype(+Raw(a)) R;
+		return Result<R>(a, 0, int64_t(Raw(a)));
+	}
+
+	template <typename A, typename = std::enable_if_t<Checked<A>::value>>
+	constexpr auto operator~(const A &a)
+	{
+		typedef decltype(~Raw(a)) R;
+		return Result<R>(a, 0, ~int64_t(Raw(a)));
+	}
+
+	// For C sources: memset, but clearing checked integers without losing their Sites
+	template <typename P>
+	void *Fill(P *p, int c, size_t n)
+	{
+		if constexpr (!std::is_trivially_copyable<P>::value)
+		{
+			if (c == 0 && n % sizeof(P) == 0)
+			{
+				for (size_t i = 0; i < n / sizeof(P); i++) p[i] = P();
+				return p;
+			}
+		}
+		return std::memset(static_cast<void *>(p), c, n);
+	}
+}
+
+#endif
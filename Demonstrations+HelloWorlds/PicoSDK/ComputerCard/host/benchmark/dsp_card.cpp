@@ -0,0 +1,122 @@
+/*
+The DSP of the released cards not built on ComputerCard, run directly by
+the host driver in place of a card (see cchost::DSP), for card_fuzz,
+golden_render and patch_sim. Each takes its controls from the knobs,
+switch and jacks as below, at 48kHz.
+
+Twists: MacroOscillator::Render, one call per block of 24 samples, as on
+the card. Main knob: shape; X, Y: timbre and colour; CV input 1: pitch;
+pulse input 1: strike; pulse input 2: sync. As on the card, each block is
+rendered from the controls at the start of the block before it, and the
+sync pulses during it, so the output (audio output 1) is a block behind.
+
+Reverb: reverb_process, one call per sample. Main knob: size; Y: tone;
+switch up: freeze. Its input is the difference of the audio inputs, as the
+card mixes them, and audio outputs 1 and 2 are the wet left and right
+outputs, as the card gives them with its dry/wet control fully wet.
+*/
+
+#include "benchmark.h"
+
+#include "pico/stdlib.h"
+extern "C"
+{
+#include "reverb_dsp.h"
+}
+#include "braids/macro_oscillator.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Static, as on the card, so that the members Init leaves alone start at zero
+	braids::MacroOscillator osc;
+
+	class TwistsDSP : public cchost::DSP
+	{
+	public:
+		static const int blockSize = 24;
+
+		TwistsDSP() { osc.Init(); }
+
+		void Process(const cchost::Inputs &in, cchost::OutputValues &out) override
+		{
+			if (pos == 0)
+			{
+				shape = braids::MacroOscillatorShape(in.knob[0] * braids::MACRO_OSC_SHAPE_LAST / 4096);
+				timbre = int16_t(in.knob[1] * 8);
+				color = int16_t(in.knob[2] * 8);
+				pitch = int16_t((in.cv[0] + 2048) * 4);
+				strike = in.pulse[0] && !lastStrike;
+				lastStrike = in.pulse[0];
+			}
+			sync[pos] = in.pulse[1] && !lastSync;
+			lastSync = in.pulse[1];
+
+			out.audio[0] = buffer[pos] >> 4;
+
+			if (++pos == blockSize)
+			{
+				osc.set_shape(shape);
+				osc.set_parameters(timbre, color);
+				osc.set_pitch(pitch);
+				if (strike) osc.Strike();
+				osc.Render(sync, buffer, blockSize);
+				pos = 0;
+			}
+		}
+
+	private:
+		uint8_t sync[blockSize] = {};
+		int16_t buffer[blockSize] = {};
+		int pos = 0;
+
+		// Controls at the start of the block
+		braids::MacroOscillatorShape shape = braids::MacroOscillatorShape(0);
+		int16_t timbre = 0, color = 0, pitch = 0;
+		bool strike = false, lastStrike = false, lastSync = false;
+	};
+
+	class ReverbDSP : public cchost::DSP
+	{
+	public:
+		ReverbDSP() : v(reverb_create())
+		{
+			if (!v)
+			{
+				fprintf(stderr, "reverb_create failed\n");
+				exit(1);
+			}
+		}
+
+		~ReverbDSP() override { reverb_delete(v); }
+
+		void Process(const cchost::Inputs &in, cchost::OutputValues &out) override
+		{
+			// Freeze fades the input out, and in again, over 256 samples
+			if (in.switchPos == 2 ? freeze > 0 : freeze < 256) freeze += in.switchPos == 2 ? -1 : 1;
+			int32_t mono = (in.audio[0] - in.audio[1]) * 4;
+
+			reverb_set_tilt(v, in.knob[2] * 16);
+			reverb_set_freeze_size(v, std::clamp(((in.knob[0] * 71936) >> 12) - 3200, 50, 65500), freeze);
+			reverb_process(v, (freeze * mono) >> 8);
+			out.audio[0] = std::clamp(reverb_get_left(v) >> 4, -2047, 2047);
+			out.audio[1] = std::clamp(reverb_get_right(v) >> 4, -2047, 2047);
+		}
+
+	private:
+		struct sreverb *v;
+		int32_t freeze = 256;
+	};
+
+	cchost::DSP *CreateTwists() { return new TwistsDSP; }
+	cchost::DSP *CreateReverb() { return new ReverbDSP; }
+}
+
+const std::vector<bench::DSPCard> &bench::DSPCards()
+{
+	static const std::vector<DSPCard> cards = {
+		{"reverb", CreateReverb, 1},
+		{"twists", CreateTwists, TwistsDSP::blockSize}};
+	return cards;
+}
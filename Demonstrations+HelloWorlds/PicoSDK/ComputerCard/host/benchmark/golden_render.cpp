@@ -0,0 +1,569 @@
+/*
+Bit-exact regression check of the released cards, on the host.
+
+Each card built on ComputerCard (see card.cpp), and the DSP of Twists and
+Reverb (see dsp_card.cpp), is rendered, in a process of its own, for a
+fixed length of emulated time with the same input automation as
+card_benchmark (see bench::SetInputs), and its outputs compared with a
+golden file made from an earlier render: audio and CV outputs as 12-bit
+values, pulse outputs, and LED brightnesses, every sample.
+
+A golden file holds a 64-bit hash of each whole output, and a 16-bit hash
+of each output for every block of blockSize samples, so stays small enough
+to keep in the repository. Each render is written in full to the
+--renders directory, as WAV and CSV files like the host build's
+--out-audio, --out-cv and --out-events.
+
+When a render differs, the golden render is made again from the commit
+that last changed its golden file: that commit's ComputerCard and
+releases directories are exported with git to a temporary directory, and
+its golden_render built there with cmake and run. The golden render is
+checked against the golden file, and copied to the --renders directory
+beside the new one. Each output that differs is then reported with the
+exact first sample that differs, its value and the golden value. Without
+git or cmake, with --no-baseline, or if the golden file has uncommitted
+changes, it is reported as the first block that differs.
+
+Usage: golden_render [options] [CARD...]
+    --update          write golden files from the current renders
+    --seconds S       length of renders made with --update (default 2)
+    --golden DIR      directory of golden files (default: golden/ beside this source)
+    --renders DIR     directory for full renders (default golden_renders)
+    --no-baseline     report differences by block, without building the golden render
+    --list            list the cards
+
+Exits with status 1 if any card differs from its golden file, or has none.
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR "golden"
+#endif
+
+static const uint32_t blockSize = 480; // 10ms at 48kHz
+
+enum Output
+{
+	Audio1, Audio2, CV1, CV2, Pulse1, Pulse2,
+	LED0, LED1, LED2, LED3, LED4, LED5,
+	NumOutputs
+};
+
+static const char *outputNames[NumOutputs] = {
+	"audio1", "audio2", "cv1", "cv2", "pulse1", "pulse2",
+	"led0", "led1", "led2", "led3", "led4", "led5"};
+
+// Every output of one render, one value per sample
+struct Render
+{
+	uint32_t rate = 0;
+	std::vector<int16_t> out[NumOutputs];
+
+	uint64_t Samples() const { return out[0].size(); }
+};
+
+// Hashes of a render, as kept in a golden file
+struct Golden
+{
+	double seconds = 0;
+	uint32_t rate = 0;
+	uint64_t samples = 0;
+	uint64_t hash[NumOutputs] = {};
+	std::vector<uint16_t> blocks[NumOutputs];
+};
+
+////////////////////////////////////////
+// Hashing (64-bit FNV-1a, of each value as two little-endian bytes)
+
+static uint64_t Hash(const int16_t *v, size_t n)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < n; i++)
+	{
+		uint16_t u = uint16_t(v[i]);
+		h = (h ^ (u & 0xFF)) * 0x100000001b3ull;
+		h = (h ^ (u >> 8)) * 0x100000001b3ull;
+	}
+	return h;
+}
+
+static uint16_t BlockHash(const std::vector<int16_t> &v, size_t block)
+{
+	size_t start = block * blockSize;
+	uint64_t h = Hash(&v[start], std::min<size_t>(blockSize, v.size() - start));
+	return uint16_t(h ^ (h >> 16) ^ (h >> 32) ^ (h >> 48));
+}
+
+static Golden HashRender(const Render &r, double seconds)
+{
+	Golden g;
+	g.seconds = seconds;
+	g.rate = r.rate;
+	g.samples = r.Samples();
+	for (int o = 0; o < NumOutputs; o++)
+	{
+		g.hash[o] = Hash(r.out[o].data(), r.out[o].size());
+		for (size_t b = 0; b * blockSize < g.samples; b++) g.blocks[o].push_back(BlockHash(r.out[o], b));
+	}
+	return g;
+}
+
+static bool SameHashes(const Golden &a, const Golden &b)
+{
+	if (a.rate != b.rate || a.samples != b.samples) return false;
+	for (int o = 0; o < NumOutputs; o++)
+	{
+		if (a.hash[o] != b.hash[o]) return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+// Renders, as the files written by the host driver
+
+static std::string AudioFile(const std::string &base) { return base + ".audio.wav"; }
+static std::string CVFile(const std::string &base) { return base + ".cv.wav"; }
+static std::string EventsFile(const std::string &base) { return base + ".events.csv"; }
+
+static bool LoadRender(const std::string &base, Render &r, std::string &error)
+{
+	cchost::WavReader audio, cv;
+	if (!audio.Open(AudioFile(base), error) || !cv.Open(CVFile(base), error)) return false;
+	r.rate = audio.SampleRate();
+	uint64_t samples = audio.Frames();
+	for (int i = 0; i < 2; i++)
+	{
+		r.out[Audio1 + i].resize(samples);
+		r.out[CV1 + i].resize(samples);
+		for (uint64_t n = 0; n < samples; n++)
+		{
+			r.out[Audio1 + i][n] = int16_t(audio.Sample(n, i) / 16);
+			r.out[CV1 + i][n] = int16_t(cv.Sample(n, i) / 16);
+		}
+	}
+
+	// Pulse and LED events hold their value until the next event for the same output
+	for (int o = Pulse1; o < NumOutputs; o++) r.out[o].assign(samples, 0);
+	FILE *f = fopen(EventsFile(base).c_str(), "r");
+	if (!f)
+	{
+		error = "cannot open " + EventsFile(base);
+		return false;
+	}
+	char line[256], name[32];
+	unsigned long long sample;
+	double t;
+	int value;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "%llu,%lf,%31[^,],%d", &sample, &t, name, &value) != 4) continue;
+		for (int o = Pulse1; o < NumOutputs; o++)
+		{
+			if (strcmp(name, outputNames[o]) || sample >= samples) continue;
+			std::fill(r.out[o].begin() + sample, r.out[o].end(), int16_t(value));
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+// A card built on ComputerCard, or DSP run directly
+struct Target
+{
+	const char *name;
+	int (*main)();
+	const bench::DSPCard *dsp;
+};
+
+// Each card is rendered in a child process, so that it starts from the same state however many cards
+// have run before it: ComputerCard's and the cards' static variables are left as the previous card left them
+static bool RenderCard(const Target &c, double seconds, const std::string &base)
+{
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) return false;
+	if (pid == 0)
+	{
+		if (c.main)
+		{
+			bench::RunCard(c.main, seconds, AudioFile(base), CVFile(base), EventsFile(base));
+		}
+		else
+		{
+			cchost::Automation automation;
+			bench::SetInputs(automation, seconds);
+			std::unique_ptr<cchost::DSP> dsp(c.dsp->create());
+			bench::RunDSP(*dsp, automation, seconds, AudioFile(base), CVFile(base), EventsFile(base));
+		}
+		_exit(0);
+	}
+	int status;
+	return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool RenameRender(const std::string &from, const std::string &to)
+{
+	return !rename(AudioFile(from).c_str(), AudioFile(to).c_str()) &&
+		!rename(CVFile(from).c_str(), CVFile(to).c_str()) &&
+		!rename(EventsFile(from).c_str(), EventsFile(to).c_str());
+}
+
+////////////////////////////////////////
+// Golden files
+
+static bool WriteGolden(const std::string &filename, const char *card, const Golden &g)
+{
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f) return false;
+	fprintf(f, "# golden_render of %s: %g seconds of bench::SetInputs\n", card, g.seconds);
+	fprintf(f, "seconds %g\nrate %" PRIu32 "\nsamples %" PRIu64 "\nblock %" PRIu32 "\n", g.seconds, g.rate, g.samples, blockSize);
+	for (int o = 0; o < NumOutputs; o++) fprintf(f, "hash %s %016" PRIx64 "\n", outputNames[o], g.hash[o]);
+	fprintf(f, "# hash of each block, for each output in the order above\n");
+	for (size_t b = 0; b < g.blocks[0].size(); b++)
+	{
+		for (int o = 0; o < NumOutputs; o++) fprintf(f, "%04x%s", g.blocks[o][b], o + 1 < NumOutputs ? " " : "\n");
+	}
+	return fclose(f) == 0;
+}
+
+static bool ReadGolden(const std::string &filename, Golden &g)
+{
+	FILE *f = fopen(filename.c_str(), "r");
+	if (!f) return false;
+	char line[256], name[32];
+	uint32_t block = 0;
+	int hashes = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		uint64_t h;
+		unsigned b[NumOutputs];
+		if (line[0] == '#') continue;
+		if (sscanf(line, "seconds %lf", &g.seconds) == 1) continue;
+		if (sscanf(line, "rate %" SCNu32, &g.rate) == 1) continue;
+		if (sscanf(line, "samples %" SCNu64, &g.samples) == 1) continue;
+		if (sscanf(line, "block %" SCNu32, &block) == 1) continue;
+		if (sscanf(line, "hash %31s %" SCNx64, name, &h) == 2)
+		{
+			for (int o = 0; o < NumOutputs; o++)
+			{
+				if (!strcmp(name, outputNames[o])) g.hash[o] = h, hashes++;
+			}
+			continue;
+		}
+		if (sscanf(line, "%x %x %x %x %x %x %x %x %x %x %x %x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5],
+				   &b[6], &b[7], &b[8], &b[9], &b[10], &b[11]) == NumOutputs)
+		{
+			for (int o = 0; o < NumOutputs; o++) g.blocks[o].push_back(uint16_t(b[o]));
+		}
+	}
+	fclose(f);
+	return g.seconds > 0 && g.rate && block == blockSize && hashes == NumOutputs &&
+		g.blocks[0].size() == (g.samples + blockSize - 1) / blockSize;
+}
+
+////////////////////////////////////////
+// Golden renders, made again from the commit of their golden files
+
+static std::string Quote(const std::string &s)
+{
+	std::string q = "'";
+	for (char c : s) q += c == '\'' ? std::string("'\\''") : std::string(1, c);
+	return q + "'";
+}
+
+// Run a shell command, returning its first line of output, or false if it fails
+static bool Command(const std::string &command, std::string *output = nullptr)
+{
+	FILE *p = popen(command.c_str(), "r");
+	if (!p) return false;
+	char line[4096] = "";
+	if (!fgets(line, sizeof(line), p)) line[0] = 0;
+	while (fgetc(p) != EOF) {}
+	if (output)
+	{
+		*output = line;
+		output->erase(output->find_last_not_of("\r\n") + 1);
+	}
+	return pclose(p) == 0;
+}
+
+// golden_render built from earlier commits, each in a temporary directory, removed on exit
+class Baselines
+{
+public:
+	~Baselines()
+	{
+		std::error_code ec;
+		for (auto &b : builds) std::filesystem::remove_all(b.second, ec);
+	}
+
+	// Render card from the commit that last changed goldenFile, into base
+	bool Render(const std::string &goldenFile, const char *card, const std::string &base, std::string &error)
+	{
+		std::string dir = std::filesystem::path(goldenFile).parent_path().string(), commit, changes;
+		if (!Command("git -C " + Quote(dir) + " status --porcelain -- " + Quote(goldenFile) + " 2>/dev/null", &changes))
+		{
+			error = "not in a git repository";
+			return false;
+		}
+		if (!changes.empty())
+		{
+			error = goldenFile + " has uncommitted changes";
+			return false;
+		}
+		if (!Command("git -C " + Quote(dir) + " log -1 --format=%H -- " + Quote(goldenFile), &commit) || commit.empty())
+		{
+			error = goldenFile + " is not committed";
+			return false;
+		}
+
+		std::string &build = builds[commit];
+		if (build.empty() && !Build(commit, build, error)) return false;
+
+		std::string renders = build + "/renders";
+		Command(Quote(build + "/build/golden_render") + " --renders " + Quote(renders) + " " + Quote(card) + " > /dev/null 2>&1");
+		for (auto file : {AudioFile, CVFile, EventsFile})
+		{
+			std::error_code ec;
+			std::filesystem::copy_file(file(renders + "/" + card), file(base), std::filesystem::copy_options::overwrite_existing, ec);
+			if (ec)
+			{
+				error = std::string("golden_render of commit ") + commit.substr(0, 10) + " made no matching render of " + card;
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	// Export the ComputerCard and releases directories of a commit, and build its golden_render
+	bool Build(const std::string &commit, std::string &build, std::string &error)
+	{
+		char temp[] = "/tmp/golden_render.XXXXXX";
+		if (!mkdtemp(temp))
+		{
+			error = "cannot make a temporary directory";
+			return false;
+		}
+		build = temp;
+		std::string top, source, releases, log = build + "/build.log";
+		if (!Command("git -C " + Quote(COMPUTERCARD_SOURCE_DIR) + " rev-parse --show-toplevel", &top) ||
+			!Command("git -C " + Quote(COMPUTERCARD_SOURCE_DIR) + " rev-parse --show-prefix", &source) ||
+			!Command("git -C " + Quote(COMPUTERCARD_RELEASES_DIR) + " rev-parse --show-prefix", &releases))
+		{
+			error = "cannot find the source directories in git";
+			return false;
+		}
+		printf("building golden_render of commit %s, for the golden render...\n", commit.substr(0, 10).c_str());
+		fflush(stdout);
+		std::string tree = build + "/tree";
+		unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+		if (!Command("mkdir -p " + Quote(tree) + " && git -C " + Quote(top) + " archive " + commit + " -- " + Quote(source) +
+					 " " + Quote(releases) + " | tar -x -C " + Quote(tree)) ||
+			!Command(Quote(GOLDEN_CMAKE) + " -S " + Quote(tree + "/" + source) + " -B " + Quote(build + "/build") +
+					 " -DCOMPUTERCARD_HOST=ON " GOLDEN_CMAKE_ARGS " > " + Quote(log) + " 2>&1") ||
+			!Command(Quote(GOLDEN_CMAKE) + " --build " + Quote(build + "/build") + " --target golden_render -j" +
+					 std::to_string(jobs) + " >> " + Quote(log) + " 2>&1"))
+		{
+			error = "cannot build golden_render of commit " + commit.substr(0, 10);
+			return false;
+		}
+		return true;
+	}
+
+	std::map<std::string, std::string> builds; // commit, temporary directory
+};
+
+////////////////////////////////////////
+
+// Report where each output of a render first differs from its golden file. If reference, a render
+// matching the golden file, is given, the exact sample is found; otherwise, the block.
+static void ReportMismatch(const Golden &golden, const Render &render, const Golden &hashes, const Render *reference)
+{
+	if (hashes.rate != golden.rate || hashes.samples != golden.samples)
+	{
+		printf("  %" PRIu64 " samples at %" PRIu32 "Hz, golden %" PRIu64 " samples at %" PRIu32 "Hz\n",
+			   hashes.samples, hashes.rate, golden.samples, golden.rate);
+		return;
+	}
+	for (int o = 0; o < NumOutputs; o++)
+	{
+		if (hashes.hash[o] == golden.hash[o]) continue;
+		if (reference)
+		{
+			const std::vector<int16_t> &now = render.out[o], &then = reference->out[o];
+			size_t n = std::mismatch(now.begin(), now.end(), then.begin()).first - now.begin();
+			printf("  %-7s first differs at sample %zu (%.4fs): %d, golden %d\n",
+				   outputNames[o], n, double(n) / golden.rate, now[n], then[n]);
+			continue;
+		}
+		size_t b = 0;
+		while (b < golden.blocks[o].size() && hashes.blocks[o][b] == golden.blocks[o][b]) b++;
+		if (b == golden.blocks[o].size())
+		{
+			printf("  %-7s differs (every block hash matches)\n", outputNames[o]);
+			continue;
+		}
+		uint64_t first = b * blockSize, last = std::min<uint64_t>(first + blockSize, golden.samples) - 1;
+		printf("  %-7s first differs in samples %" PRIu64 "-%" PRIu64 " (%.4f-%.4fs)\n",
+			   outputNames[o], first, last, double(first) / golden.rate, double(last + 1) / golden.rate);
+	}
+}
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [--update] [--seconds S] [--golden DIR] [--renders DIR] [--no-baseline] [--list] [CARD...]\n",
+			prog);
+}
+
+int main(int argc, char **argv)
+{
+	bool update = false, list = false, baseline = true;
+	double seconds = 2;
+	std::string goldenDir = GOLDEN_DIR, rendersDir = "golden_renders";
+	std::vector<std::string> names;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!strcmp(a, "--update")) update = true;
+		else if (!strcmp(a, "--list")) list = true;
+		else if (!strcmp(a, "--no-baseline")) baseline = false;
+		else if (a[0] != '-') names.push_back(a);
+		else if (!v)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		else if (!strcmp(a, "--seconds")) seconds = atof(argv[++i]);
+		else if (!strcmp(a, "--golden")) goldenDir = argv[++i];
+		else if (!strcmp(a, "--renders")) rendersDir = argv[++i];
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (seconds <= 0)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Target> cards;
+	for (const bench::Card &c : bench::Cards()) cards.push_back({c.name, c.main, nullptr});
+	for (const bench::DSPCard &d : bench::DSPCards()) cards.push_back({d.name, nullptr, &d});
+	std::sort(cards.begin(), cards.end(), [](const Target &a, const Target &b) { return strcmp(a.name, b.name) < 0; });
+	if (list)
+	{
+		for (const Target &c : cards) printf("%s\n", c.name);
+		return 0;
+	}
+	for (const std::string &name : names)
+	{
+		if (std::none_of(cards.begin(), cards.end(), [&](const Target &c) { return name == c.name; }))
+		{
+			fprintf(stderr, "no card called %s (see --list)\n", name.c_str());
+			return 1;
+		}
+	}
+
+	mkdir(rendersDir.c_str(), 0777);
+
+	Baselines baselines;
+	int failures = 0;
+	for (const Target &c : cards)
+	{
+		if (!names.empty() && std::find(names.begin(), names.end(), c.name) == names.end()) continue;
+
+		std::string goldenFile = goldenDir + "/" + c.name + ".txt";
+		std::string base = rendersDir + "/" + c.name, newBase = base + ".new";
+		Golden golden;
+		bool haveGolden = !update && ReadGolden(goldenFile, golden);
+		if (!update && !haveGolden)
+		{
+			printf("%-10s no golden file %s (make one with --update)\n", c.name, goldenFile.c_str());
+			failures++;
+			continue;
+		}
+
+		std::string error;
+		Render render;
+		double length = update ? seconds : golden.seconds;
+		if (!RenderCard(c, length, newBase))
+		{
+			fprintf(stderr, "%s failed to render\n", c.name);
+			return 1;
+		}
+		if (!LoadRender(newBase, render, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		Golden hashes = HashRender(render, length);
+
+		if (update)
+		{
+			if (!WriteGolden(goldenFile, c.name, hashes))
+			{
+				fprintf(stderr, "cannot write %s\n", goldenFile.c_str());
+				return 1;
+			}
+			RenameRender(newBase, base);
+			printf("%-10s wrote %s\n", c.name, goldenFile.c_str());
+			continue;
+		}
+
+		if (SameHashes(hashes, golden))
+		{
+			RenameRender(newBase, base);
+			printf("%-10s ok\n", c.name);
+			continue;
+		}
+
+		printf("%-10s DIFFERS from %s (this render is in %s.*)\n", c.name, goldenFile.c_str(), newBase.c_str());
+
+		// Only a golden render that matches the golden file can show the exact sample
+		Render reference;
+		std::string goldenBase = base + ".golden";
+		bool haveReference = false;
+		if (baseline)
+		{
+			haveReference = baselines.Render(goldenFile, c.name, goldenBase, error) &&
+				LoadRender(goldenBase, reference, error);
+			if (haveReference && !SameHashes(HashRender(reference, golden.seconds), golden))
+			{
+				haveReference = false;
+				error = "the golden render does not match " + goldenFile;
+			}
+			if (haveReference) printf("  golden render in %s.*\n", goldenBase.c_str());
+			else printf("  no golden render (%s), so differences are found by block\n", error.c_str());
+		}
+		ReportMismatch(golden, render, hashes, haveReference ? &reference : nullptr);
+		failures++;
+	}
+
+	if (failures)
+	{
+		printf("%d card%s not matching golden files\n", failures, failures > 1 ? "s" : "");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,297 @@
+/*
+Fixed-point headroom report of the released cards, on the host.
+
+Each card built on ComputerCard (see card.cpp) is compiled again for this
+program with its int16_t and int32_t replaced by checked integers (see
+checked_int.h), and run, in a process of its own, with the same input
+automation as card_benchmark (see bench::SetInputs). Reverb's DSP is run
+the same way (see reverb_checked.cpp).
+
+For each place in a card's source where checked integers are declared
+(a variable, a cast, or a function parameter, which is declared by the
+call passing it), the report gives:
+    max        the largest magnitude stored
+    headroom   bits every value stored could be shifted left by without
+               wrapping
+    max expr   the largest magnitude of arithmetic on its values (e.g. a
+               product, before it is shifted back down)
+    headroom   as above, for the results of arithmetic, as int
+    wraps      values stored outside the type's range, and results of
+               arithmetic outside the range of their type
+A negative headroom is the number of bits by which a value has wrapped.
+Class members are attributed to their class's constructor (whose first
+line is shown), function parameters to each call, and a variable
+initialised with a function's result to the function's return statement.
+Places outside the card's directory, and places whose values were all
+zero, are left out.
+
+Outputs that clamp are found by the samples in which an audio or CV
+output is at full scale (-2048 or 2047). Each output's DAC or PWM starts
+at full scale, so an output isn't counted until it has first been below
+full scale.
+
+Usage: headroom_report [options] [CARD...]
+    --seconds S       emulated time to run each card (default 2)
+    --events FILE     write every wrap and clamp as CSV: card, sample,
+                      kind (wrap, expr wrap or clamp), place, value
+    --list            list the cards
+*/
+
+#include "benchmark.h"
+#include "checked_int.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Reverb's DSP, with checked integers (see reverb_checked.cpp)
+void CheckedReverb(double seconds, uint64_t &sample);
+
+static const char *outputNames[4] = {"audio1", "audio2", "cv1", "cv2"};
+
+// Per card, in the process running it
+static const char *cardName;
+static FILE *events;
+static uint64_t kernelSample; // sample of a kernel run without the host driver
+
+static uint64_t Sample()
+{
+	return cchost::currentDriver ? cchost::currentDriver->state.sample : kernelSample;
+}
+
+static std::string Basename(const std::string &file)
+{
+	size_t slash = file.find_last_of('/');
+	return slash == std::string::npos ? file : file.substr(slash + 1);
+}
+
+static void LogWrap(const checked::Site &site, bool expr, int64_t value)
+{
+	fprintf(events, "%s,%" PRIu64 ",%s,%s:%d,%" PRId64 "\n", cardName, Sample(), expr ? "expr wrap" : "wrap",
+			Basename(site.file).c_str(), site.line, value);
+}
+
+// Counts samples in which each audio and CV output is at full scale
+class ClampCounter : public cchost::PatchCables
+{
+public:
+	uint64_t clamped[4] = {}, first[4] = {};
+	bool written[4] = {}; // been below full scale
+
+	void Inputs(uint64_t, cchost::Inputs &) override {}
+
+	void Outputs(uint64_t sample, const cchost::OutputValues &out) override
+	{
+		const int32_t values[4] = {out.audio[0], out.audio[1], out.cv[0], out.cv[1]};
+		for (int i = 0; i < 4; i++)
+		{
+			bool full = values[i] <= -2048 || values[i] >= 2047;
+			if (!full) written[i] = true;
+			if (!written[i]) continue;
+			if (full && !clamped[i]) first[i] = sample;
+			if (full) clamped[i]++;
+			// Each run of clamped samples is one event
+			if (full && !wasFull[i] && events) fprintf(events, "%s,%" PRIu64 ",clamp,%s,%d\n", cardName, sample, outputNames[i], values[i]);
+			wasFull[i] = full;
+		}
+	}
+
+private:
+	bool wasFull[4] = {};
+};
+
+static bool InRange(int64_t min, int64_t max, int bits)
+{
+	return min >= -(int64_t(1) << (bits - 1)) && max < (int64_t(1) << (bits - 1));
+}
+
+// Bits a range of values could be shifted left by while staying within a signed type of the given
+// width, or, if it is already outside, minus the bits it would have to be shifted right by
+static int Headroom(int64_t min, int64_t max, int bits)
+{
+	int k = 0;
+	while (!InRange(min >> -k, max >> -k, bits)) k--;
+	if (k < 0) return k;
+	while (k < bits - 1 && InRange(min * (int64_t(2) << k), max * (int64_t(2) << k), bits)) k++;
+	return k;
+}
+
+static int64_t Magnitude(int64_t min, int64_t max)
+{
+	return std::max(-min, max);
+}
+
+// A line of source, without leading and trailing space, or empty if it can't be read
+static std::string SourceLine(const std::string &file, int line)
+{
+	static std::map<std::string, std::vector<std::string>> files;
+	auto f = files.find(file);
+	if (f == files.end())
+	{
+		f = files.emplace(file, std::vector<std::string>()).first;
+		if (FILE *in = fopen(file.c_str(), "r"))
+		{
+			char buf[1024];
+			while (fgets(buf, sizeof(buf), in)) f->second.push_back(buf);
+			fclose(in);
+		}
+	}
+	if (line < 1 || size_t(line) > f->second.size()) return "";
+	std::string s = f->second[line - 1];
+	size_t start = s.find_first_not_of(" \t"), end = s.find_last_not_of(" \t\r\n");
+	s = start == std::string::npos ? "" : s.substr(start, end - start + 1);
+
+	// Members are declared at the opening brace of their constructor's body
+	if (s == "{" && line > 1) return SourceLine(file, line - 1);
+	return s.size() > 100 ? s.substr(0, 97) + "..." : s;
+}
+
+static void Report(const char *name, const char *dir, double seconds, const ClampCounter *clamps)
+{
+	const std::string prefix = std::string(dir) + "/";
+	std::vector<const checked::Site *> sites;
+	for (const auto &s : checked::Sites())
+	{
+		const checked::Site &site = s.second;
+		bool used = site.minStored || site.maxStored || site.minExpr || site.maxExpr || site.wraps || site.exprWraps;
+		if (used && site.file.compare(0, prefix.size(), prefix) == 0) sites.push_back(&site);
+	}
+	std::sort(sites.begin(), sites.end(), [](const checked::Site *a, const checked::Site *b) {
+		return a->file != b->file ? a->file < b->file : a->line != b->line ? a->line < b->line : a->bits < b->bits;
+	});
+
+	printf("%s: %g seconds\n", name, seconds);
+	printf("  %-24s %5s  %11s %8s  %11s %8s  %10s\n", "place", "type", "max", "headroom", "max expr", "headroom", "wraps");
+	for (const checked::Site *s : sites)
+	{
+		std::string place = Basename(s->file) + ":" + std::to_string(s->line), type = "int" + std::to_string(s->bits);
+		printf("  %-24s %5s  %11" PRId64 " %8d  ", place.c_str(), type.c_str(), Magnitude(s->minStored, s->maxStored),
+			   Headroom(s->minStored, s->maxStored, s->bits));
+		if (s->minExpr || s->maxExpr)
+			printf("%11" PRId64 " %8d", Magnitude(s->minExpr, s->maxExpr), Headroom(s->minExpr, s->maxExpr, 32));
+		else
+			printf("%11s %8s", "-", "-");
+		printf("  %10" PRIu64 "%s\n", s->wraps + s->exprWraps, s->wraps + s->exprWraps ? "  WRAPS" : "");
+		std::string source = SourceLine(s->file, s->line);
+		if (!source.empty()) printf("      %s\n", source.c_str());
+	}
+
+	if (!clamps) return;
+	for (int i = 0; i < 4; i++)
+	{
+		if (!clamps->clamped[i]) continue;
+		printf("  %-7s at full scale in %" PRIu64 " samples, first at sample %" PRIu64 "\n", outputNames[i],
+			   clamps->clamped[i], clamps->first[i]);
+	}
+}
+
+// Each card runs in a child process, so that its Sites and static variables are its own
+static bool RunChecked(const bench::Card &c, double seconds, const char *eventsFile)
+{
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) return false;
+	if (pid == 0)
+	{
+		cardName = c.name;
+		if (eventsFile && !(events = fopen(eventsFile, "a"))) _exit(1);
+		if (events) checked::onWrap = LogWrap;
+
+		ClampCounter clamps;
+		if (c.main) bench::RunCard(c.main, seconds, "", "", "", &clamps);
+		else CheckedReverb(seconds, kernelSample);
+		Report(c.name, c.dir, seconds, c.main ? &clamps : nullptr);
+
+		fflush(stdout);
+		if (events && fclose(events)) _exit(1);
+		_exit(0);
+	}
+	int status;
+	return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [--seconds S] [--events FILE] [--list] [CARD...]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 2;
+	const char *eventsFile = nullptr;
+	bool list = false;
+	std::vector<std::string> names;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!strcmp(a, "--list")) list = true;
+		else if (a[0] != '-') names.push_back(a);
+		else if (!v)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		else if (!strcmp(a, "--seconds")) seconds = atof(argv[++i]);
+		else if (!strcmp(a, "--events")) eventsFile = argv[++i];
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (seconds <= 0)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	// Cards built on ComputerCard, and reverb, whose main is null
+	std::vector<bench::Card> cards = bench::Cards();
+	cards.push_back({"reverb", nullptr, REVERB_DIR});
+	std::sort(cards.begin(), cards.end(), [](const bench::Card &a, const bench::Card &b) { return strcmp(a.name, b.name) < 0; });
+	if (list)
+	{
+		for (const bench::Card &c : cards) printf("%s\n", c.name);
+		return 0;
+	}
+	for (const std::string &name : names)
+	{
+		if (std::none_of(cards.begin(), cards.end(), [&](const bench::Card &c) { return name == c.name; }))
+		{
+			fprintf(stderr, "no card called %s (see --list)\n", name.c_str());
+			return 1;
+		}
+	}
+
+	if (eventsFile)
+	{
+		FILE *f = fopen(eventsFile, "w");
+		if (!f)
+		{
+			fprintf(stderr, "cannot write %s\n", eventsFile);
+			return 1;
+		}
+		fprintf(f, "card,sample,kind,place,value\n");
+		fclose(f);
+	}
+
+	for (const bench::Card &c : cards)
+	{
+		if (!names.empty() && std::find(names.begin(), names.end(), c.name) == names.end()) continue;
+		if (!RunChecked(c, seconds, eventsFile))
+		{
+			fprintf(stderr, "%s failed to run\n", c.name);
+			return 1;
+		}
+	}
+	return 0;
+}
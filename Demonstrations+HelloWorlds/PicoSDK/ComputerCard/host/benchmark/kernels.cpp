@@ -0,0 +1,154 @@
+/*
+DSP cores for card_benchmark that are timed directly, rather than through
+ComputerCard: reverb's reverb_process, each shape of Twists'
+MacroOscillator::Render, and Talker's speech synthesis (processEnergy).
+Reverb and Twists don't use ComputerCard, and Talker's synthesis runs at
+its own rate, set by the main knob. Each runs for the given length of
+time at 48kHz, with parameters swept as a card would sweep them.
+*/
+
+#include "benchmark.h"
+
+#include "pico/stdlib.h"
+extern "C"
+{
+#include "reverb_dsp.h"
+}
+#include "braids/macro_oscillator.h"
+#include "TalkiePCM.h"
+
+#include <chrono>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Keeps the results of the loops from being optimised away
+	volatile int32_t sink;
+
+	double NsSince(Clock::time_point start, uint32_t samples)
+	{
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+	}
+
+	// Triangle wave between -amplitude and amplitude, with the given period in samples
+	int32_t Triangle(uint32_t n, uint32_t period, int32_t amplitude)
+	{
+		int32_t phase = int32_t(n % period) * 4 * amplitude / int32_t(period);
+		return phase < 2 * amplitude ? phase - amplitude : 3 * amplitude - phase;
+	}
+
+	////////////////////////////////////////
+	// Reverb, as its ProcessSample calls it: tone and decay set, then one mono sample in and two out
+
+	bench::Measurement Reverb(int, double seconds)
+	{
+		uint32_t samples = uint32_t(seconds * 48000);
+		struct sreverb *v = reverb_create();
+		int32_t sum = 0;
+
+		auto start = Clock::now();
+		for (uint32_t n = 0; n < samples; n++)
+		{
+			int32_t knob = int32_t(uint64_t(n) * 4095 / samples);
+			reverb_set_tilt(v, knob * 16);
+			reverb_set_freeze_size(v, clamp(knob * 16, 50, 65500), 0);
+			reverb_process(v, Triangle(n, 436, 16000));
+			sum += reverb_get_left(v) + reverb_get_right(v);
+		}
+		bench::Measurement m;
+		m.nsPerSample = NsSince(start, samples);
+
+		sink = sum;
+		reverb_delete(v);
+		return m;
+	}
+
+	bench::BenchmarkRegistration reverbRegistration("reverb_process", Reverb);
+
+	////////////////////////////////////////
+	// Twists: one shape, rendered in blocks of 24 samples as Twists does, with pitch, timbre and colour swept
+
+	bench::Measurement Twists(int shape, double seconds)
+	{
+		const size_t blockSize = 24;
+		uint32_t blocks = uint32_t(seconds * 48000) / blockSize;
+		static braids::MacroOscillator osc;
+		uint8_t sync[blockSize] = {};
+		int16_t buffer[blockSize];
+		int32_t sum = 0;
+
+		osc.Init();
+		osc.set_shape(braids::MacroOscillatorShape(shape));
+
+		auto start = Clock::now();
+		for (uint32_t b = 0; b < blocks; b++)
+		{
+			int32_t sweep = int32_t(uint64_t(b) * 32767 / blocks);
+			osc.set_pitch(int16_t((36 << 7) + (sweep >> 4))); // MIDI note 36 to 100
+			osc.set_parameters(int16_t(sweep), int16_t(32767 - sweep));
+			if (b % 400 == 0) osc.Strike();
+			osc.Render(sync, buffer, blockSize);
+			sum += buffer[0];
+		}
+		bench::Measurement m;
+		m.nsPerSample = NsSince(start, blocks * blockSize);
+
+		sink = sum;
+		return m;
+	}
+
+	const char *const twistsShapes[braids::MACRO_OSC_SHAPE_LAST] = {
+		"csaw", "morph", "saw_square", "sine_triangle", "buzz",
+		"square_sub", "saw_sub", "square_sync", "saw_sync",
+		"triple_saw", "triple_square", "triple_triangle", "triple_sine", "triple_ring_mod",
+		"saw_swarm", "saw_comb", "toy",
+		"digital_filter_lp", "digital_filter_pk", "digital_filter_bp", "digital_filter_hp",
+		"vosim", "vowel", "vowel_fof", "harmonics",
+		"fm", "feedback_fm", "chaotic_feedback_fm",
+		"plucked", "bowed", "blown", "fluted", "struck_bell", "struck_drum", "kick", "cymbal", "snare",
+		"wavetables", "wave_map", "wave_line", "wave_paraphonic",
+		"filtered_noise", "twin_peaks_noise", "clocked_noise", "granular_cloud", "particle_noise",
+		"digital_modulation", "question_mark"};
+
+	struct TwistsRegistrations
+	{
+		TwistsRegistrations()
+		{
+			static std::string names[braids::MACRO_OSC_SHAPE_LAST];
+			for (int i = 0; i < braids::MACRO_OSC_SHAPE_LAST; i++)
+			{
+				names[i] = std::string("twists_") + twistsShapes[i];
+				bench::Registry().push_back({names[i].c_str(), Twists, i});
+			}
+		}
+	} twistsRegistrations;
+
+	////////////////////////////////////////
+	// Talker: a new frame and a new sample (processEnergy) every sample, as with the main knob fully up,
+	// saying the digits in turn. The second half replaces the exciter with a tone, as audio input 1 does.
+
+	bench::Measurement Talker(int, double seconds)
+	{
+		uint32_t samples = uint32_t(seconds * 48000);
+		static TalkiePCM voice;
+		int16_t energy = 0, pitch = 0, preFilter;
+		int32_t sum = 0;
+		int digit = 0;
+
+		voice.sayNumber(digit);
+		auto start = Clock::now();
+		for (uint32_t n = 0; n < samples; n++)
+		{
+			if (voice.calculateNextFrame(256, energy, pitch)) voice.sayNumber(digit = (digit + 1) % 10);
+			sum += voice.calculateNextSample(n >= samples / 2, int16_t(Triangle(n, 200, 1500)), preFilter);
+		}
+		bench::Measurement m;
+		m.nsPerSample = NsSince(start, samples);
+
+		sink = sum + energy + pitch;
+		return m;
+	}
+
+	bench::BenchmarkRegistration talkerRegistration("talker_processEnergy", Talker);
+}
@@ -0,0 +1,300 @@
+/*
+RAM used by each of the released cards, on the host, against the RAM an
+RP2040 has for a card (ComputerCard::MemoryBudget).
+
+Each card built on ComputerCard (see card.cpp) is run, in a process of its
+own, with the same input automation as card_benchmark (see
+bench::SetInputs), and the report gives:
+    static     its static variables: the .data and .bss symbols in its
+               namespace, other than those of its copy of ComputerCard,
+               read from this program with nm
+    heap       the most it had allocated with malloc or new at once
+    stack      the deepest its stack went, including its audio interrupt:
+               the deepest stack pointer seen after each sample, or the
+               deepest word of the stack written, if deeper
+    total      static and heap, and the stack beyond
+               MemoryBudget::stackBytes, which on the RP2040 grows
+               unchecked into main RAM
+    headroom   MemoryBudget::cardBytes less total
+The heap and stack are less those of a card doing nothing (see
+null_card.cpp), so that ComputerCard's own, and the host driver's, are
+left out. The largest static variables of each card are listed below it.
+
+Reverb isn't built on ComputerCard: its row is the static RAM of its DSP
+(REVERB_RAM_BYTES in reverb_dsp.h).
+
+Pointers, and types containing them, are larger on the host, so the sizes
+are estimates. The linker's memory map of the RP2040 build gives the exact
+static sizes (see memory_report.cmake), and ComputerCard::MemoryUsage
+measures the heap and stack on the card itself.
+
+Usage: memory_report [options] [CARD...]
+    --seconds S   emulated time to run each card (default 1)
+    --symbols N   largest static variables listed for each card (default 3)
+    --list        list the cards
+*/
+
+#include "benchmark.h"
+#include "reverb_dsp.h"
+
+#define COMPUTERCARD_NOIMPL
+#include "../../ComputerCard.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <malloc.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Deepest stack cleared before each run: more than any card's, with its card object on the stack
+static const size_t clearedStackBytes = 2 << 20;
+
+// Memory used by one run of a card
+struct MemoryUse
+{
+	size_t heap = 0;  // peak allocated, less that allocated before the run
+	size_t stack = 0; // below the frame running it
+};
+
+// A static variable, and its size
+struct Symbol
+{
+	std::string name;
+	size_t size;
+};
+
+static size_t HeapBytes()
+{
+#ifdef __GLIBC__
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+// Peak heap, and deepest stack pointer, after each sample
+class MemoryProbe : public cchost::PatchCables
+{
+public:
+	size_t heapPeak = 0;
+	uintptr_t lowestFrame = UINTPTR_MAX;
+
+	void Inputs(uint64_t, cchost::Inputs &) override {}
+
+	void Outputs(uint64_t, const cchost::OutputValues &) override
+	{
+		lowestFrame = std::min(lowestFrame, uintptr_t(__builtin_frame_address(0)));
+		heapPeak = std::max(heapPeak, HeapBytes());
+	}
+};
+
+// Clear the stack below the caller, returning the lowest address cleared
+static uintptr_t __attribute__((noinline)) ClearStack()
+{
+	volatile uint8_t stack[clearedStackBytes];
+	for (size_t i = 0; i < sizeof(stack); i++) stack[i] = 0;
+	return uintptr_t(stack);
+}
+
+// Lowest word written between bottom and top, or top if none was
+static uintptr_t __attribute__((noinline)) LowestWritten(uintptr_t bottom, uintptr_t top)
+{
+	for (uintptr_t a = bottom; a < top; a += sizeof(uint64_t))
+	{
+		if (*reinterpret_cast<volatile uint64_t *>(a)) return a;
+	}
+	return top;
+}
+
+static void __attribute__((noinline)) MeasureRun(int (*cardMain)(), double seconds, MemoryUse &u)
+{
+	const uintptr_t top = uintptr_t(__builtin_frame_address(0));
+	const uintptr_t bottom = ClearStack();
+	const size_t heapStart = HeapBytes();
+
+	MemoryProbe probe;
+	probe.heapPeak = heapStart;
+	bench::RunCard(cardMain, seconds, "", "", "", &probe);
+
+	u.heap = probe.heapPeak - heapStart;
+	u.stack = top - std::min(probe.lowestFrame, LowestWritten(bottom, top));
+}
+
+// Each run is in a child process, so that every card starts from the same heap and static variables
+static bool Measure(int (*cardMain)(), double seconds, MemoryUse &u)
+{
+	int fds[2];
+	if (pipe(fds)) return false;
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (pid == 0)
+	{
+		close(fds[0]);
+		MemoryUse child;
+		MeasureRun(cardMain, seconds, child);
+		_exit(write(fds[1], &child, sizeof(child)) == sizeof(child) ? 0 : 1);
+	}
+	close(fds[1]);
+	bool ok = read(fds[0], &u, sizeof(u)) == sizeof(u);
+	close(fds[0]);
+	int status;
+	return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+}
+
+// Static variables of each card (in namespace card_<name>), largest first, from nm
+static bool ReadSymbols(std::map<std::string, std::vector<Symbol>> &symbols)
+{
+	std::string command = std::string(NM) + " --print-size --size-sort --reverse-sort --demangle /proc/" +
+		std::to_string(getpid()) + "/exe";
+	FILE *in = popen(command.c_str(), "r");
+	if (!in) return false;
+	char line[4096];
+	while (fgets(line, sizeof(line), in))
+	{
+		// address size type name
+		char *end;
+		strtoull(line, &end, 16);
+		if (*end != ' ') continue;
+		size_t size = strtoull(end + 1, &end, 16);
+		if (end[0] != ' ' || !strchr("bBdD", end[1]) || end[2] != ' ') continue;
+		std::string name = end + 3;
+		name.erase(name.find_last_not_of("\r\n") + 1);
+		if (name.compare(0, 5, "card_")) continue;
+		size_t colons = name.find("::");
+		if (colons == std::string::npos) continue;
+
+		// Each card's copy of ComputerCard's own variables (see card.cpp) isn't counted, as for the null card
+		std::string local = name.substr(colons + 2);
+		if (!local.compare(0, 14, "ComputerCard::") || !local.compare(0, 13, "computercard_")) continue;
+		symbols[name.substr(5, colons - 5)].push_back({local, size});
+	}
+	return pclose(in) == 0;
+}
+
+static void PrintRow(const char *name, size_t staticBytes, const MemoryUse *u)
+{
+	const size_t stackBudget = ComputerCard::MemoryBudget::stackBytes;
+	size_t total = staticBytes;
+	if (u) total += u->heap + (u->stack > stackBudget ? u->stack - stackBudget : 0);
+	const int64_t headroom = int64_t(ComputerCard::MemoryBudget::cardBytes) - int64_t(total);
+
+	printf("%-10s %9zu", name, staticBytes);
+	if (u) printf(" %9zu %9zu", u->heap, u->stack);
+	else printf(" %9s %9s", "-", "-");
+	printf(" %9zu %9lld%s%s\n", total, (long long)headroom, headroom < 0 ? "  OVER" : "",
+		   u && u->stack > stackBudget ? "  (stack beyond stackBytes)" : "");
+}
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [--seconds S] [--symbols N] [--list] [CARD...]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 1;
+	int symbolCount = 3;
+	bool list = false;
+	std::vector<std::string> names;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!strcmp(a, "--list")) list = true;
+		else if (a[0] != '-') names.push_back(a);
+		else if (!v)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		else if (!strcmp(a, "--seconds")) seconds = atof(argv[++i]);
+		else if (!strcmp(a, "--symbols")) symbolCount = atoi(argv[++i]);
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (seconds <= 0 || symbolCount < 0)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	// Cards built on ComputerCard, and reverb, whose main is null
+	std::vector<bench::Card> cards = bench::Cards();
+	cards.push_back({"reverb", nullptr, nullptr});
+	std::sort(cards.begin(), cards.end(), [](const bench::Card &a, const bench::Card &b) { return strcmp(a.name, b.name) < 0; });
+	if (list)
+	{
+		for (const bench::Card &c : cards) printf("%s\n", c.name);
+		return 0;
+	}
+	for (const std::string &name : names)
+	{
+		if (std::none_of(cards.begin(), cards.end(), [&](const bench::Card &c) { return name == c.name; }))
+		{
+			fprintf(stderr, "no card called %s (see --list)\n", name.c_str());
+			return 1;
+		}
+	}
+
+	std::map<std::string, std::vector<Symbol>> symbols;
+	if (!ReadSymbols(symbols))
+	{
+		fprintf(stderr, "cannot read this program's symbols with %s\n", NM);
+		return 1;
+	}
+
+	MemoryUse null;
+	if (!Measure(bench::NullCardMain, seconds, null))
+	{
+		fprintf(stderr, "the null card failed to run\n");
+		return 1;
+	}
+
+	printf("RAM for the card: %u bytes (MemoryBudget::cardBytes), stack: %u bytes (MemoryBudget::stackBytes)\n\n",
+		   unsigned(ComputerCard::MemoryBudget::cardBytes), unsigned(ComputerCard::MemoryBudget::stackBytes));
+	printf("%-10s %9s %9s %9s %9s %9s\n", "card", "static", "heap", "stack", "total", "headroom");
+	for (const bench::Card &c : cards)
+	{
+		if (!names.empty() && std::find(names.begin(), names.end(), c.name) == names.end()) continue;
+		if (!c.main)
+		{
+			PrintRow(c.name, REVERB_RAM_BYTES, nullptr);
+			continue;
+		}
+
+		MemoryUse u;
+		if (!Measure(c.main, seconds, u))
+		{
+			fprintf(stderr, "%s failed to run\n", c.name);
+			return 1;
+		}
+		u.heap = u.heap > null.heap ? u.heap - null.heap : 0;
+		u.stack = u.stack > null.stack ? u.stack - null.stack : 0;
+
+		const std::vector<Symbol> &s = symbols[c.name];
+		size_t staticBytes = 0;
+		for (const Symbol &sym : s) staticBytes += sym.size;
+		PrintRow(c.name, staticBytes, &u);
+		for (size_t i = 0; i < s.size() && i < size_t(symbolCount); i++)
+		{
+			printf("%-10s %9zu  %s\n", "", s[i].size, s[i].name.c_str());
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,33 @@
+/*
+The ComputerCard implementation for card_benchmark, shared by every card
+(see card.cpp), and a card that does nothing in ProcessSample, whose
+interrupt time is subtracted from each card's.
+*/
+
+#include "benchmark.h"
+
+#include "../../ComputerCard.h"
+
+class NullCard : public ComputerCard
+{
+protected:
+	virtual void ProcessSample() {}
+};
+
+static int NullMain()
+{
+	NullCard card;
+	card.EnableNormalisationProbe();
+	card.Run();
+	return 0;
+}
+
+double bench::NullCardInterruptNs(double seconds)
+{
+	return RunCard(NullMain, seconds);
+}
+
+int bench::NullCardMain()
+{
+	return NullMain();
+}
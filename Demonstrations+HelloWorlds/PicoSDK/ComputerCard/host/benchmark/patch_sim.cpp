@@ -0,0 +1,508 @@
+/*
+Virtual Workshop System: several released cards (see card.cpp) patched
+together, each running on the emulated hardware, in parallel. Twists and
+Reverb, which aren't built on ComputerCard, can be patched too: their DSP
+runs directly, with the controls and jacks listed in dsp_card.cpp.
+
+A patch file lists the cards, the cables between their jacks, and lines
+of a control script (see host_driver.h) for each card's knobs, switch and
+inputs:
+
+    # Talker's energy CV modulates Goldfish, whose pulse makes Talker speak
+    card talk talker
+    card fish goldfish
+    cable talk.cv1 fish.cv1
+    cable fish.pulse1 talk.pulse1
+    talk 0 main 3000
+    fish 0 x 0
+    fish 2 x 4095 ramp
+
+Jacks are audio1, audio2, cv1, cv2, pulse1 and pulse2. An output may feed
+any number of inputs, but each input takes one cable, which plugs it in.
+A cable delays its signal by one sample, as if each card's inputs were
+read just before its outputs were updated. Audio and CV voltages pass
+unchanged between audio and CV jacks; a high pulse output reads as 5V on
+an audio or CV input, and an audio or CV output reads as a high pulse
+above 1V.
+
+Each card runs in a process of its own, as cards and ComputerCard keep
+state in static variables (as do Twists' oscillator and Reverb's delay
+lines), so threads in one process would share it.
+Every output sample goes into a ring buffer in memory shared between the
+processes, with lock-free counts of the samples written and read. Cards
+publish their counts every --block samples, or before waiting for another
+card, so a chain of cards runs in parallel a block apart, and a loop of
+cables (feedback) runs in lock step without deadlock.
+
+Each card's outputs are written to DIR/NAME.audio.wav, DIR/NAME.cv.wav
+and DIR/NAME.events.csv, as by the host build's --out-audio, --out-cv and
+--out-events.
+
+Usage: patch_sim PATCH [options]
+    --seconds S    emulated time to render (default 1)
+    --block N      samples between publishing counts (default 64)
+    --out DIR      directory for the outputs (default .)
+    --list         list the cards that can be patched
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "sample counts must be lock-free to share between processes");
+
+enum Jack
+{
+	Audio1, Audio2, CV1, CV2, Pulse1, Pulse2,
+	NumJacks
+};
+
+static const char *jackNames[NumJacks] = {"audio1", "audio2", "cv1", "cv2", "pulse1", "pulse2"};
+
+static const int32_t pulseHigh = 2047 * 5 / 6; // 5V pulse into an audio or CV input
+static const int32_t pulseThreshold = 2047 / 6; // 1V
+
+struct Cable
+{
+	int fromCard, fromJack;
+	int toCard, toJack;
+};
+
+struct PatchCard
+{
+	std::string name;
+	const char *type;
+	const bench::Card *card;    // a card built on ComputerCard,
+	const bench::DSPCard *dsp;  // or DSP run directly
+	cchost::Automation automation;
+	std::vector<Cable> inputs; // cables into this card
+	std::vector<int> readers;  // cards with a cable from this card, each listed once
+};
+
+////////////////////////////////////////
+// Patch file
+
+static bool FindJack(const std::string &spec, const std::vector<PatchCard> &cards, int &card, int &jack)
+{
+	size_t dot = spec.find('.');
+	if (dot == std::string::npos) return false;
+	std::string name = spec.substr(0, dot), jackName = spec.substr(dot + 1);
+	card = jack = -1;
+	for (size_t i = 0; i < cards.size(); i++)
+	{
+		if (cards[i].name == name) card = int(i);
+	}
+	for (int j = 0; j < NumJacks; j++)
+	{
+		if (jackName == jackNames[j]) jack = j;
+	}
+	return card >= 0 && jack >= 0;
+}
+
+static bool LoadPatch(const std::string &filename, std::vector<PatchCard> &cards, std::string &error)
+{
+	std::ifstream f(filename);
+	if (!f)
+	{
+		error = "cannot open " + filename;
+		return false;
+	}
+
+	std::string line;
+	for (int lineNum = 1; std::getline(f, line); lineNum++)
+	{
+		std::string where = filename + ":" + std::to_string(lineNum) + ": ";
+		std::istringstream ss(line.substr(0, line.find('#')));
+		std::string word;
+		if (!(ss >> word)) continue; // blank line
+
+		if (word == "card")
+		{
+			std::string name, type, extra;
+			if (!(ss >> name >> type) || (ss >> extra))
+			{
+				error = where + "expected card <name> <card>";
+				return false;
+			}
+			if (name.find('.') != std::string::npos ||
+				std::any_of(cards.begin(), cards.end(), [&](const PatchCard &c) { return c.name == name; }))
+			{
+				error = where + "card name '" + name + "' is already used, or contains '.'";
+				return false;
+			}
+			const std::vector<bench::Card> &known = bench::Cards();
+			const std::vector<bench::DSPCard> &dsps = bench::DSPCards();
+			auto k = std::find_if(known.begin(), known.end(), [&](const bench::Card &c) { return type == c.name; });
+			auto d = std::find_if(dsps.begin(), dsps.end(), [&](const bench::DSPCard &c) { return type == c.name; });
+			if (k != known.end()) cards.push_back(PatchCard{name, k->name, &*k, nullptr, cchost::Automation(), {}, {}});
+			else if (d != dsps.end()) cards.push_back(PatchCard{name, d->name, nullptr, &*d, cchost::Automation(), {}, {}});
+			else
+			{
+				error = where + "unknown card '" + type + "' (see --list)";
+				return false;
+			}
+		}
+		else if (word == "cable")
+		{
+			std::string from, to, extra;
+			Cable c;
+			if (!(ss >> from >> to) || (ss >> extra))
+			{
+				error = where + "expected cable <card>.<output> <card>.<input>";
+				return false;
+			}
+			if (!FindJack(from, cards, c.fromCard, c.fromJack) || !FindJack(to, cards, c.toCard, c.toJack))
+			{
+				error = where + "unknown card or jack in '" + from + "' or '" + to + "'";
+				return false;
+			}
+			std::vector<Cable> &in = cards[c.toCard].inputs;
+			if (std::any_of(in.begin(), in.end(), [&](const Cable &o) { return o.toJack == c.toJack; }))
+			{
+				error = where + to + " already has a cable";
+				return false;
+			}
+			in.push_back(c);
+			std::vector<int> &readers = cards[c.fromCard].readers;
+			if (std::find(readers.begin(), readers.end(), c.toCard) == readers.end()) readers.push_back(c.toCard);
+		}
+		else
+		{
+			auto card = std::find_if(cards.begin(), cards.end(), [&](const PatchCard &c) { return c.name == word; });
+			if (card == cards.end())
+			{
+				error = where + "expected card, cable, or a card's name and a control script line";
+				return false;
+			}
+			std::string rest;
+			std::getline(ss, rest);
+			if (!card->automation.ParseLine(rest, where, error)) return false;
+		}
+	}
+	if (cards.empty())
+	{
+		error = filename + ": no cards";
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+// Memory shared between the cards' processes
+
+// Counts for one card, each on a cache line of its own, as each is written by one process and read by others
+struct alignas(64) SharedCount
+{
+	std::atomic<uint64_t> value{0};
+};
+
+struct SharedCard
+{
+	SharedCount written;  // samples of this card's outputs in its ring
+	SharedCount consumed; // this card no longer needs samples of other cards' outputs before this
+	std::atomic<uint32_t> sampleRate{0};
+	std::atomic<bool> finished{false};
+};
+
+class SharedMemory
+{
+public:
+	SharedMemory(size_t numCards, uint32_t ringSamples) : ringSamples(ringSamples), numCards(numCards)
+	{
+		bytes = numCards * (sizeof(SharedCard) + ringSamples * NumJacks * sizeof(int16_t));
+		void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		base = p == MAP_FAILED ? nullptr : static_cast<uint8_t *>(p);
+		if (!base) return;
+		for (size_t i = 0; i < numCards; i++) new (&Card(int(i))) SharedCard;
+	}
+
+	~SharedMemory()
+	{
+		if (base) munmap(base, bytes);
+	}
+
+	bool IsOpen() const { return base != nullptr; }
+
+	SharedCard &Card(int i) { return reinterpret_cast<SharedCard *>(base)[i]; }
+
+	// Outputs of card i at the given sample, which is in its ring
+	int16_t *Sample(int i, uint64_t sample)
+	{
+		int16_t *rings = reinterpret_cast<int16_t *>(base + numCards * sizeof(SharedCard));
+		return rings + (size_t(i) * ringSamples + sample % ringSamples) * NumJacks;
+	}
+
+	const uint32_t ringSamples;
+
+private:
+	size_t numCards;
+	size_t bytes;
+	uint8_t *base;
+};
+
+////////////////////////////////////////
+// One card's cables, in its own process
+
+class CardCables : public cchost::PatchCables
+{
+public:
+	CardCables(SharedMemory &shared, const std::vector<PatchCard> &cards, int self, uint32_t block)
+		: shared(shared), cards(cards), self(self), block(block), me(shared.Card(self))
+	{
+	}
+
+	// Inputs for this sample are other cards' outputs from the sample before
+	void Inputs(uint64_t sample, cchost::Inputs &in) override
+	{
+		for (const Cable &c : cards[self].inputs)
+		{
+			int32_t v = sample ? Read(c.fromCard, sample - 1)[c.fromJack] : 0;
+			bool fromPulse = c.fromJack >= Pulse1;
+			in.plugged[c.toJack] = true;
+			if (c.toJack >= Pulse1)
+			{
+				in.pulse[c.toJack - Pulse1] = in.pulse[c.toJack - Pulse1] || (fromPulse ? v != 0 : v > pulseThreshold);
+			}
+			else
+			{
+				int32_t &input = c.toJack >= CV1 ? in.cv[c.toJack - CV1] : in.audio[c.toJack];
+				input = std::clamp(input + (fromPulse ? (v ? pulseHigh : 0) : v), int32_t(-2048), int32_t(2047));
+			}
+		}
+		consumed = sample; // the outputs of earlier samples are no longer needed
+	}
+
+	void Outputs(uint64_t sample, const cchost::OutputValues &out) override
+	{
+		// Wait until every card reading this one's outputs has finished with the sample this replaces
+		if (sample >= shared.ringSamples)
+		{
+			for (int r : cards[self].readers)
+			{
+				while (shared.Card(r).consumed.value.load(std::memory_order_acquire) <= sample - shared.ringSamples)
+				{
+					Wait();
+				}
+			}
+		}
+
+		int16_t *s = shared.Sample(self, sample);
+		for (int i = 0; i < 2; i++)
+		{
+			s[Audio1 + i] = int16_t(out.audio[i]);
+			s[CV1 + i] = int16_t(out.cv[i]);
+			s[Pulse1 + i] = out.pulse[i];
+		}
+		written = sample + 1;
+		if (written % block == 0) Publish();
+	}
+
+	// All samples rendered: let other cards read them all, and no longer wait for this card to read
+	void Finish(uint32_t sampleRate)
+	{
+		consumed = UINT64_MAX;
+		Publish();
+		me.sampleRate.store(sampleRate);
+		me.finished.store(true, std::memory_order_release);
+	}
+
+private:
+	const int16_t *Read(int card, uint64_t sample)
+	{
+		static const int16_t none[NumJacks] = {};
+		SharedCard &from = shared.Card(card);
+		while (from.written.value.load(std::memory_order_acquire) <= sample)
+		{
+			if (from.finished.load(std::memory_order_acquire) && from.written.value.load(std::memory_order_acquire) <= sample)
+			{
+				return none; // card stopped early
+			}
+			Wait();
+		}
+		return shared.Sample(card, sample);
+	}
+
+	void Publish()
+	{
+		me.written.value.store(written, std::memory_order_release);
+		me.consumed.value.store(consumed, std::memory_order_release);
+	}
+
+	// Publish before waiting for another card, which may in turn be waiting for this one
+	void Wait()
+	{
+		Publish();
+		std::this_thread::yield();
+	}
+
+	SharedMemory &shared;
+	const std::vector<PatchCard> &cards;
+	const int self;
+	const uint32_t block;
+	SharedCard &me;
+	uint64_t written = 0, consumed = 0;
+};
+
+////////////////////////////////////////
+
+static int RunPatchCard(SharedMemory &shared, std::vector<PatchCard> &cards, int self, double seconds, uint32_t block,
+						const std::string &outDir)
+{
+	PatchCard &c = cards[self];
+	cchost::HostDriver driver;
+	driver.state = cchost::defaultState; // as in bench::RunCard
+	driver.automation = c.automation;
+
+	cchost::HostOptions opts;
+	std::string base = outDir + "/" + c.name;
+	opts.outAudio = base + ".audio.wav";
+	opts.outCV = base + ".cv.wav";
+	opts.outEvents = base + ".events.csv";
+	opts.seconds = seconds;
+
+	CardCables cables(shared, cards, self, block);
+	std::string error;
+	if (!driver.Open(opts, error))
+	{
+		fprintf(stderr, "%s: %s\n", c.name.c_str(), error.c_str());
+		cables.Finish(0);
+		return 1;
+	}
+	driver.cables = &cables;
+	if (c.dsp)
+	{
+		std::unique_ptr<cchost::DSP> dsp(c.dsp->create());
+		driver.RunDSP(*dsp, 48000);
+	}
+	else
+	{
+		driver.Run(c.card->main);
+	}
+	driver.Close();
+	cables.Finish(driver.SampleRate());
+	return 0;
+}
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s PATCH [--seconds S] [--block N] [--out DIR] [--list]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 1;
+	int block = 64;
+	std::string patchFile, outDir = ".";
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!strcmp(a, "--list"))
+		{
+			std::vector<const char *> known;
+			for (const bench::Card &c : bench::Cards()) known.push_back(c.name);
+			for (const bench::DSPCard &c : bench::DSPCards()) known.push_back(c.name);
+			std::sort(known.begin(), known.end(), [](const char *a, const char *b) { return strcmp(a, b) < 0; });
+			for (const char *name : known) printf("%s\n", name);
+			return 0;
+		}
+		if (a[0] != '-' && patchFile.empty()) patchFile = a;
+		else if (!v)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		else if (!strcmp(a, "--seconds")) seconds = atof(argv[++i]);
+		else if (!strcmp(a, "--block")) block = atoi(argv[++i]);
+		else if (!strcmp(a, "--out")) outDir = argv[++i];
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (patchFile.empty() || seconds <= 0 || block < 1)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<PatchCard> cards;
+	std::string error;
+	if (!LoadPatch(patchFile, cards, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	mkdir(outDir.c_str(), 0777);
+
+	SharedMemory shared(cards.size(), 4 * uint32_t(block));
+	if (!shared.IsOpen())
+	{
+		fprintf(stderr, "cannot allocate shared memory\n");
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<pid_t> pids;
+	fflush(stdout);
+	for (size_t i = 0; i < cards.size(); i++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+		{
+			fprintf(stderr, "cannot start process for %s\n", cards[i].name.c_str());
+			for (pid_t p : pids) kill(p, SIGKILL);
+			return 1;
+		}
+		if (pid == 0) _exit(RunPatchCard(shared, cards, int(i), seconds, uint32_t(block), outDir));
+		pids.push_back(pid);
+	}
+
+	// If a card fails, the others may be waiting for it forever
+	int failed = 0;
+	for (size_t n = 0; n < cards.size(); n++)
+	{
+		int status;
+		pid_t pid = wait(&status);
+		auto which = std::find(pids.begin(), pids.end(), pid);
+		if (which == pids.end() || (WIFEXITED(status) && WEXITSTATUS(status) == 0)) continue;
+		fprintf(stderr, "%s failed\n", cards[which - pids.begin()].name.c_str());
+		if (!failed++)
+		{
+			for (pid_t p : pids) kill(p, SIGKILL);
+		}
+	}
+	if (failed) return 1;
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint32_t rate = shared.Card(0).sampleRate.load();
+	for (size_t i = 0; i < cards.size(); i++)
+	{
+		uint32_t r = shared.Card(int(i)).sampleRate.load();
+		printf("%-12s %-10s %uHz, %zu cable%s in\n", cards[i].name.c_str(), cards[i].type, r,
+			   cards[i].inputs.size(), cards[i].inputs.size() == 1 ? "" : "s");
+		if (r != rate) printf("  warning: sample rates differ, so cables between these cards drift in time\n");
+	}
+	printf("%g seconds of %zu card%s rendered in %.2f seconds (%.1f times real time), outputs in %s\n", seconds,
+		   cards.size(), cards.size() == 1 ? "" : "s", elapsed, seconds / elapsed, outDir.c_str());
+	return 0;
+}
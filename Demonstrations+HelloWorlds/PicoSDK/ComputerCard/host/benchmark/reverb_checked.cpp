@@ -0,0 +1,57 @@
+/*
+Reverb's DSP (releases/20_reverb/reverb_dsp.c) with checked integers, for
+headroom_report.
+
+The C source is included unmodified, compiled as C++ inside a namespace of
+its own, with int16_t and int32_t defined as checked integers (see
+checked_int.h). Its memset is replaced by checked::Fill, which clears the
+checked integers in its delay buffers and reverb struct without losing
+their Sites.
+
+It is driven as the Reverb card drives it, with its input at the card's
+full scale (see CheckedReverb).
+*/
+
+#include "checked_int.h"
+#include "pico/stdlib.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace reverb_checked
+{
+#define int16_t checked::Int<int16_t>
+#define int32_t checked::Int<int32_t>
+#define memset(p, c, n) checked::Fill((p), (c), (n))
+#include "reverb_dsp.c"
+#undef int16_t
+#undef int32_t
+#undef memset
+}
+
+// Run the reverb for the given time at 48kHz, keeping sample up to date for headroom_report's events.
+// The input is a triangle wave at the card's full scale (its inputs' difference, ±16384). Its knobs
+// sweep as bench::SetInputs sweeps them: the main knob (reverb size) up and knob X (tone) down.
+void CheckedReverb(double seconds, uint64_t &sample)
+{
+	using namespace reverb_checked;
+	const uint32_t samples = uint32_t(seconds * 48000), period = 436;
+	reverb *v = reverb_create();
+	for (uint32_t n = 0; n < samples; n++)
+	{
+		sample = n;
+		int32_t main = int32_t(uint64_t(n) * 4095 / samples), x = 4095 - main;
+		int32_t phase = int32_t(n % period) * 65536 / int32_t(period);
+		int32_t in = phase < 32768 ? phase - 16384 : 49152 - phase;
+
+		// As the card's process_sample
+		int32_t size = clamp(((main * 71936) >> 12) - 3200, 50, 65500);
+		reverb_set_tilt(v, x * 16);
+		reverb_set_freeze_size(v, size, 256);
+		reverb_process(v, in);
+		reverb_get_left(v);
+		reverb_get_right(v);
+	}
+	reverb_delete(v);
+}
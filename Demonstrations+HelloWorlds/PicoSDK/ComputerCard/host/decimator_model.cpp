@@ -0,0 +1,180 @@
+/*
+Model of the audio input decimation filter (COMPUTERCARD_AUDIO_DECIMATION),
+comparing it with the default averaging of two ADC readings per sample.
+
+ADC readings of a test signal, evenly spaced at 2 or 4 readings per
+48kHz sample (the default and audio-only ADC schedules), are fed through
+AudioDecimator exactly as BufferFull does. The program reports:
+ - the gain at frequencies within the audio band,
+ - the level of aliases from frequencies between the readings, which
+   averaging or decimation should remove,
+ - the noise remaining from random noise on each ADC reading, and
+ - the time the filter takes on this host, per sample for both inputs.
+
+Usage: decimator_model [--noise LSB]
+*/
+
+#define COMPUTERCARD_NOIMPL
+#include "ComputerCard.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static const double sampleRate = 48000.0;
+static const unsigned N = 48000; // samples in each test
+
+// Output of one filter, in ADC LSBs, for a signal given at each reading time
+struct Filter
+{
+	unsigned factor; // readings per sample
+	bool decimate;   // AudioDecimator, rather than averaging first and last readings
+
+	template <typename Signal>
+	std::vector<double> Run(Signal signal) const
+	{
+		AudioDecimator dec;
+		dec.SetFactor(factor);
+		std::vector<double> out(N);
+		std::vector<uint16_t> readings(factor);
+		for (unsigned n = 0; n < N; n++)
+		{
+			for (unsigned i = 0; i < factor; i++)
+			{
+				double v = 2048.0 + signal((n * factor + i) / (sampleRate * factor));
+				readings[i] = uint16_t(v < 0 ? 0 : (v > 4095 ? 4095 : lrint(v)));
+			}
+			if (decimate) out[n] = dec.Next(readings.data(), 1, factor) / 16.0;
+			else out[n] = (readings[0] + readings[factor - 1]) / 2.0;
+		}
+		return out;
+	}
+};
+
+// Amplitude of the component of x at frequency hz, skipping the first samples while filters settle
+static double Amplitude(const std::vector<double> &x, double hz)
+{
+	double re = 0, im = 0;
+	unsigned count = 0;
+	for (unsigned n = 1000; n < N; n++, count++)
+	{
+		double w = 2.0 * M_PI * hz * n / sampleRate;
+		re += (x[n] - 2048.0) * cos(w);
+		im += (x[n] - 2048.0) * sin(w);
+	}
+	return 2.0 * sqrt(re * re + im * im) / count;
+}
+
+static double RMSAboutMean(const std::vector<double> &x)
+{
+	double sum = 0, sumSq = 0;
+	for (unsigned n = 1000; n < N; n++) sum += x[n];
+	double mean = sum / (N - 1000);
+	for (unsigned n = 1000; n < N; n++) sumSq += (x[n] - mean) * (x[n] - mean);
+	return sqrt(sumSq / (N - 1000));
+}
+
+static double dB(double ratio) { return 20.0 * log10(ratio > 1e-9 ? ratio : 1e-9); }
+
+int main(int argc, char **argv)
+{
+	double noiseLSB = 1.5; // approximate RMS noise of one RP2040 ADC reading
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--noise") && i + 1 < argc) noiseLSB = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Usage: %s [--noise LSB]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	const Filter filters[4] = {{2, false}, {2, true}, {4, false}, {4, true}};
+	const char *names[4] = {"2 readings, average", "2 readings, CIC+FIR", "4 readings, average", "4 readings, CIC+FIR"};
+	const double amplitude = 1000.0;
+
+	printf("Audio input filters at %.0fHz; gains relative to a %.0f LSB sine\n\n", sampleRate, amplitude);
+
+	const double passband[] = {1000, 5000, 10000, 14400, 20000};
+	printf("%-22s", "gain (dB) at");
+	for (double f : passband) printf("%9.0fHz", f);
+	printf("\n");
+	for (int k = 0; k < 4; k++)
+	{
+		printf("%-22s", names[k]);
+		for (double f : passband)
+		{
+			auto out = filters[k].Run([&](double t) { return amplitude * sin(2.0 * M_PI * f * t); });
+			printf("%11.2f", dB(Amplitude(out, f) / amplitude));
+		}
+		printf("\n");
+	}
+
+	// Input frequencies that alias to 5kHz and 14kHz
+	const double aliasIn[] = {43000, 53000, 91000, 101000, 34000, 62000};
+	printf("\n%-22s", "alias (dB) from");
+	for (double f : aliasIn) printf("%9.0fHz", f);
+	printf("\n");
+	for (int k = 0; k < 4; k++)
+	{
+		printf("%-22s", names[k]);
+		for (double f : aliasIn)
+		{
+			// Beyond the Nyquist frequency of the readings, the filter sees a lower alias anyway
+			double readingRate = sampleRate * filters[k].factor;
+			if (f >= readingRate / 2)
+			{
+				printf("%11s", "-");
+				continue;
+			}
+			double alias = fmod(f, sampleRate);
+			if (alias > sampleRate / 2) alias = sampleRate - alias;
+			auto out = filters[k].Run([&](double t) { return amplitude * sin(2.0 * M_PI * f * t); });
+			printf("%11.1f", dB(Amplitude(out, alias) / amplitude));
+		}
+		printf("\n");
+	}
+
+	printf("\nnoise (LSB rms), for %.2f LSB rms on each reading\n", noiseLSB);
+	for (int k = 0; k < 4; k++)
+	{
+		std::mt19937 rng(1);
+		std::normal_distribution<double> noise(0.0, noiseLSB);
+		auto out = filters[k].Run([&](double) { return 0.3 + noise(rng); });
+		double rms = RMSAboutMean(out);
+		printf("%-22s%11.3f  (%+.1f bits)\n", names[k], rms, log2(noiseLSB / rms));
+	}
+
+	// Time both inputs' filters over many samples, as BufferFull runs them
+	printf("\nhost time per sample, both inputs (budget at 48kHz: %.0fns)\n", 1e9 / sampleRate);
+	for (unsigned factor : {2u, 4u})
+	{
+		AudioDecimator dec[2];
+		dec[0].SetFactor(factor);
+		dec[1].SetFactor(factor);
+		std::vector<uint16_t> frames(8 * 4096);
+		std::mt19937 rng(2);
+		for (auto &w : frames) w = uint16_t(rng() & 0xFFF);
+
+		const unsigned reps = 2000;
+		volatile int32_t sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned r = 0; r < reps; r++)
+		{
+			for (unsigned n = 0; n < 4096; n++)
+			{
+				const uint16_t *frame = &frames[8 * n];
+				unsigned stride = 8 / factor;
+				sink = sink + dec[0].Next(frame, stride, factor) + dec[1].Next(frame + 1, stride, factor);
+			}
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (reps * 4096.0);
+		printf("%u readings: %.1fns (%.2f%% of budget)\n", factor, ns, 100.0 * ns * sampleRate / 1e9);
+	}
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+Model of the dither used for ComputerCard's 16-bit audio outputs
+(COMPUTERCARD_AUDIO_DITHER), comparing it with simply dropping the
+lowest bits, as a card producing 16-bit samples otherwise would.
+
+A quiet sine wave, as might be sent to AudioOutPrecise at the end of a
+reverb tail or fade, is reduced to 12-bit DAC values one 48kHz sample
+at a time, exactly as BufferFull does. The difference between the DAC
+values and the requested 16-bit values is the error. For each method,
+the program reports the signal-to-error ratio of the error in 0-4kHz
+(where noise shaping lowers it) and 0-20kHz, the largest single
+component of the error (a distortion product, if the error follows the
+signal), and the host time per sample.
+
+Usage: dither_model [--amplitude STEPS]
+Amplitude is in 12-bit DAC steps (default 2).
+Exits with status 1 if dither does not remove the distortion products
+of truncation from quiet signals (up to 100 steps), or noise shaping
+does not lower the error below 4kHz.
+*/
+
+#define COMPUTERCARD_NOIMPL
+#include "ComputerCard.h"
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const double sampleRate = 48000.0;
+static const unsigned logN = 16;
+static const unsigned N = 1u << logN; // samples in each test
+
+// In-place radix-2 FFT
+static void FFT(std::vector<std::complex<double>> &x)
+{
+	for (unsigned i = 1, j = 0; i < N; i++)
+	{
+		unsigned bit = N >> 1;
+		for (; j & bit; bit >>= 1) j ^= bit;
+		j ^= bit;
+		if (i < j) std::swap(x[i], x[j]);
+	}
+	for (unsigned len = 2; len <= N; len <<= 1)
+	{
+		std::complex<double> w = std::polar(1.0, -2.0 * M_PI / len);
+		for (unsigned i = 0; i < N; i += len)
+		{
+			std::complex<double> wk = 1.0;
+			for (unsigned k = 0; k < len / 2; k++)
+			{
+				std::complex<double> a = x[i + k], b = x[i + k + len / 2] * wk;
+				x[i + k] = a + b;
+				x[i + k + len / 2] = a - b;
+				wk *= w;
+			}
+		}
+	}
+}
+
+// Keeps the timing loops from being optimised away
+static volatile int32_t sink;
+
+// Dropping the lowest 4 bits, as AudioOutPrecise does without COMPUTERCARD_AUDIO_DITHER
+struct Truncate
+{
+	int32_t Next(int32_t value) {return value >> 4;}
+};
+
+struct Result
+{
+	double snr4k, snr20k; // dB
+	double worstSpur; // dB relative to the signal
+	double nsPerSample;
+};
+
+// Signal-to-error ratio (dB) for error within 0 to bandwidth, and the largest error component
+static double SNR(const std::vector<std::complex<double>> &spectrum, double signalPower, double bandwidth, double *worst)
+{
+	// Parseval: mean square error from the spectrum. DC is left out, as the outputs are AC coupled.
+	unsigned maxBin = unsigned(bandwidth * N / sampleRate);
+	double power = 0;
+	for (unsigned k = 1; k <= maxBin && k < N / 2; k++)
+	{
+		double p = 2.0 * std::norm(spectrum[k]) / (double(N) * N);
+		power += p;
+		if (worst && p > *worst) *worst = p;
+	}
+	return 10.0 * log10(signalPower / power);
+}
+
+template <typename Quantiser>
+static Result Measure(const std::vector<int32_t> &x, double amplitude)
+{
+	Result r;
+
+	// Error, in DAC steps
+	Quantiser quantiser;
+	std::vector<std::complex<double>> err(N);
+	for (unsigned n = 0; n < N; n++)
+	{
+		err[n] = quantiser.Next(x[n]) - x[n] / 16.0;
+	}
+	FFT(err);
+	double signalPower = amplitude * amplitude / 2;
+	double worst = 0;
+	r.snr4k = SNR(err, signalPower, 4000, nullptr);
+	r.snr20k = SNR(err, signalPower, 20000, &worst);
+	r.worstSpur = 10.0 * log10(worst / signalPower);
+
+	// Host timing, for comparison between methods only
+	const unsigned repeats = 200;
+	int32_t sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < repeats; i++)
+	{
+		for (unsigned n = 0; n < N; n++) sum += quantiser.Next(x[n]);
+	}
+	auto stop = std::chrono::steady_clock::now();
+	sink = sum;
+	r.nsPerSample = std::chrono::duration<double, std::nano>(stop - start).count() / (double(repeats) * N);
+	return r;
+}
+
+int main(int argc, char **argv)
+{
+	double amplitude = 2.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--amplitude") && i + 1 < argc) amplitude = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Usage: %s [--amplitude STEPS]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Sine wave at an exact FFT bin (~1kHz), as 16-bit sample values
+	const unsigned cycles = 1365;
+	std::vector<int32_t> x(N);
+	for (unsigned n = 0; n < N; n++)
+	{
+		x[n] = int32_t(lrint(amplitude * 16.0 * sin(2.0 * M_PI * cycles * n / N)));
+	}
+
+	printf("Audio output dither: %.1fHz sine, amplitude %.2f DAC steps (%.1fdBFS)\n",
+		   cycles * sampleRate / N, amplitude, 20.0 * log10(amplitude / 2048.0));
+	printf("method                   SNR 0-4kHz (dB)  SNR 0-20kHz (dB)  worst spur (dBc)  host ns/sample\n");
+
+	static const char *names[4] = {"truncate (no dither)", "mode 0: round", "mode 1: TPDF", "mode 2: TPDF + shaping"};
+	Result r[4] = {Measure<Truncate>(x, amplitude),
+				   Measure<AudioDither<0>>(x, amplitude),
+				   Measure<AudioDither<1>>(x, amplitude),
+				   Measure<AudioDither<2>>(x, amplitude)};
+	for (int i = 0; i < 4; i++)
+	{
+		printf("%-23s  %15.1f  %16.1f  %16.1f  %14.2f\n", names[i], r[i].snr4k, r[i].snr20k, r[i].worstSpur, r[i].nsPerSample);
+	}
+
+	// Dither should leave no distortion products standing above the noise, as truncation does for quiet
+	// signals (louder signals leave truncation error more like noise), and shaping should make the error
+	// below 4kHz quieter than truncation's
+	bool ok = r[3].snr4k > r[0].snr4k;
+	if (amplitude <= 100) ok = ok && r[2].worstSpur < r[0].worstSpur - 6 && r[3].worstSpur < r[0].worstSpur - 6;
+	if (!ok) printf("FAIL\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+# Native (Linux/macOS) build of ComputerCard examples, without the Pico SDK.
+# Included from CMakeLists.txt when configured with -DCOMPUTERCARD_HOST=ON.
+
+if (NOT CMAKE_BUILD_TYPE)
+  set(CMAKE_BUILD_TYPE Release)
+endif()
+
+find_package(Threads REQUIRED)
+
+set(COMPUTERCARD_HOST_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+add_library(computercard_host STATIC
+  ${COMPUTERCARD_HOST_DIR}/host_driver.cpp
+  ${COMPUTERCARD_HOST_DIR}/host_main.cpp)
+target_include_directories(computercard_host BEFORE PUBLIC ${COMPUTERCARD_HOST_DIR}/include ${COMPUTERCARD_HOST_DIR})
+target_compile_definitions(computercard_host PUBLIC COMPUTERCARD_HOST)
+target_compile_options(computercard_host PRIVATE -Wall -Wextra)
+target_link_libraries(computercard_host PUBLIC Threads::Threads)
+
+# As add_example in CMakeLists.txt, but building the card's main.cpp against
+# the emulated hardware, with its main() renamed so that host_main.cpp's
+# command-line front end runs instead.
+# Card main functions usually end in Run() with no return statement, which is
+# fine for main but warns once renamed; on the host, Run() exits by exception.
+macro (add_host_example _name)
+  add_executable(${_name} ${PROJECT_SOURCE_DIR}/examples/${_name}/main.cpp)
+  set_source_files_properties(${PROJECT_SOURCE_DIR}/examples/${_name}/main.cpp
+	PROPERTIES COMPILE_DEFINITIONS main=computercard_card_main)
+  target_compile_options(${_name} PRIVATE -Wdouble-promotion -Wfloat-conversion -Wall -Wextra -Wno-return-type)
+  target_include_directories(${_name} PUBLIC ${PROJECT_SOURCE_DIR})
+  target_include_directories(${_name} PUBLIC ${PROJECT_SOURCE_DIR}/examples/${_name}/)
+  target_link_libraries(${_name} computercard_host)
+endmacro()
+
+# Measures the noise added by the precise CV outputs' sigma-delta modulator
+add_executable(sigma_delta_model ${COMPUTERCARD_HOST_DIR}/sigma_delta_model.cpp)
+target_compile_options(sigma_delta_model PRIVATE -Wall -Wextra)
+target_include_directories(sigma_delta_model PUBLIC ${PROJECT_SOURCE_DIR})
+target_link_libraries(sigma_delta_model computercard_host)
+
+# Measures the noise and distortion of the audio output dither
+add_executable(dither_model ${COMPUTERCARD_HOST_DIR}/dither_model.cpp)
+target_compile_options(dither_model PRIVATE -Wall -Wextra)
+target_include_directories(dither_model PUBLIC ${PROJECT_SOURCE_DIR})
+target_link_libraries(dither_model computercard_host)
+
+# Checks the ADC calibration against modelled ADC non-linearity, alone and through ComputerCard
+add_executable(adc_calibration_model ${COMPUTERCARD_HOST_DIR}/adc_calibration_model.cpp)
+target_compile_options(adc_calibration_model PRIVATE -Wall -Wextra)
+target_include_directories(adc_calibration_model PUBLIC ${PROJECT_SOURCE_DIR})
+target_link_libraries(adc_calibration_model computercard_host)
+
+# Measures the response, aliasing, noise and cost of the audio input decimation filter
+add_executable(decimator_model ${COMPUTERCARD_HOST_DIR}/decimator_model.cpp)
+target_compile_options(decimator_model PRIVATE -Wall -Wextra)
+target_include_directories(decimator_model PUBLIC ${PROJECT_SOURCE_DIR})
+target_link_libraries(decimator_model computercard_host)
+
+# Tests FlashSettings for wear and for recovery from power failures, on simulated flash
+add_executable(settings_model ${COMPUTERCARD_HOST_DIR}/settings_model.cpp)
+target_compile_options(settings_model PRIVATE -Wall -Wextra)
+target_include_directories(settings_model PUBLIC ${PROJECT_SOURCE_DIR})
+target_link_libraries(settings_model computercard_host)
+
+# Tests the detection of and recovery from audio interrupt overruns, stalling the interrupt with cchost::Stall
+add_executable(overrun_model ${COMPUTERCARD_HOST_DIR}/overrun_model.cpp)
+target_compile_options(overrun_model PRIVATE -Wall -Wextra)
+target_include_directories(overrun_model PUBLIC ${PROJECT_SOURCE_DIR})
+target_link_libraries(overrun_model computercard_host)
+
+# Stress test of SPSCRing and Mailbox, with producer and consumer on two threads
+add_executable(spsc_stress ${COMPUTERCARD_HOST_DIR}/spsc_stress.cpp)
+target_compile_options(spsc_stress PRIVATE -Wall -Wextra)
+target_include_directories(spsc_stress PUBLIC ${PROJECT_SOURCE_DIR})
+target_link_libraries(spsc_stress computercard_host)
+
+# Converts a trace dump (TraceDump) to Chrome trace / Perfetto JSON
+add_executable(trace_decode ${COMPUTERCARD_HOST_DIR}/trace_decode.cpp)
+target_compile_options(trace_decode PRIVATE -Wall -Wextra)
+
+# Benchmark of the DSP of the released cards, built from their sources in the releases directory (see host/README.md).
+# Release code is built as released, without warnings.
+get_filename_component(COMPUTERCARD_RELEASES_DIR ${PROJECT_SOURCE_DIR}/../../../releases ABSOLUTE)
+if (EXISTS ${COMPUTERCARD_RELEASES_DIR})
+  set(TWISTS_DIR ${COMPUTERCARD_RELEASES_DIR}/10_twists/src)
+  set(BENCHMARK_RELEASE_SOURCES
+	${COMPUTERCARD_RELEASES_DIR}/20_reverb/reverb_dsp.c
+	${TWISTS_DIR}/braids/analog_oscillator.cc
+	${TWISTS_DIR}/braids/digital_oscillator.cc
+	${TWISTS_DIR}/braids/macro_oscillator.cc
+	${TWISTS_DIR}/braids/resources.cc
+	${TWISTS_DIR}/stmlib/utils/random.cc)
+  set_source_files_properties(${BENCHMARK_RELEASE_SOURCES} PROPERTIES COMPILE_OPTIONS -w)
+
+  add_executable(card_benchmark
+	${COMPUTERCARD_HOST_DIR}/benchmark/card_benchmark.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/kernels.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/null_card.cpp
+	${BENCHMARK_RELEASE_SOURCES})
+  set_source_files_properties(${COMPUTERCARD_HOST_DIR}/benchmark/card_benchmark.cpp ${COMPUTERCARD_HOST_DIR}/benchmark/kernels.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/null_card.cpp PROPERTIES COMPILE_OPTIONS "-Wall;-Wextra")
+  target_include_directories(card_benchmark PRIVATE ${COMPUTERCARD_HOST_DIR}/benchmark)
+  target_include_directories(card_benchmark SYSTEM PRIVATE
+	${COMPUTERCARD_RELEASES_DIR}/20_reverb
+	${TWISTS_DIR}
+	${COMPUTERCARD_RELEASES_DIR}/78_Talker/src)
+  target_link_libraries(card_benchmark computercard_host)
+
+  # Bit-exact regression check of the same cards, and of Twists' and reverb's DSP, against golden files in
+  # host/benchmark/golden. Golden renders are made again with git and cmake, from the commit of their golden file.
+  add_executable(golden_render
+	${COMPUTERCARD_HOST_DIR}/benchmark/golden_render.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/dsp_card.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/null_card.cpp
+	${BENCHMARK_RELEASE_SOURCES})
+  set_source_files_properties(${COMPUTERCARD_HOST_DIR}/benchmark/golden_render.cpp ${COMPUTERCARD_HOST_DIR}/benchmark/dsp_card.cpp
+	PROPERTIES COMPILE_OPTIONS "-Wall;-Wextra")
+  target_compile_definitions(golden_render PRIVATE GOLDEN_DIR="${COMPUTERCARD_HOST_DIR}/benchmark/golden"
+	COMPUTERCARD_SOURCE_DIR="${PROJECT_SOURCE_DIR}" COMPUTERCARD_RELEASES_DIR="${COMPUTERCARD_RELEASES_DIR}"
+	GOLDEN_CMAKE="${CMAKE_COMMAND}"
+	GOLDEN_CMAKE_ARGS="-DCMAKE_C_COMPILER=${CMAKE_C_COMPILER} -DCMAKE_CXX_COMPILER=${CMAKE_CXX_COMPILER} -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE}")
+  target_include_directories(golden_render PRIVATE ${COMPUTERCARD_HOST_DIR}/benchmark)
+  target_include_directories(golden_render SYSTEM PRIVATE ${COMPUTERCARD_RELEASES_DIR}/20_reverb ${TWISTS_DIR})
+  target_link_libraries(golden_render computercard_host)
+
+  # Several of the same cards, and Twists' and reverb's DSP, patched together, each in a process of its own
+  add_executable(patch_sim
+	${COMPUTERCARD_HOST_DIR}/benchmark/patch_sim.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/dsp_card.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/null_card.cpp
+	${BENCHMARK_RELEASE_SOURCES})
+  set_source_files_properties(${COMPUTERCARD_HOST_DIR}/benchmark/patch_sim.cpp PROPERTIES COMPILE_OPTIONS "-Wall;-Wextra")
+  target_include_directories(patch_sim PRIVATE ${COMPUTERCARD_HOST_DIR}/benchmark)
+  target_include_directories(patch_sim SYSTEM PRIVATE ${COMPUTERCARD_RELEASES_DIR}/20_reverb ${TWISTS_DIR})
+  target_link_libraries(patch_sim computercard_host)
+
+  # Fixed-point headroom of the same cards, and of reverb's DSP, built with checked integers (see checked_int.h)
+  add_executable(headroom_report
+	${COMPUTERCARD_HOST_DIR}/benchmark/headroom_report.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/null_card.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/reverb_checked.cpp)
+  set_source_files_properties(${COMPUTERCARD_HOST_DIR}/benchmark/headroom_report.cpp
+	PROPERTIES COMPILE_OPTIONS "-Wall;-Wextra")
+  set_source_files_properties(${COMPUTERCARD_HOST_DIR}/benchmark/reverb_checked.cpp PROPERTIES COMPILE_OPTIONS "-w")
+  target_compile_definitions(headroom_report PRIVATE REVERB_DIR="${COMPUTERCARD_RELEASES_DIR}/20_reverb")
+  target_include_directories(headroom_report PRIVATE ${COMPUTERCARD_HOST_DIR}/benchmark)
+  target_include_directories(headroom_report SYSTEM PRIVATE ${COMPUTERCARD_RELEASES_DIR}/20_reverb)
+  target_link_libraries(headroom_report computercard_host)
+
+  # Input fuzzer looking for slow calls of the same cards, and of Twists' and reverb's DSP
+  add_executable(card_fuzz
+	${COMPUTERCARD_HOST_DIR}/benchmark/card_fuzz.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/dsp_card.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/null_card.cpp
+	${BENCHMARK_RELEASE_SOURCES})
+  set_source_files_properties(${COMPUTERCARD_HOST_DIR}/benchmark/card_fuzz.cpp PROPERTIES COMPILE_OPTIONS "-Wall;-Wextra")
+  target_include_directories(card_fuzz PRIVATE ${COMPUTERCARD_HOST_DIR}/benchmark)
+  target_include_directories(card_fuzz SYSTEM PRIVATE ${COMPUTERCARD_RELEASES_DIR}/20_reverb ${TWISTS_DIR})
+  target_link_libraries(card_fuzz computercard_host)
+
+  # RAM used by the same cards, and by reverb's DSP, against the RAM an RP2040 has for a card. Reads this
+  # program's own symbols with nm for the size of each card's static variables.
+  add_executable(memory_report
+	${COMPUTERCARD_HOST_DIR}/benchmark/memory_report.cpp
+	${COMPUTERCARD_HOST_DIR}/benchmark/null_card.cpp)
+  target_compile_options(memory_report PRIVATE -Wall -Wextra)
+  target_compile_definitions(memory_report PRIVATE NM="${CMAKE_NM}")
+  target_include_directories(memory_report PRIVATE ${COMPUTERCARD_HOST_DIR}/benchmark)
+  target_include_directories(memory_report SYSTEM PRIVATE ${COMPUTERCARD_RELEASES_DIR}/20_reverb)
+  target_link_libraries(memory_report computercard_host)
+
+  # A card built on ComputerCard, from its directory in releases and the source file containing main(), followed by
+  # any COMPUTERCARD_* settings the card makes. Every card is built on this directory's ComputerCard.h, a copy of
+  # it for each card (see card.cpp). Floating-point operations
+  # aren't fused, so that golden renders made on one host match those on another. Each card is built
+  # again with checked integers for headroom_report.
+  macro (add_benchmark_card _name _dir _source)
+	add_library(card_benchmark_${_name} OBJECT ${COMPUTERCARD_HOST_DIR}/benchmark/card.cpp)
+	target_compile_definitions(card_benchmark_${_name} PRIVATE BENCH_CARD=${_name} BENCH_SOURCE="${_source}" ${ARGN})
+	target_compile_options(card_benchmark_${_name} PRIVATE -w -ffp-contract=off)
+	target_include_directories(card_benchmark_${_name} PRIVATE ${COMPUTERCARD_RELEASES_DIR}/${_dir} ${COMPUTERCARD_HOST_DIR}/benchmark ${PROJECT_SOURCE_DIR})
+	target_link_libraries(card_benchmark_${_name} computercard_host)
+	target_sources(card_benchmark PRIVATE $<TARGET_OBJECTS:card_benchmark_${_name}>)
+	target_sources(golden_render PRIVATE $<TARGET_OBJECTS:card_benchmark_${_name}>)
+	target_sources(patch_sim PRIVATE $<TARGET_OBJECTS:card_benchmark_${_name}>)
+	target_sources(card_fuzz PRIVATE $<TARGET_OBJECTS:card_benchmark_${_name}>)
+	target_sources(memory_report PRIVATE $<TARGET_OBJECTS:card_benchmark_${_name}>)
+
+	add_library(card_headroom_${_name} OBJECT ${COMPUTERCARD_HOST_DIR}/benchmark/card.cpp)
+	target_compile_definitions(card_headroom_${_name} PRIVATE BENCH_CARD=${_name} BENCH_SOURCE="${_source}" BENCH_CHECKED
+	  BENCH_DIR="${COMPUTERCARD_RELEASES_DIR}/${_dir}" ${ARGN})
+	target_compile_options(card_headroom_${_name} PRIVATE -w)
+	target_include_directories(card_headroom_${_name} PRIVATE ${COMPUTERCARD_RELEASES_DIR}/${_dir} ${COMPUTERCARD_HOST_DIR}/benchmark ${PROJECT_SOURCE_DIR})
+	target_link_libraries(card_headroom_${_name} computercard_host)
+	target_sources(headroom_report PRIVATE $<TARGET_OBJECTS:card_headroom_${_name}>)
+  endmacro()
+
+  add_benchmark_card(benjolin 04_BYO_Benjolin main.cpp)
+  add_benchmark_card(bumpers 07_bumpers/src bumpers.cpp COMPUTERCARD_CLAMP_CV_OUTPUTS=1)
+  add_benchmark_card(cvmod 14_cvmod cvmod.cpp COMPUTERCARD_CLAMP_CV_OUTPUTS=1)
+  add_benchmark_card(fifths 55_fifths main.cpp)
+  add_benchmark_card(goldfish 11_goldfish main.cpp)
+  add_benchmark_card(slowmod 23_SlowMod main.cpp)
+  add_benchmark_card(talker 78_Talker/src main.cpp)
+endif()
+
+# Examples that don't need USB
+add_host_example(adc_calibration)
+add_host_example(block_processing)
+add_host_example(clock_divider)
+add_host_example(control_rate)
+add_host_example(normalisation_probe)
+add_host_example(passthrough)
+add_host_example(profiler)
+add_host_example(sample_and_hold)
+add_host_example(second_core)
+add_host_example(second_core_audio)
+add_host_example(settings_store)
+add_host_example(sine_wave_lookup)
+add_host_example(sine_wave_float)
+add_host_example(trace)
+add_host_example(usb_detect)
@@ -0,0 +1,408 @@
+#include "host_driver.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace cchost
+{
+	static const char *controlNames[NumControls] = {
+		"main", "x", "y", "switch",
+		"audio1", "audio2", "cv1", "cv2", "pulse1", "pulse2",
+		"pulse1.hz", "pulse2.hz",
+		"plug.audio1", "plug.audio2", "plug.cv1", "plug.cv2", "plug.pulse1", "plug.pulse2"};
+
+	static int32_t Clamp(double v, int32_t lo, int32_t hi)
+	{
+		int32_t i = int32_t(lround(v));
+		return i < lo ? lo : (i > hi ? hi : i);
+	}
+
+	////////////////////////////////////////
+	// Automation
+
+	Automation::Automation()
+	{
+		tracks[Main].defaultValue = tracks[X].defaultValue = tracks[Y].defaultValue = 2048;
+		tracks[Switch].defaultValue = 1;
+	}
+
+	void Automation::Add(Control c, double seconds, double value, bool ramp)
+	{
+		Track &t = tracks[c];
+		if (seconds < 0) seconds = 0;
+		if (!t.keys.empty() && seconds < t.keys.back().seconds) t.sorted = false;
+		t.keys.push_back({seconds, value, ramp});
+	}
+
+	bool Automation::Load(const std::string &filename, std::string &error)
+	{
+		std::ifstream f(filename);
+		if (!f)
+		{
+			error = "cannot open " + filename;
+			return false;
+		}
+
+		std::string line;
+		for (int lineNum = 1; std::getline(f, line); lineNum++)
+		{
+			if (!ParseLine(line, filename + ":" + std::to_string(lineNum) + ": ", error)) return false;
+		}
+		return true;
+	}
+
+	bool Automation::ParseLine(const std::string &text, const std::string &where, std::string &error)
+	{
+		std::string line = text;
+		size_t hash = line.find('#');
+		if (hash != std::string::npos) line.erase(hash);
+
+		std::istringstream ss(line);
+		std::string timeStr, name, valueStr, rampStr;
+		if (!(ss >> timeStr)) return true; // blank line
+
+		if (!(ss >> name >> valueStr))
+		{
+			error = where + "expected <time> <control> <value> [ramp]";
+			return false;
+		}
+		bool ramp = false;
+		if (ss >> rampStr)
+		{
+			if (rampStr != "ramp")
+			{
+				error = where + "unexpected '" + rampStr + "'";
+				return false;
+			}
+			ramp = true;
+		}
+
+		int c = 0;
+		while (c < NumControls && name != controlNames[c]) c++;
+		if (c == NumControls)
+		{
+			error = where + "unknown control '" + name + "'";
+			return false;
+		}
+
+		double value;
+		if (valueStr == "down" || valueStr == "off") value = 0;
+		else if (valueStr == "middle" || valueStr == "on") value = 1;
+		else if (valueStr == "up") value = 2;
+		else
+		{
+			char *end;
+			value = strtod(valueStr.c_str(), &end);
+			if (*end)
+			{
+				error = where + "bad value '" + valueStr + "'";
+				return false;
+			}
+		}
+
+		char *end;
+		double t = strtod(timeStr.c_str(), &end);
+		if (*end || t < 0)
+		{
+			error = where + "bad time '" + timeStr + "'";
+			return false;
+		}
+
+		Add(Control(c), t, value, ramp);
+		return true;
+	}
+
+	double Automation::Value(Control c, double seconds)
+	{
+		Track &t = tracks[c];
+		if (t.keys.empty()) return t.defaultValue;
+		if (!t.sorted)
+		{
+			std::stable_sort(t.keys.begin(), t.keys.end(),
+							 [](const Keyframe &a, const Keyframe &b) { return a.seconds < b.seconds; });
+			t.sorted = true;
+			t.pos = 0;
+		}
+
+		while (t.pos + 1 < t.keys.size() && t.keys[t.pos + 1].seconds <= seconds) t.pos++;
+		const Keyframe &k = t.keys[t.pos];
+
+		if (seconds < k.seconds) // before first keyframe
+		{
+			if (!k.ramp) return t.defaultValue;
+			return t.defaultValue + (k.value - t.defaultValue) * seconds / k.seconds;
+		}
+		if (t.pos + 1 < t.keys.size() && t.keys[t.pos + 1].ramp)
+		{
+			const Keyframe &next = t.keys[t.pos + 1];
+			return k.value + (next.value - k.value) * (seconds - k.seconds) / (next.seconds - k.seconds);
+		}
+		return k.value;
+	}
+
+	////////////////////////////////////////
+	// HostDriver
+
+	bool HostDriver::Open(const HostOptions &opts, std::string &error)
+	{
+		if (!opts.inAudio.empty())
+		{
+			if (!audioIn.Open(opts.inAudio, error)) return false;
+			haveAudioIn = true;
+		}
+		if (!opts.inCV.empty())
+		{
+			if (!cvIn.Open(opts.inCV, error)) return false;
+			haveCVIn = true;
+		}
+		if (!opts.script.empty() && !automation.Load(opts.script, error)) return false;
+
+		if (!opts.eeprom.empty())
+		{
+			FILE *f = fopen(opts.eeprom.c_str(), "rb");
+			if (!f)
+			{
+				error = "cannot open " + opts.eeprom;
+				return false;
+			}
+			size_t n = fread(state.eeprom, 1, sizeof(state.eeprom), f);
+			(void)n;
+			fclose(f);
+		}
+
+		// A missing flash image starts erased, as on a new card, and is created on Close
+		flashImage = opts.flash;
+		if (!flashImage.empty())
+		{
+			if (FILE *f = fopen(flashImage.c_str(), "rb"))
+			{
+				size_t n = fread(FlashMemory(state), 1, PICO_FLASH_SIZE_BYTES, f);
+				(void)n;
+				fclose(f);
+			}
+		}
+
+		// Lengths in seconds depend on the card's sample rate, so are converted as the card runs
+		totalSamples = opts.samples;
+		totalSeconds = opts.seconds;
+		if (!totalSamples && totalSeconds <= 0)
+		{
+			totalSamples = std::max(haveAudioIn ? audioIn.Frames() : 0, haveCVIn ? cvIn.Frames() : 0);
+			if (!totalSamples) totalSeconds = 1;
+		}
+
+		// Output WAV headers are updated to the card's sample rate on Close
+		if (!opts.outAudio.empty() && !audioOut.Open(opts.outAudio, 2, state.sampleRate))
+		{
+			error = "cannot write " + opts.outAudio;
+			return false;
+		}
+		if (!opts.outCV.empty() && !cvOut.Open(opts.outCV, 2, state.sampleRate))
+		{
+			error = "cannot write " + opts.outCV;
+			return false;
+		}
+		if (!opts.outEvents.empty())
+		{
+			events = fopen(opts.outEvents.c_str(), "w");
+			if (!events)
+			{
+				error = "cannot write " + opts.outEvents;
+				return false;
+			}
+			fprintf(events, "sample,time,output,value\n");
+		}
+
+		// Jacks receiving input are plugged in, unless the script says otherwise
+		for (int i = 0; i < 6; i++)
+		{
+			Control plug = Control(PlugAudio1 + i);
+			bool fed = automation.HasKeyframes(Control(Audio1 + i)) ||
+				(i < 2 && haveAudioIn) || (i >= 2 && i < 4 && haveCVIn) ||
+				(i >= 4 && automation.HasKeyframes(Control(Pulse1Hz + i - 4)));
+			if (!automation.HasKeyframes(plug)) automation.Add(plug, 0, fed, false);
+		}
+		return true;
+	}
+
+	void HostDriver::Run(int (*cardMain)())
+	{
+		currentState = &state;
+		currentDriver = this;
+		try
+		{
+			cardMain();
+		}
+		catch (const StopRender &)
+		{
+		}
+		currentDriver = nullptr;
+		currentState = &defaultState;
+	}
+
+	void HostDriver::RunDSP(DSP &dsp, uint32_t sampleRate)
+	{
+		state.sampleRate = sampleRate;
+		while (state.sample < SamplesRequested())
+		{
+			ApplyInputs();
+			OutputValues out = {};
+			dsp.Process(state.in, out);
+			state.sample++;
+			CaptureOutputs(out);
+		}
+	}
+
+	void HostDriver::ApplyInputs()
+	{
+		uint64_t n = state.sample;
+		double t = double(n) / state.sampleRate; // automation time
+		Inputs &in = state.in;
+
+		in.knob[0] = Clamp(automation.Value(Main, t), 0, 4095);
+		in.knob[1] = Clamp(automation.Value(X, t), 0, 4095);
+		in.knob[2] = Clamp(automation.Value(Y, t), 0, 4095);
+		in.switchPos = Clamp(automation.Value(Switch, t), 0, 2);
+
+		for (int i = 0; i < 2; i++)
+		{
+			double a = automation.Value(Control(Audio1 + i), t);
+			if (haveAudioIn) a += audioIn.Sample(n, i) >> 4;
+			in.audio[i] = Clamp(a, -2048, 2047);
+
+			double c = automation.Value(Control(CV1 + i), t);
+			if (haveCVIn) c += cvIn.Sample(n, i) >> 4;
+			in.cv[i] = Clamp(c, -2048, 2047);
+
+			// Pulse input is high if either scripted high, or in the first half of the clock cycle
+			double hz = automation.Value(Control(Pulse1Hz + i), t);
+			bool clock = false;
+			if (hz > 0)
+			{
+				clock = pulsePhase[i] < 0.5;
+				pulsePhase[i] += hz / state.sampleRate;
+				pulsePhase[i] -= floor(pulsePhase[i]);
+			}
+			else
+			{
+				pulsePhase[i] = 0;
+			}
+			in.pulse[i] = clock || automation.Value(Control(Pulse1 + i), t) >= 0.5;
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			in.plugged[i] = automation.Value(Control(PlugAudio1 + i), t) >= 0.5;
+		}
+
+		if (cables) cables->Inputs(n, in);
+	}
+
+	void HostDriver::Event(const char *name, int value)
+	{
+		uint64_t n = state.sample - 1; // sample period just emulated
+		fprintf(events, "%llu,%.6f,%s,%d\n", (unsigned long long)n, double(n) / state.sampleRate, name, value);
+	}
+
+	OutputValues HostDriver::ReadOutputs() const
+	{
+		OutputValues out;
+		const int cvPins[2] = {23, 22}; // CV_OUT_1, CV_OUT_2
+		for (int i = 0; i < 2; i++)
+		{
+			// Audio outputs: DAC words are inverted by the output amplifiers
+			out.audio[i] = Clamp(2048 - int32_t(state.dac[i]), -2048, 2047);
+
+			// CV outputs: PWM duty cycle, also inverted
+			uint32_t top = state.pwmTop[pwm_gpio_to_slice_num(cvPins[i])] + 1u;
+			out.cv[i] = Clamp(2047 - int32_t(state.pwmLevel[cvPins[i]] * 4096u / top), -2048, 2047);
+
+			// Pulse outputs: inverted GPIO, or PWM at under 50% duty
+			int pin = 8 + i;
+			if (state.gpioFunc[pin] == GPIO_FUNC_PWM)
+				out.pulse[i] = state.pwmLevel[pin] * 2u < state.pwmTop[pwm_gpio_to_slice_num(pin)] + 1u;
+			else
+				out.pulse[i] = !state.gpioOut[pin];
+		}
+		return out;
+	}
+
+	void HostDriver::CaptureOutputs(const OutputValues &out)
+	{
+		if (cables) cables->Outputs(state.sample - 1, out);
+
+		if (audioOut.IsOpen())
+		{
+			int16_t frame[2] = {int16_t(out.audio[0] * 16), int16_t(out.audio[1] * 16)};
+			audioOut.Write(frame);
+		}
+		if (cvOut.IsOpen())
+		{
+			int16_t frame[2] = {int16_t(out.cv[0] * 16), int16_t(out.cv[1] * 16)};
+			cvOut.Write(frame);
+		}
+
+		if (!events) return;
+
+		for (int i = 0; i < 2; i++)
+		{
+			if (out.pulse[i] != lastPulseOut[i])
+			{
+				lastPulseOut[i] = out.pulse[i];
+				Event(i ? "pulse2" : "pulse1", out.pulse[i]);
+			}
+		}
+
+		// LEDs, as 8-bit brightness
+		static const char *ledNames[6] = {"led0", "led1", "led2", "led3", "led4", "led5"};
+		for (int i = 0; i < 6; i++)
+		{
+			int pin = 10 + i;
+			uint32_t top = state.pwmTop[pwm_gpio_to_slice_num(pin)] + 1u;
+			int level = int(std::min(state.pwmLevel[pin] * 256u / top, 255u));
+			if (level != lastLED[i])
+			{
+				lastLED[i] = level;
+				Event(ledNames[i], level);
+			}
+		}
+	}
+
+	void HostDriver::Tick()
+	{
+		if (state.sample >= SamplesRequested()) throw StopRender();
+		ApplyInputs();
+		RunSample();
+		CaptureOutputs(ReadOutputs());
+	}
+
+	void HostDriver::Close()
+	{
+		audioOut.SetRate(state.sampleRate);
+		cvOut.SetRate(state.sampleRate);
+		audioOut.Close();
+		cvOut.Close();
+		if (events)
+		{
+			fclose(events);
+			events = nullptr;
+		}
+		if (!flashImage.empty())
+		{
+			if (FILE *f = fopen(flashImage.c_str(), "wb"))
+			{
+				fwrite(FlashMemory(state), 1, PICO_FLASH_SIZE_BYTES, f);
+				fclose(f);
+			}
+		}
+	}
+
+	// Core 1 threads run freely; core 0 advances emulated time
+	void Tick()
+	{
+		if (coreNum != 0) return;
+		if (currentDriver) currentDriver->Tick();
+		else RunSample();
+	}
+}
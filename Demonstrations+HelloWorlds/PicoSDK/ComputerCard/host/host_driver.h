@@ -0,0 +1,184 @@
+/*
+Host driver for ComputerCard programs built with COMPUTERCARD_HOST.
+
+The driver owns one emulated Computer (cchost::State). Each time the card's
+AudioWorker loop calls tight_loop_contents(), the driver:
+ - sets knobs, switch and input jacks from WAV files and a control script,
+ - emulates one sample period (cchost::RunSample), and
+ - records the audio, CV, pulse and LED outputs to WAV and CSV files.
+
+When the requested number of samples has been rendered, Tick throws
+cchost::StopRender, which unwinds out of the card's Run() call.
+
+
+Control script format, one keyframe per line:
+
+    <time in seconds> <control> <value> [ramp]
+
+Controls:
+    main, x, y          knobs, 0 to 4095
+    switch              down, middle, up (or 0, 1, 2)
+    audio1, audio2      audio inputs, -2048 to 2047 (added to any WAV input)
+    cv1, cv2            CV inputs, -2048 to 2047 (added to any WAV input)
+    pulse1, pulse2      pulse inputs, 0 or 1
+    pulse1.hz, pulse2.hz  square wave clock on pulse input, 0 to stop
+    plug.<input>        1 to plug a cable into <input> (e.g. plug.cv1), 0 to remove
+
+A control holds each value until its next keyframe. With 'ramp', the
+control instead ramps linearly from the previous keyframe to this one.
+Inputs are plugged if they receive a WAV file or any script keyframe,
+unless overridden by plug.<input>. Lines starting with # are ignored.
+*/
+
+#ifndef HOST_DRIVER_H
+#define HOST_DRIVER_H
+
+#include "pico_host.h"
+#include "wav_file.h"
+
+#include <string>
+#include <vector>
+
+namespace cchost
+{
+	// Thrown from Tick once all requested samples are rendered
+	struct StopRender
+	{
+	};
+
+	enum Control
+	{
+		Main, X, Y, Switch,
+		Audio1, Audio2, CV1, CV2, Pulse1, Pulse2,
+		Pulse1Hz, Pulse2Hz,
+		PlugAudio1, PlugAudio2, PlugCV1, PlugCV2, PlugPulse1, PlugPulse2,
+		NumControls
+	};
+
+	// Keyframed values for every control
+	class Automation
+	{
+	public:
+		Automation();
+
+		// Parse a control script file; returns false and sets error on failure
+		bool Load(const std::string &filename, std::string &error);
+
+		// Parse one line of a control script; where (e.g. "file:line: ") prefixes any error
+		bool ParseLine(const std::string &line, const std::string &where, std::string &error);
+
+		// Add a single keyframe. Keyframes need not be added in time order.
+		void Add(Control c, double seconds, double value, bool ramp);
+
+		bool HasKeyframes(Control c) const { return !tracks[c].keys.empty(); }
+
+		// Value of control c at the given time. Calls must have non-decreasing times.
+		double Value(Control c, double seconds);
+
+	private:
+		struct Keyframe
+		{
+			double seconds;
+			double value;
+			bool ramp;
+		};
+		struct Track
+		{
+			std::vector<Keyframe> keys;
+			size_t pos = 0;
+			double defaultValue = 0;
+			bool sorted = true;
+		};
+		Track tracks[NumControls];
+	};
+
+	// Outputs of one sample, on the same scale as the inputs: audio and CV -2048 to 2047
+	struct OutputValues
+	{
+		int32_t audio[2];
+		int32_t cv[2];
+		bool pulse[2];
+	};
+
+	// Connects a card's jacks to other cards' (see patch_sim.cpp). Inputs is called before each sample
+	// is emulated, to add to the inputs set from WAV files and the script, and Outputs after it.
+	class PatchCables
+	{
+	public:
+		virtual ~PatchCables() {}
+		virtual void Inputs(uint64_t sample, Inputs &in) = 0;
+		virtual void Outputs(uint64_t sample, const OutputValues &out) = 0;
+	};
+
+	// Processing run by the driver in place of a card and the emulated hardware (see HostDriver::RunDSP),
+	// for DSP not built on ComputerCard: given each sample's inputs, it sets that sample's outputs
+	class DSP
+	{
+	public:
+		virtual ~DSP() {}
+		virtual void Process(const Inputs &in, OutputValues &out) = 0;
+	};
+
+	struct HostOptions
+	{
+		std::string inAudio, inCV, script, eeprom, flash;
+		std::string outAudio = "out.wav", outCV, outEvents;
+		uint64_t samples = 0; // 0 = seconds, or length of input WAV, or one second
+		double seconds = 0;   // length in seconds, converted at the card's sample rate
+	};
+
+	class HostDriver
+	{
+	public:
+		// Load inputs and open output files
+		bool Open(const HostOptions &opts, std::string &error);
+
+		// Run the card's main function until StopRender is thrown or it returns
+		void Run(int (*cardMain)());
+
+		// Run dsp at the given sample rate for the requested number of samples, with the same inputs,
+		// cables and output files as a card. LEDs are left off.
+		void RunDSP(DSP &dsp, uint32_t sampleRate);
+
+		// One sample period: inputs, emulation, outputs
+		void Tick();
+
+		// Flush and close output files
+		void Close();
+
+		uint64_t SamplesRendered() const { return state.sample; }
+		uint64_t SamplesRequested() const
+		{
+			return totalSamples ? totalSamples : uint64_t(llround(totalSeconds * state.sampleRate));
+		}
+
+		// Card's sample rate, known once it has started the ADC
+		uint32_t SampleRate() const { return state.sampleRate; }
+
+		State state;
+		Automation automation;
+		PatchCables *cables = nullptr;
+
+	private:
+		void ApplyInputs();
+		OutputValues ReadOutputs() const;
+		void CaptureOutputs(const OutputValues &out);
+		void Event(const char *name, int value);
+
+		WavReader audioIn, cvIn;
+		bool haveAudioIn = false, haveCVIn = false;
+		WavWriter audioOut, cvOut;
+		FILE *events = nullptr;
+		std::string flashImage; // written back on Close
+		uint64_t totalSamples = 0; // if zero, length is totalSeconds
+		double totalSeconds = 0;
+		double pulsePhase[2] = {0, 0};
+		int lastPulseOut[2] = {-1, -1};
+		int lastLED[6] = {-1, -1, -1, -1, -1, -1};
+	};
+
+	// Driver receiving Tick() calls on this thread
+	inline thread_local HostDriver *currentDriver = nullptr;
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+Command-line front end for ComputerCard host builds.
+
+Each host example is the card's own main.cpp, compiled with main renamed
+to computercard_card_main, linked with this file. See README.md.
+*/
+
+#include "host_driver.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int computercard_card_main();
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  --in-audio FILE    16-bit WAV into audio inputs 1 (left) and 2 (right)\n"
+			"  --in-cv FILE       16-bit WAV into CV inputs 1 (left) and 2 (right)\n"
+			"  --script FILE      knob, switch and input automation (see host_driver.h)\n"
+			"  --eeprom FILE      2kB EEPROM image (calibration data)\n"
+			"  --flash FILE       flash image, read if it exists and written back at the end\n"
+			"  --out-audio FILE   stereo WAV of audio outputs (default out.wav)\n"
+			"  --out-cv FILE      stereo WAV of CV outputs\n"
+			"  --out-events FILE  CSV of pulse output and LED changes\n"
+			"  --seconds S        length to render (default: input WAV length, or 1s)\n"
+			"  --samples N        length to render, in samples at the card's sample rate\n"
+			"  --quiet            don't print timing summary\n",
+			prog);
+}
+
+int main(int argc, char **argv)
+{
+	cchost::HostOptions opts;
+	bool quiet = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		std::string *target = nullptr;
+
+		if (!strcmp(a, "--in-audio")) target = &opts.inAudio;
+		else if (!strcmp(a, "--in-cv")) target = &opts.inCV;
+		else if (!strcmp(a, "--script")) target = &opts.script;
+		else if (!strcmp(a, "--eeprom")) target = &opts.eeprom;
+		else if (!strcmp(a, "--flash")) target = &opts.flash;
+		else if (!strcmp(a, "--out-audio")) target = &opts.outAudio;
+		else if (!strcmp(a, "--out-cv")) target = &opts.outCV;
+		else if (!strcmp(a, "--out-events")) target = &opts.outEvents;
+		else if (!strcmp(a, "--quiet"))
+		{
+			quiet = true;
+			continue;
+		}
+		else if ((!strcmp(a, "--seconds") || !strcmp(a, "--samples")) && v)
+		{
+			double n = atof(v);
+			if (a[2] == 's' && a[3] == 'e') opts.seconds = n > 0 ? n : 0;
+			else opts.samples = n > 0 ? uint64_t(n + 0.5) : 0;
+			i++;
+			continue;
+		}
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+
+		if (!v)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		*target = v;
+		i++;
+	}
+
+	cchost::HostDriver driver;
+	std::string error;
+	if (!driver.Open(opts, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	driver.Run(computercard_card_main);
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	driver.Close();
+
+	if (!quiet)
+	{
+		double rendered = double(driver.SamplesRendered()) / driver.SampleRate();
+		fprintf(stderr, "Rendered %.3fs of audio in %.3fs (%.1fx real time)\n",
+				rendered, elapsed, elapsed > 0 ? rendered / elapsed : 0.0);
+	}
+
+	// Second-core threads may still be running, so skip static destructors
+	fflush(nullptr);
+	_Exit(0);
+}
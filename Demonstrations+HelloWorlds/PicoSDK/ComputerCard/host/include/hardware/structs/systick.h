@@ -0,0 +1,2 @@
+// Host build stand-in for the Pico SDK header of the same name: see pico_host.h
+#include "../../pico_host.h"
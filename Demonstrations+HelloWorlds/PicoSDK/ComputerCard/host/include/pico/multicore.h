@@ -0,0 +1,71 @@
+// Host build stand-in for pico/multicore.h: see pico_host.h
+//
+// Core 1 is a host thread sharing the emulated hardware of the thread that
+// launched it. It runs freely, rather than in step with emulated time.
+
+#ifndef PICO_HOST_MULTICORE_H
+#define PICO_HOST_MULTICORE_H
+
+#include "../pico_host.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace cchost
+{
+	// Inter-core FIFOs, one in each direction
+	struct FIFO
+	{
+		std::mutex m;
+		std::condition_variable cv;
+		std::deque<uint32_t> q;
+
+		void Push(uint32_t v)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m);
+				q.push_back(v);
+			}
+			cv.notify_all();
+		}
+		uint32_t Pop()
+		{
+			std::unique_lock<std::mutex> lock(m);
+			cv.wait(lock, [this] { return !q.empty(); });
+			uint32_t v = q.front();
+			q.pop_front();
+			return v;
+		}
+		bool Ready()
+		{
+			std::lock_guard<std::mutex> lock(m);
+			return !q.empty();
+		}
+	};
+	inline FIFO fifo[2]; // indexed by receiving core
+}
+
+inline void multicore_launch_core1(void (*entry)(void))
+{
+	cchost::State *state = cchost::currentState;
+	std::thread([state, entry] {
+		cchost::currentState = state;
+		cchost::coreNum = 1;
+		entry();
+	}).detach();
+}
+inline void multicore_reset_core1() {}
+
+inline void multicore_fifo_push_blocking(uint32_t data) { cchost::fifo[1 - get_core_num()].Push(data); }
+inline uint32_t multicore_fifo_pop_blocking() { return cchost::fifo[get_core_num()].Pop(); }
+inline bool multicore_fifo_rvalid() { return cchost::fifo[get_core_num()].Ready(); }
+inline bool multicore_fifo_wready() { return true; }
+inline void multicore_fifo_drain() {}
+
+inline void multicore_lockout_victim_init() {}
+inline void multicore_lockout_start_blocking() {}
+inline void multicore_lockout_end_blocking() {}
+
+#endif
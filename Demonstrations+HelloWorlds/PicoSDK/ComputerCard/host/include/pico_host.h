@@ -0,0 +1,1070 @@
+/*
+Host (Linux) stand-in for the parts of the RPi Pico SDK used by ComputerCard.
+
+The hardware/ and pico/ headers in this directory all include this file,
+so that ComputerCard.h and cards built with COMPUTERCARD_HOST compile
+unmodified on a desktop machine.
+
+Rather than just stubbing out the SDK, the GPIO, PWM, ADC, DMA, SPI,
+I2C and IRQ blocks are modelled closely enough that the real
+ComputerCard::AudioWorker / BufferFull code runs: the ADC fills DMA
+buffers from the external mux, DMA completion calls the DMA_IRQ_0
+handler, and words written to the SPI data register are decoded as
+DAC outputs.
+
+Time only advances when the host driver calls cchost::RunSample(),
+which it does from tight_loop_contents() (called in the AudioWorker
+wait loop). Each call emulates one audio sample period, at the
+sample rate the card set up (48kHz unless given to its constructor).
+Code that should take longer, such as a deliberately slow
+ProcessSample, can call cchost::Stall().
+*/
+
+#ifndef PICO_HOST_H
+#define PICO_HOST_H
+
+#ifdef __cplusplus
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#else
+// C sources, such as a card's DSP code, get only the platform macros and types
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+typedef unsigned int uint;
+
+#ifndef M_TWOPI
+#define M_TWOPI (M_PI * 2.0)
+#endif
+
+////////////////////////////////////////
+// pico/platform.h
+
+// As the Pico SDK's own host build: code reading the RP2040's memory map, such as ComputerCard::MemoryUsage, is left out
+#define PICO_NO_HARDWARE 1
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define __uninitialized_ram(group) group
+#define __in_flash(group)
+#define __force_inline inline
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+
+#define __compiler_memory_barrier() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __dmb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __dsb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __isb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __wfe()
+#define __sev()
+#define __nop()
+
+#ifdef __cplusplus
+
+// As on the RP2040, report the error and stop
+[[noreturn]] inline void panic(const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	abort();
+}
+
+inline uint get_core_num();
+
+////////////////////////////////////////
+// Register-level definitions used by ComputerCard
+
+typedef volatile uint32_t io_rw_32;
+typedef volatile uint32_t io_wo_32;
+typedef const volatile uint32_t io_ro_32;
+
+#define DMA_CH0_CTRL_TRIG_EN_BITS 0x00000001
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB 2
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS 0x0000000c
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS 0x00000010
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS 0x00000020
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_LSB 6
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_BITS 0x000003c0
+#define DMA_CH0_CTRL_TRIG_RING_SEL_BITS 0x00000400
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB 11
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS 0x00007800
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB 15
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS 0x001f8000
+
+inline void hw_write_masked(io_rw_32 *addr, uint32_t values, uint32_t write_mask)
+{
+	*addr = (*addr & ~write_mask) | (values & write_mask);
+}
+inline void hw_set_bits(io_rw_32 *addr, uint32_t mask) { *addr |= mask; }
+inline void hw_clear_bits(io_rw_32 *addr, uint32_t mask) { *addr &= ~mask; }
+
+// Register blocks. Addresses are uintptr_t rather than 32-bit, to hold host pointers.
+
+typedef struct
+{
+	io_rw_32 cs, result, fcs, fifo, div, intr, inte, intf, ints;
+} adc_hw_t;
+
+typedef struct
+{
+	io_rw_32 cr0, cr1, dr, sr, cpsr, imsc, ris, mis, icr, dmacr;
+} spi_hw_t;
+
+typedef struct
+{
+	volatile uintptr_t read_addr, write_addr;
+	io_rw_32 transfer_count;
+	io_rw_32 ctrl_trig;
+	io_rw_32 al1_ctrl;
+} dma_channel_hw_t;
+
+// Write-1-to-clear register, such as DMA INTS0
+struct io_w1c_32
+{
+	volatile uint32_t bits;
+	operator uint32_t() const { return bits; }
+	io_w1c_32 &operator=(uint32_t clear)
+	{
+		bits &= ~clear;
+		return *this;
+	}
+};
+
+typedef struct
+{
+	io_rw_32 csr, div, ctr, cc, top;
+} pwm_slice_hw_t;
+
+typedef struct
+{
+	pwm_slice_hw_t slice[8];
+	io_rw_32 en, intr, inte, intf, ints;
+} pwm_hw_t;
+
+typedef struct
+{
+	dma_channel_hw_t ch[12];
+	io_rw_32 intr, inte0, intf0;
+	io_w1c_32 ints0;
+	io_rw_32 timer[4];
+	io_rw_32 abort;
+} dma_hw_t;
+
+////////////////////////////////////////
+// Emulated hardware state
+
+typedef void (*irq_handler_t)(void);
+
+namespace cchost
+{
+	constexpr uint32_t defaultSampleRate = 48000;
+	constexpr uint32_t adcClockHz = 48000000;
+	constexpr uint32_t sysClockHz = 125000000;
+	constexpr int numGPIO = 30;
+	constexpr int numDMA = 12;
+	constexpr int numIRQ = 32;
+
+	// Input jacks, knobs and switch, in ComputerCard units, set by the host driver
+	struct Inputs
+	{
+		int32_t audio[2] = {0, 0}; // -2048 to 2047
+		int32_t cv[2] = {0, 0};    // -2048 to 2047
+		int32_t knob[3] = {2048, 2048, 2048}; // 0-4095, Main, X, Y
+		int32_t switchPos = 1;     // 0 = down, 1 = middle, 2 = up
+		bool pulse[2] = {false, false};
+		bool plugged[6] = {false, false, false, false, false, false}; // Audio1, Audio2, CV1, CV2, Pulse1, Pulse2
+		uint8_t boardID = 0x0C;    // Rev1_1
+	};
+
+	// DMA channel state not visible in registers
+	struct DMAChannel
+	{
+		uint32_t reload; // count loaded on trigger
+		bool busy;
+		bool irq0;
+	};
+
+	struct State
+	{
+		uint64_t sample = 0;     // emulated time, in samples
+		uint32_t sampleRate = defaultSampleRate; // inferred from the ADC and DMA set-up when the ADC starts
+
+		// GPIO
+		bool gpioOut[numGPIO] = {};
+		bool gpioDir[numGPIO] = {};
+		int gpioFunc[numGPIO] = {};
+		bool pullUp[numGPIO] = {};
+		bool pullDown[numGPIO] = {};
+
+		// PWM (8 slices, level per GPIO)
+		uint16_t pwmTop[8] = {};
+		uint16_t pwmDiv[8] = {};   // clock divider, with 4 fractional bits
+		uint16_t pwmLevel[numGPIO] = {};
+		uint64_t pwmWrapAcc[8] = {}; // fractional wraps carried between samples
+
+		// ADC
+		bool adcRunning = false;
+		uint32_t adcRoundRobin = 0;
+		uint32_t adcInput = 0;
+		float adcClkdiv = 0;
+		uint32_t adcConversionsPerSample = 8;
+		uint16_t adcFifo[4] = {}; // conversions waiting for DMA
+		uint32_t adcFifoLevel = 0;
+
+		// Register blocks
+		adc_hw_t adcRegs = {};
+		spi_hw_t spiRegs[2] = {};
+		dma_hw_t dmaRegs = {};
+		pwm_hw_t pwmRegs = {}; // for DMA to the PWM; levels are kept in pwmLevel
+
+		// DMA
+		DMAChannel dma[numDMA] = {};
+		uint32_t dmaClaimed = 0;
+		uint32_t dmaTimerClaimed = 0;
+		uint16_t dmaTimerNum[4] = {}, dmaTimerDen[4] = {};
+		uint64_t dmaTimerAcc[4] = {}; // fractional timer pulses carried between samples
+
+		// IRQ
+		irq_handler_t irqHandler[numIRQ] = {};
+		bool irqEnabled[numIRQ] = {};
+		bool inIRQ = false;
+		uint64_t irqHostNs = 0; // host wall-clock time spent in interrupt handlers, for benchmarks
+
+		// SPI DAC (MCP4822), last 12-bit word written to each channel
+		uint16_t dac[2] = {0x800, 0x800};
+
+		// I2C EEPROM (24LC16-style, 2kB), address pointer
+		uint8_t eeprom[2048];
+		uint16_t eepromPtr = 0;
+
+		uint8_t flashID[8] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0};
+
+		// Flash contents (allocated, erased, on first use), erase count of each sector,
+		// and bytes left to erase or program before an injected power failure (-1 for none)
+		std::vector<uint8_t> flash;
+		std::vector<uint32_t> flashErases;
+		int64_t flashFailCountdown = -1;
+		uint32_t flashNoise = 1;
+
+		Inputs in;
+
+		// ADC code produced for each input level 0-4095: ideal unless set otherwise, e.g. to model DNL
+		uint16_t adcTransfer[4096];
+
+		State()
+		{
+			memset(eeprom, 0xFF, sizeof(eeprom));
+			for (int i = 0; i < 4096; i++) adcTransfer[i] = uint16_t(i);
+		}
+	};
+
+	// Each host thread emulates its own Computer, unless it is a 'second core'
+	// thread started with multicore_launch_core1, which shares its parent's state.
+	inline State defaultState;
+	inline thread_local State *currentState = &defaultState;
+	inline thread_local uint coreNum = 0;
+	inline State &HW() { return *currentState; }
+
+	// Called by tight_loop_contents(). Implemented by the host driver: applies
+	// input automation, calls RunSample, then captures outputs.
+	void Tick();
+
+	inline void RunSample();
+	inline void ADCStarted();
+
+	// Emulate code that takes the given number of sample periods to run, such as a slow ProcessSample,
+	// to see how a card copes with overruns. Interrupts due meanwhile run when the current one returns.
+	inline void Stall(uint32_t samples)
+	{
+		for (uint32_t i = 0; i < samples; i++) Tick();
+	}
+}
+
+inline uint get_core_num() { return cchost::coreNum; }
+inline void tight_loop_contents() { cchost::Tick(); }
+
+////////////////////////////////////////
+// hardware/gpio.h
+
+enum gpio_function { GPIO_FUNC_XIP = 0, GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_I2C = 3, GPIO_FUNC_PWM = 4,
+					 GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6, GPIO_FUNC_PIO1 = 7, GPIO_FUNC_GPCK = 8, GPIO_FUNC_USB = 9, GPIO_FUNC_NULL = 0x1f };
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+inline void gpio_init(uint gpio)
+{
+	cchost::HW().gpioFunc[gpio] = GPIO_FUNC_SIO;
+	cchost::HW().gpioDir[gpio] = false;
+	cchost::HW().gpioOut[gpio] = false;
+}
+inline void gpio_set_function(uint gpio, enum gpio_function fn) { cchost::HW().gpioFunc[gpio] = fn; }
+inline void gpio_set_dir(uint gpio, bool out) { cchost::HW().gpioDir[gpio] = out; }
+inline void gpio_put(uint gpio, bool value) { cchost::HW().gpioOut[gpio] = value; }
+inline void gpio_set_pulls(uint gpio, bool up, bool down)
+{
+	cchost::HW().pullUp[gpio] = up;
+	cchost::HW().pullDown[gpio] = down;
+}
+inline void gpio_pull_up(uint gpio) { gpio_set_pulls(gpio, true, false); }
+inline void gpio_pull_down(uint gpio) { gpio_set_pulls(gpio, false, true); }
+inline void gpio_disable_pulls(uint gpio) { gpio_set_pulls(gpio, false, false); }
+inline void gpio_xor_mask(uint32_t mask)
+{
+	for (int i = 0; i < cchost::numGPIO; i++)
+		if (mask & (1u << i)) cchost::HW().gpioOut[i] = !cchost::HW().gpioOut[i];
+}
+inline bool gpio_get(uint gpio);
+
+////////////////////////////////////////
+// hardware/pwm.h
+
+typedef struct
+{
+	uint32_t csr, div, top;
+} pwm_config;
+
+inline pwm_config pwm_get_default_config() { return pwm_config{0, 1 << 4, 0xffff}; }
+inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) { c->top = wrap; }
+inline void pwm_config_set_clkdiv(pwm_config *c, float div) { c->div = uint32_t(div * 16); }
+inline void pwm_config_set_clkdiv_int(pwm_config *c, uint div) { c->div = div << 4; }
+inline uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1u) & 7u; }
+inline uint pwm_gpio_to_channel(uint gpio) { return gpio & 1u; }
+#define pwm_hw (&cchost::HW().pwmRegs)
+inline void pwm_init(uint slice, pwm_config *c, bool)
+{
+	cchost::HW().pwmTop[slice] = uint16_t(c->top);
+	cchost::HW().pwmDiv[slice] = uint16_t(c->div);
+	pwm_hw->slice[slice].top = c->top;
+	pwm_hw->slice[slice].div = c->div;
+}
+inline void pwm_set_wrap(uint slice, uint16_t wrap)
+{
+	cchost::HW().pwmTop[slice] = wrap;
+	pwm_hw->slice[slice].top = wrap;
+}
+inline void pwm_set_gpio_level(uint gpio, uint16_t level) { cchost::HW().pwmLevel[gpio] = level; }
+inline void pwm_set_chan_level(uint slice, uint chan, uint16_t level) { cchost::HW().pwmLevel[slice * 2 + chan] = level; }
+inline void pwm_set_enabled(uint, bool) {}
+inline void pwm_clear_irq(uint) {}
+inline void pwm_set_irq_enabled(uint, bool) {}
+
+////////////////////////////////////////
+// hardware/adc.h
+
+#define adc_hw (&cchost::HW().adcRegs)
+
+inline void adc_init() {}
+inline void adc_gpio_init(uint gpio) { cchost::HW().gpioFunc[gpio] = GPIO_FUNC_NULL; }
+inline void adc_select_input(uint input) { cchost::HW().adcInput = input; }
+inline void adc_set_round_robin(uint mask) { cchost::HW().adcRoundRobin = mask; }
+inline void adc_fifo_setup(bool, bool, uint16_t, bool, bool) {}
+inline void adc_set_clkdiv(float div) { cchost::HW().adcClkdiv = div; }
+inline void adc_run(bool run)
+{
+	cchost::HW().adcRunning = run;
+	if (run) cchost::ADCStarted();
+}
+inline void adc_fifo_drain() { cchost::HW().adcFifoLevel = 0; }
+inline uint8_t adc_fifo_get_level() { return uint8_t(cchost::HW().adcFifoLevel); }
+
+////////////////////////////////////////
+// hardware/spi.h
+
+typedef struct spi_inst spi_inst_t;
+inline int spi_instance_dummy[2];
+#define spi0 ((spi_inst_t *)&spi_instance_dummy[0])
+#define spi1 ((spi_inst_t *)&spi_instance_dummy[1])
+inline uint spi_get_index(spi_inst_t *spi) { return spi == spi1; }
+inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return &cchost::HW().spiRegs[spi_get_index(spi)]; }
+
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+inline uint spi_init(spi_inst_t *, uint baudrate) { return baudrate; }
+inline void spi_set_format(spi_inst_t *, uint, spi_cpol_t, spi_cpha_t, spi_order_t) {}
+
+namespace cchost
+{
+	// A 16-bit word arriving at the SPI data register is a command to the MCP4822 DAC
+	inline void SPIWrite(uint16_t word)
+	{
+		HW().dac[(word >> 15) & 1] = word & 0x0FFF;
+	}
+}
+
+////////////////////////////////////////
+// hardware/i2c.h
+
+typedef struct i2c_inst i2c_inst_t;
+inline int i2c_instance_dummy[2];
+#define i2c0 ((i2c_inst_t *)&i2c_instance_dummy[0])
+#define i2c1 ((i2c_inst_t *)&i2c_instance_dummy[1])
+
+inline uint i2c_init(i2c_inst_t *, uint baudrate) { return baudrate; }
+inline uint i2c_set_baudrate(i2c_inst_t *, uint baudrate) { return baudrate; }
+
+// The EEPROM at 0x50-0x57: the low three address bits select the 256-byte block
+inline int i2c_write_blocking(i2c_inst_t *, uint8_t addr, const uint8_t *src, size_t len, bool)
+{
+	if ((addr & 0x78) != 0x50 || len < 1) return PICO_ERROR_GENERIC;
+	cchost::State &s = cchost::HW();
+	s.eepromPtr = uint16_t(((addr & 0x07) << 8) | src[0]);
+	for (size_t i = 1; i < len; i++)
+	{
+		s.eeprom[s.eepromPtr] = src[i];
+		s.eepromPtr = (s.eepromPtr + 1) & 0x7FF;
+	}
+	return int(len);
+}
+
+inline int i2c_read_blocking(i2c_inst_t *, uint8_t addr, uint8_t *dst, size_t len, bool)
+{
+	if ((addr & 0x78) != 0x50) return PICO_ERROR_GENERIC;
+	cchost::State &s = cchost::HW();
+	for (size_t i = 0; i < len; i++)
+	{
+		dst[i] = s.eeprom[s.eepromPtr];
+		s.eepromPtr = (s.eepromPtr + 1) & 0x7FF;
+	}
+	return int(len);
+}
+
+////////////////////////////////////////
+// hardware/dma.h
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+#define DREQ_SPI0_TX 16
+#define DREQ_SPI0_RX 17
+#define DREQ_SPI1_TX 18
+#define DREQ_SPI1_RX 19
+#define DREQ_PWM_WRAP0 24
+#define DREQ_ADC 36
+#define DREQ_DMA_TIMER0 59
+#define DREQ_FORCE 63
+
+// From hardware/pwm.h, after the DREQ numbers
+inline uint pwm_get_dreq(uint slice) { return DREQ_PWM_WRAP0 + slice; }
+
+typedef struct
+{
+	uint32_t ctrl;
+} dma_channel_config;
+
+#define dma_hw (&cchost::HW().dmaRegs)
+
+inline int dma_claim_unused_channel(bool)
+{
+	cchost::State &s = cchost::HW();
+	for (int i = 0; i < cchost::numDMA; i++)
+	{
+		if (!(s.dmaClaimed & (1u << i)))
+		{
+			s.dmaClaimed |= 1u << i;
+			return i;
+		}
+	}
+	return -1;
+}
+inline void dma_channel_claim(uint ch) { cchost::HW().dmaClaimed |= 1u << ch; }
+inline void dma_channel_unclaim(uint ch) { cchost::HW().dmaClaimed &= ~(1u << ch); }
+inline int dma_claim_unused_timer(bool)
+{
+	cchost::State &s = cchost::HW();
+	for (int i = 0; i < 4; i++)
+	{
+		if (!(s.dmaTimerClaimed & (1u << i)))
+		{
+			s.dmaTimerClaimed |= 1u << i;
+			return i;
+		}
+	}
+	return -1;
+}
+inline void dma_timer_unclaim(uint timer) { cchost::HW().dmaTimerClaimed &= ~(1u << timer); }
+inline void dma_timer_set_fraction(uint timer, uint16_t numerator, uint16_t denominator)
+{
+	cchost::HW().dmaTimerNum[timer] = numerator;
+	cchost::HW().dmaTimerDen[timer] = denominator;
+}
+inline uint dma_get_timer_dreq(uint timer) { return DREQ_DMA_TIMER0 + timer; }
+
+inline dma_channel_config dma_channel_get_default_config(uint ch)
+{
+	dma_channel_config c;
+	c.ctrl = DMA_CH0_CTRL_TRIG_EN_BITS | (DMA_SIZE_32 << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB) |
+		DMA_CH0_CTRL_TRIG_INCR_READ_BITS | (ch << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB) |
+		(DREQ_FORCE << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+	return c;
+}
+inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+	c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) | (uint32_t(size) << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+inline void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+	c->ctrl = incr ? (c->ctrl | DMA_CH0_CTRL_TRIG_INCR_READ_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_READ_BITS);
+}
+inline void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+	c->ctrl = incr ? (c->ctrl | DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS);
+}
+inline void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+	c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) | (dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+inline void channel_config_set_chain_to(dma_channel_config *c, uint chain_to)
+{
+	c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+inline void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits)
+{
+	c->ctrl = (c->ctrl & ~(DMA_CH0_CTRL_TRIG_RING_SIZE_BITS | DMA_CH0_CTRL_TRIG_RING_SEL_BITS)) |
+		(size_bits << DMA_CH0_CTRL_TRIG_RING_SIZE_LSB) | (write ? DMA_CH0_CTRL_TRIG_RING_SEL_BITS : 0);
+}
+inline void channel_config_set_enable(dma_channel_config *c, bool enable)
+{
+	c->ctrl = enable ? (c->ctrl | DMA_CH0_CTRL_TRIG_EN_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_EN_BITS);
+}
+
+namespace cchost
+{
+	inline void DMAStart(uint ch);
+}
+
+inline void dma_channel_set_config(uint ch, const dma_channel_config *c, bool trigger)
+{
+	dma_hw->ch[ch].al1_ctrl = c->ctrl;
+	if (trigger) cchost::DMAStart(ch);
+}
+inline void dma_channel_set_read_addr(uint ch, const volatile void *read_addr, bool trigger)
+{
+	dma_hw->ch[ch].read_addr = uintptr_t(read_addr);
+	if (trigger) cchost::DMAStart(ch);
+}
+inline void dma_channel_set_write_addr(uint ch, volatile void *write_addr, bool trigger)
+{
+	dma_hw->ch[ch].write_addr = uintptr_t(write_addr);
+	if (trigger) cchost::DMAStart(ch);
+}
+inline void dma_channel_set_trans_count(uint ch, uint32_t count, bool trigger)
+{
+	cchost::HW().dma[ch].reload = count;
+	if (trigger) cchost::DMAStart(ch);
+}
+inline void dma_channel_configure(uint ch, const dma_channel_config *c, volatile void *write_addr,
+								  const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+	dma_channel_set_read_addr(ch, read_addr, false);
+	dma_channel_set_write_addr(ch, write_addr, false);
+	dma_channel_set_trans_count(ch, transfer_count, false);
+	dma_channel_set_config(ch, c, trigger);
+}
+inline void dma_channel_start(uint ch) { cchost::DMAStart(ch); }
+inline void dma_start_channel_mask(uint32_t mask)
+{
+	for (uint i = 0; i < cchost::numDMA; i++)
+		if (mask & (1u << i)) cchost::DMAStart(i);
+}
+inline bool dma_channel_is_busy(uint ch) { return cchost::HW().dma[ch].busy; }
+inline void dma_channel_abort(uint ch)
+{
+	cchost::HW().dma[ch].busy = false;
+	dma_hw->ch[ch].transfer_count = 0;
+}
+inline void dma_channel_set_irq0_enabled(uint ch, bool enabled) { cchost::HW().dma[ch].irq0 = enabled; }
+inline void dma_channel_acknowledge_irq0(uint ch) { dma_hw->ints0 = 1u << ch; }
+inline void dma_channel_cleanup(uint ch)
+{
+	dma_channel_set_irq0_enabled(ch, false);
+	dma_channel_abort(ch);
+	dma_channel_acknowledge_irq0(ch);
+}
+inline void dma_channel_wait_for_finish_blocking(uint ch)
+{
+	while (dma_channel_is_busy(ch)) cchost::RunSample();
+}
+
+////////////////////////////////////////
+// hardware/irq.h
+
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+#define PWM_IRQ_WRAP 4
+#define PICO_LOWEST_IRQ_PRIORITY 0xff
+#define PICO_HIGHEST_IRQ_PRIORITY 0x00
+#define PICO_DEFAULT_IRQ_PRIORITY 0x80
+
+inline void irq_set_exclusive_handler(uint num, irq_handler_t handler) { cchost::HW().irqHandler[num] = handler; }
+inline void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t) { cchost::HW().irqHandler[num] = handler; }
+inline void irq_remove_handler(uint num, irq_handler_t) { cchost::HW().irqHandler[num] = nullptr; }
+inline void irq_set_enabled(uint num, bool enabled) { cchost::HW().irqEnabled[num] = enabled; }
+inline void irq_set_priority(uint, uint8_t) {}
+
+////////////////////////////////////////
+// hardware/clocks.h
+
+enum clock_index { clk_gpout0 = 0, clk_gpout1, clk_gpout2, clk_gpout3, clk_ref, clk_sys, clk_peri, clk_usb, clk_adc, clk_rtc };
+inline uint32_t clock_get_hz(enum clock_index clk)
+{
+	return (clk == clk_usb || clk == clk_adc) ? 48000000 : cchost::sysClockHz;
+}
+inline bool set_sys_clock_khz(uint32_t, bool) { return true; }
+
+////////////////////////////////////////
+// hardware/timer.h, pico/time.h
+// The microsecond timer follows emulated time, not wall-clock time
+
+// (Atomic load, as a core 1 thread may poll the timer, as it would a hardware register)
+inline uint64_t time_us_64() { return __atomic_load_n(&cchost::HW().sample, __ATOMIC_RELAXED) * 1000000ull / cchost::HW().sampleRate; }
+inline uint32_t time_us_32() { return uint32_t(time_us_64()); }
+typedef uint64_t absolute_time_t;
+inline absolute_time_t get_absolute_time() { return time_us_64(); }
+inline uint32_t to_ms_since_boot(absolute_time_t t) { return uint32_t(t / 1000); }
+inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+inline void sleep_us(uint64_t) {}
+inline void sleep_ms(uint32_t) {}
+inline void busy_wait_us(uint64_t) {}
+inline void busy_wait_us_32(uint32_t) {}
+
+////////////////////////////////////////
+// hardware/structs/systick.h
+// The SysTick counter follows host wall-clock time, scaled to the 125MHz
+// system clock, so that the profiler measures the host's own processing time.
+
+#include <chrono>
+
+namespace cchost
+{
+	struct SysTickCount
+	{
+		operator uint32_t() const
+		{
+			auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+			return 0x00FFFFFFu - (uint32_t((uint64_t(ns) * (sysClockHz / 1000000u)) / 1000u) & 0x00FFFFFFu);
+		}
+		SysTickCount &operator=(uint32_t) { return *this; } // writes clear the counter on hardware; ignored
+	};
+}
+
+typedef struct
+{
+	io_rw_32 csr;
+	io_rw_32 rvr;
+	cchost::SysTickCount cvr;
+	io_rw_32 calib;
+} systick_hw_t;
+
+inline systick_hw_t systickRegs;
+#define systick_hw (&systickRegs)
+
+////////////////////////////////////////
+// hardware/flash.h
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define FLASH_BLOCK_SIZE (1u << 16)
+#define FLASH_UNIQUE_ID_SIZE_BYTES 8
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (2u * 1024 * 1024)
+#endif
+
+// Flash is modelled as NOR flash, read through XIP_BASE: erasing sets a whole sector to 0xFF,
+// and programming can only clear bits. Erasing and programming proceed one byte at a time,
+// so that a power failure injected with FlashPowerFailAfter leaves an operation part-done.
+
+namespace cchost
+{
+	// Thrown by flash_range_erase or flash_range_program when an injected power failure happens
+	struct PowerFail {};
+
+	inline uint8_t *FlashMemory(State &s)
+	{
+		if (s.flash.empty())
+		{
+			s.flash.assign(PICO_FLASH_SIZE_BYTES, 0xFF);
+			s.flashErases.assign(PICO_FLASH_SIZE_BYTES / FLASH_SECTOR_SIZE, 0);
+		}
+		return s.flash.data();
+	}
+
+	// Fail power after n more bytes have been erased or programmed (n < 0: never)
+	inline void FlashPowerFailAfter(int64_t n) { HW().flashFailCountdown = n; }
+
+	// Erase or program one byte. If power fails, a random subset of its changing bits
+	// change (as a part-finished erase or program would leave them) and PowerFail is thrown.
+	inline void FlashWriteByte(uint32_t offset, uint8_t value, bool erase)
+	{
+		State &s = HW();
+		uint8_t &b = FlashMemory(s)[offset];
+		uint8_t next = erase ? uint8_t(0xFF) : uint8_t(b & value);
+		if (s.flashFailCountdown >= 0 && s.flashFailCountdown-- == 0)
+		{
+			s.flashNoise = 1664525u * s.flashNoise + 1013904223u;
+			b = uint8_t(b ^ ((b ^ next) & (s.flashNoise >> 24)));
+			throw PowerFail();
+		}
+		b = next;
+	}
+}
+
+#define XIP_BASE (uintptr_t(cchost::FlashMemory(cchost::HW())))
+#define XIP_NOCACHE_NOALLOC_BASE XIP_BASE
+
+inline void flash_get_unique_id(uint8_t *id_out) { memcpy(id_out, cchost::HW().flashID, FLASH_UNIQUE_ID_SIZE_BYTES); }
+
+inline void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+	assert(flash_offs % FLASH_SECTOR_SIZE == 0 && count % FLASH_SECTOR_SIZE == 0 && flash_offs + count <= PICO_FLASH_SIZE_BYTES);
+	cchost::State &s = cchost::HW();
+	cchost::FlashMemory(s);
+	for (size_t i = 0; i < count; i += FLASH_SECTOR_SIZE)
+	{
+		s.flashErases[(flash_offs + i) / FLASH_SECTOR_SIZE]++;
+		for (size_t j = 0; j < FLASH_SECTOR_SIZE; j++) cchost::FlashWriteByte(uint32_t(flash_offs + i + j), 0xFF, true);
+	}
+}
+
+inline void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+	assert(flash_offs % FLASH_PAGE_SIZE == 0 && count % FLASH_PAGE_SIZE == 0 && flash_offs + count <= PICO_FLASH_SIZE_BYTES);
+	for (size_t i = 0; i < count; i++) cchost::FlashWriteByte(uint32_t(flash_offs + i), data[i], false);
+}
+
+////////////////////////////////////////
+// hardware/sync.h
+
+inline uint32_t save_and_disable_interrupts() { return 0; }
+inline void restore_interrupts(uint32_t) {}
+
+////////////////////////////////////////
+// pico/stdlib.h
+
+inline bool stdio_init_all() { return true; }
+
+// No serial input on the host
+#define PICO_ERROR_TIMEOUT -1
+inline int getchar_timeout_us(uint32_t) { return PICO_ERROR_TIMEOUT; }
+
+
+////////////////////////////////////////
+// Emulation of one sample period
+
+namespace cchost
+{
+	// Level seen by the ADC on each of its four inputs
+	inline uint16_t ADCLevel(uint32_t input)
+	{
+		State &s = HW();
+		const Inputs &in = s.in;
+		bool probe = s.gpioOut[4]; // NORMALISATION_PROBE
+		int mux = s.gpioOut[24] | (s.gpioOut[25] << 1); // MX_A, MX_B
+
+		// Unplugged inputs are normalised to the probe: low reading when probe high, ~0V otherwise
+		auto jack = [&](int jackIndex, int32_t value) -> int32_t {
+			if (!in.plugged[jackIndex]) return probe ? 1024 : 2048;
+			int32_t raw = 2048 - value; // inverting input amplifiers
+			return raw < 0 ? 0 : (raw > 4095 ? 4095 : raw);
+		};
+
+		switch (input)
+		{
+		case 0: // GPIO26, audio 2
+			return uint16_t(jack(1, in.audio[1]));
+		case 1: // GPIO27, audio 1
+			return uint16_t(jack(0, in.audio[0]));
+		case 2: // GPIO28, mux: knobs and switch
+			if (mux == 3)
+			{
+				static const uint16_t switchVals[3] = {0, 2048, 4095};
+				return switchVals[in.switchPos < 0 ? 0 : (in.switchPos > 2 ? 2 : in.switchPos)];
+			}
+			return uint16_t(in.knob[mux] < 0 ? 0 : (in.knob[mux] > 4095 ? 4095 : in.knob[mux]));
+		default: // GPIO29, mux: CV inputs
+			return uint16_t(jack(2 + (mux & 1), in.cv[mux & 1]));
+		}
+	}
+
+	// ADC reading of one of its four inputs
+	inline uint16_t ADCValue(uint32_t input) { return HW().adcTransfer[ADCLevel(input)]; }
+
+	// DMA_IRQ_0 is level-triggered: it stays pending while any channel's interrupt flag is set
+	inline bool IRQPending(uint num) { return num == DMA_IRQ_0 && dma_hw->ints0 != 0; }
+
+	// Run an interrupt handler. An interrupt raised while a handler runs (i.e. by cchost::Stall) is not nested,
+	// but runs when the handler returns, if still pending.
+	inline void FireIRQ(uint num)
+	{
+		State &s = HW();
+		if (s.inIRQ) return;
+		s.inIRQ = true;
+		auto start = std::chrono::steady_clock::now();
+		try
+		{
+			while (s.irqEnabled[num] && s.irqHandler[num])
+			{
+				s.irqHandler[num]();
+				if (!IRQPending(num)) break;
+			}
+		}
+		catch (...)
+		{
+			s.inIRQ = false;
+			throw;
+		}
+		s.irqHostNs += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		s.inIRQ = false;
+	}
+
+	// A DMA write to a PWM slice's CC register sets the levels of the GPIOs on its two channels
+	// (channel A in the low half, B in the high half); returns false for other addresses
+	inline bool PWMWrite(uintptr_t addr, uint32_t value)
+	{
+		for (uint slice = 0; slice < 8; slice++)
+		{
+			if (addr != uintptr_t(&pwm_hw->slice[slice].cc)) continue;
+			pwm_hw->slice[slice].cc = value;
+			for (uint gpio = 0; gpio < numGPIO; gpio++)
+			{
+				if (pwm_gpio_to_slice_num(gpio) == slice) HW().pwmLevel[gpio] = uint16_t(value >> (16 * pwm_gpio_to_channel(gpio)));
+			}
+			return true;
+		}
+		return false;
+	}
+
+	inline uint DMADreq(uint ch) { return (dma_hw->ch[ch].al1_ctrl & DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) >> DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB; }
+
+	// Perform one transfer on a DMA channel; returns false if the channel is not busy
+	inline bool DMATransfer(uint ch, uint16_t adcWord = 0)
+	{
+		State &s = HW();
+		DMAChannel &c = s.dma[ch];
+		dma_channel_hw_t &r = dma_hw->ch[ch];
+		if (!c.busy) return false;
+
+		uint32_t ctrl = r.al1_ctrl;
+		int size = 1 << ((ctrl & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+		uint32_t value = 0;
+		if (DMADreq(ch) == DREQ_ADC && r.read_addr == uintptr_t(&adc_hw->fifo)) value = adcWord;
+		else if (size == 1) value = *(volatile uint8_t *)r.read_addr;
+		else if (size == 2) value = *(volatile uint16_t *)r.read_addr;
+		else value = *(volatile uint32_t *)r.read_addr;
+
+		if (r.write_addr == uintptr_t(&spi_get_hw(spi0)->dr)) SPIWrite(uint16_t(value));
+		else if (PWMWrite(r.write_addr, value)) {}
+		else if (size == 1) *(volatile uint8_t *)r.write_addr = uint8_t(value);
+		else if (size == 2) *(volatile uint16_t *)r.write_addr = uint16_t(value);
+		else *(volatile uint32_t *)r.write_addr = value;
+
+		// An address in a ring (see channel_config_set_ring) wraps within its aligned 2^n bytes
+		uint ringBits = (ctrl & DMA_CH0_CTRL_TRIG_RING_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_RING_SIZE_LSB;
+		uintptr_t ringMask = ringBits ? (uintptr_t(1) << ringBits) - 1 : ~uintptr_t(0);
+		bool ringWrite = ctrl & DMA_CH0_CTRL_TRIG_RING_SEL_BITS;
+		if (ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS)
+		{
+			uintptr_t mask = ringWrite ? ~uintptr_t(0) : ringMask;
+			r.read_addr = (r.read_addr & ~mask) | ((r.read_addr + size) & mask);
+		}
+		if (ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS)
+		{
+			uintptr_t mask = ringWrite ? ringMask : ~uintptr_t(0);
+			r.write_addr = (r.write_addr & ~mask) | ((r.write_addr + size) & mask);
+		}
+
+		if (--r.transfer_count == 0)
+		{
+			c.busy = false;
+			if (c.irq0)
+			{
+				dma_hw->ints0.bits |= 1u << ch;
+				FireIRQ(DMA_IRQ_0);
+			}
+			uint chain = (ctrl & DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) >> DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB;
+			if (chain != ch) DMAStart(chain);
+		}
+		return true;
+	}
+
+	// Trigger a DMA channel. SPI and unpaced transfers complete immediately,
+	// as they are much faster than one sample period.
+	inline void DMAStart(uint ch)
+	{
+		State &s = HW();
+		DMAChannel &c = s.dma[ch];
+		if (!(dma_hw->ch[ch].al1_ctrl & DMA_CH0_CTRL_TRIG_EN_BITS)) return;
+		dma_hw->ch[ch].transfer_count = c.reload;
+		c.busy = c.reload > 0;
+
+		uint dreq = DMADreq(ch);
+		if (dreq == DREQ_FORCE || dreq == DREQ_SPI0_TX || dreq == DREQ_SPI1_TX)
+		{
+			while (DMATransfer(ch)) {}
+		}
+		else if (dreq == DREQ_ADC)
+		{
+			// Take any conversions that have queued in the ADC FIFO while no transfer was running
+			while (s.adcFifoLevel && c.busy)
+			{
+				uint16_t word = s.adcFifo[0];
+				s.adcFifoLevel--;
+				memmove(s.adcFifo, s.adcFifo + 1, s.adcFifoLevel * sizeof(s.adcFifo[0]));
+				DMATransfer(ch, word);
+			}
+		}
+	}
+
+	// The card's sample rate is not visible to the hardware, so is inferred when the ADC starts:
+	// in block mode from the DAC pacing timer (two words per sample),
+	// otherwise from the ADC DMA transfer count (one sample's worth of conversions).
+	inline void ADCStarted()
+	{
+		State &s = HW();
+		double adcHz = s.adcClkdiv < 95.0f ? 500000.0 : adcClockHz / (double(s.adcClkdiv) + 1.0);
+
+		uint32_t rate = 0;
+		for (uint t = 0; t < 4 && !rate; t++)
+		{
+			if ((s.dmaTimerClaimed & (1u << t)) && s.dmaTimerDen[t])
+				rate = uint32_t(uint64_t(sysClockHz) * s.dmaTimerNum[t] / s.dmaTimerDen[t] / 2);
+		}
+		for (uint ch = 0; ch < numDMA && !rate; ch++)
+		{
+			if (DMADreq(ch) == DREQ_ADC && s.dma[ch].reload)
+				rate = uint32_t(lround(adcHz / s.dma[ch].reload));
+		}
+		if (!rate) return;
+
+		s.sampleRate = rate;
+		s.adcConversionsPerSample = uint32_t(lround(adcHz / rate));
+	}
+
+	// Emulate one sample period of the ADC and DMA
+	inline void RunSample()
+	{
+		State &s = HW();
+
+		// ADC: free-running, e.g. at 384kHz = 8 conversions per 48kHz sample
+		if (s.adcRunning)
+		{
+			for (uint32_t i = 0; i < s.adcConversionsPerSample; i++)
+			{
+				uint16_t word = ADCValue(s.adcInput);
+
+				// Advance to next input in round-robin sequence
+				// (before the result reaches DMA, as the next conversion starts immediately)
+				if (s.adcRoundRobin)
+				{
+					do { s.adcInput = (s.adcInput + 1) & 3; } while (!(s.adcRoundRobin & (1u << s.adcInput)));
+				}
+
+				// Conversions queue in the 4-word FIFO while no DMA transfer takes them, and are lost once it is full
+				bool taken = false;
+				for (uint ch = 0; ch < numDMA && !taken; ch++)
+				{
+					taken = DMADreq(ch) == DREQ_ADC && DMATransfer(ch, word);
+				}
+				if (!taken && s.adcFifoLevel < 4) s.adcFifo[s.adcFifoLevel++] = word;
+			}
+		}
+
+		// DMA pacing timers: pulses per sample = sys_clk × num/den ÷ sample rate, with remainder carried
+		for (uint t = 0; t < 4; t++)
+		{
+			if (!(s.dmaTimerClaimed & (1u << t)) || !s.dmaTimerDen[t]) continue;
+			s.dmaTimerAcc[t] += uint64_t(sysClockHz) * s.dmaTimerNum[t];
+			uint64_t pulse = uint64_t(s.dmaTimerDen[t]) * s.sampleRate;
+			while (s.dmaTimerAcc[t] >= pulse)
+			{
+				s.dmaTimerAcc[t] -= pulse;
+
+				// Each busy channel paced by this timer makes one transfer per pulse.
+				// Channels started by chaining during this pulse wait for the next.
+				uint32_t paced = 0;
+				for (uint ch = 0; ch < numDMA; ch++)
+				{
+					if (s.dma[ch].busy && DMADreq(ch) == DREQ_DMA_TIMER0 + t) paced |= 1u << ch;
+				}
+				for (uint ch = 0; ch < numDMA; ch++)
+				{
+					if (paced & (1u << ch)) DMATransfer(ch);
+				}
+			}
+		}
+
+		// PWM wrap DREQs: wraps per sample = sys_clk ÷ ((top + 1) × div) ÷ sample rate, with remainder carried.
+		// Each busy channel paced by a slice's wrap makes one transfer per wrap.
+		for (uint slice = 0; slice < 8; slice++)
+		{
+			uint32_t paced = 0;
+			for (uint ch = 0; ch < numDMA; ch++)
+			{
+				if (s.dma[ch].busy && DMADreq(ch) == DREQ_PWM_WRAP0 + slice) paced |= 1u << ch;
+			}
+			if (!paced || !s.pwmDiv[slice]) continue;
+			s.pwmWrapAcc[slice] += uint64_t(sysClockHz) * 16;
+			uint64_t wrap = (uint64_t(s.pwmTop[slice]) + 1) * s.pwmDiv[slice] * s.sampleRate;
+			while (s.pwmWrapAcc[slice] >= wrap)
+			{
+				s.pwmWrapAcc[slice] -= wrap;
+				for (uint ch = 0; ch < numDMA; ch++)
+				{
+					if (paced & (1u << ch)) DMATransfer(ch);
+				}
+			}
+		}
+
+		__atomic_store_n(&s.sample, s.sample + 1, __ATOMIC_RELAXED);
+	}
+}
+
+// Pulse inputs, board ID and USB status are read from the emulated inputs; other pins read back their output
+inline bool gpio_get(uint gpio)
+{
+	cchost::State &s = cchost::HW();
+	switch (gpio)
+	{
+	case 2: // PULSE_1_INPUT, inverted; unplugged input follows normalisation probe
+	case 3:
+		return !(s.in.plugged[4 + gpio - 2] ? s.in.pulse[gpio - 2] : s.gpioOut[4]);
+	case 5: // BOARD_ID_2..0: each pin either tied high, tied low, or floating (reads pull)
+	case 6:
+	case 7:
+	{
+		int bit = 7 - gpio; // BOARD_ID_0 = 7
+		bool pd = (s.in.boardID >> (2 * bit)) & 1, pu = (s.in.boardID >> (2 * bit + 1)) & 1;
+		if (pd && pu) return true;       // tied high
+		if (!pd && !pu) return false;    // tied low
+		return s.pullUp[gpio];           // floating
+	}
+	case 20: // USB_HOST_STATUS, UFP
+		return true;
+	default:
+		return s.gpioOut[gpio];
+	}
+}
+
+#endif // __cplusplus
+
+#endif
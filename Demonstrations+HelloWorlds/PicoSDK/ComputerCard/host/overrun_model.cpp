@@ -0,0 +1,164 @@
+/*
+Test of ComputerCard's handling of audio interrupt overruns, using
+cchost::Stall to make the interrupt run for longer than it should.
+
+A card stalls its interrupt every 100ms, for a given number of sample
+periods, while constant values are applied to its audio and CV inputs.
+Every sample, it checks that each input reads the same as it did once
+the input filters had settled, so that
+readings left out of step with the inputs after lost ADC conversions
+are caught. For each stall length, with per-sample and with block
+processing, the program reports the overruns and resyncs counted in
+the diagnostics record, OnOverrun calls and misread samples.
+
+An interrupt that takes up to its budget plus one sample should only
+overrun; any longer, and the ADC FIFO fills, so the ADC should also be
+resynchronised. Inputs should never be misread. Finally, the card is
+run twice, to check that the record keeps totals as it would over a
+reset.
+
+Usage: overrun_model
+Exits with status 1 if any inputs were misread, or any count was not as expected.
+*/
+
+#include "ComputerCard.h"
+#include "host_driver.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+static constexpr int32_t audioVals[2] = {600, -900};
+static constexpr int32_t cvVals[2] = {300, -400};
+static constexpr uint32_t stallPeriod = 4800; // samples between stalls
+static constexpr uint32_t settleSamples = 480; // ignore readings while the input filters settle
+
+// Settings for the next run of the test card
+static unsigned testBlockSize = 1;
+static uint32_t testStall = 0;
+
+class StallCard : public ComputerCard
+{
+public:
+	uint32_t misreads = 0;
+	uint32_t onOverrunCalls = 0;
+	uint32_t lastStall = 0;
+	int32_t settled[4];
+	using ComputerCard::Diagnostics;
+
+	StallCard()
+	{
+		if (testBlockSize > 1) EnableBlockProcessing(testBlockSize);
+	}
+
+protected:
+	virtual void ProcessSample()
+	{
+		// Inputs are compared with their readings once settled, as CV readings are scaled by the CV input circuit
+		int32_t vals[4] = {AudioIn1(), AudioIn2(), CVIn1(), CVIn2()};
+		uint32_t t = SampleCount();
+		if (t < settleSamples) return;
+		if (t == settleSamples)
+		{
+			for (int i = 0; i < 4; i++) settled[i] = vals[i];
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			if (abs(vals[i] - settled[i]) > 2)
+			{
+				misreads++;
+				break;
+			}
+		}
+
+		// In block mode, SampleCount is the first sample of the block, so only stall once for it
+		if (testStall && t % stallPeriod == 0 && t != lastStall)
+		{
+			lastStall = t;
+			cchost::Stall(testStall);
+		}
+	}
+
+	virtual void OnOverrun()
+	{
+		onOverrunCalls++;
+	}
+};
+
+// Kept after Run() exits, to read the results
+static std::unique_ptr<StallCard> card;
+
+static int CardMain()
+{
+	card.reset(new StallCard);
+	card->Run();
+	return 0;
+}
+
+// Run the card for one second; returns the number of stalls it made
+static uint32_t RunCard(unsigned blockSize, uint32_t stall, uint32_t &misreads, uint32_t &onOverrunCalls)
+{
+	testBlockSize = blockSize;
+	testStall = stall;
+
+	cchost::HostDriver driver;
+	for (int i = 0; i < 2; i++)
+	{
+		driver.automation.Add(cchost::Control(cchost::Audio1 + i), 0, audioVals[i], false);
+		driver.automation.Add(cchost::Control(cchost::CV1 + i), 0, cvVals[i], false);
+	}
+	cchost::HostOptions opts;
+	opts.outAudio = "";
+	opts.seconds = 1;
+	std::string error;
+	if (!driver.Open(opts, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		exit(1);
+	}
+	driver.Run(CardMain);
+	driver.Close();
+
+	misreads = card->misreads;
+	onOverrunCalls = card->onOverrunCalls;
+	return stall ? (48000 - 1) / stallPeriod : 0; // at every stallPeriod samples, except 0
+}
+
+int main()
+{
+	bool ok = true;
+	static const unsigned blockSizes[] = {1, 16};
+	static const uint32_t stalls[] = {0, 1, 2, 16, 17, 100};
+
+	printf("%6s %6s %7s %9s %8s %10s %9s\n", "block", "stall", "stalls", "overruns", "resyncs", "OnOverrun", "misreads");
+	for (unsigned blockSize : blockSizes)
+	{
+		for (uint32_t stall : stalls)
+		{
+			uint32_t misreads, onOverrunCalls;
+			uint32_t n = RunCard(blockSize, stall, misreads, onOverrunCalls);
+			ComputerCard::DiagnosticsRecord d = card->Diagnostics();
+
+			uint32_t expectOverruns = stall >= blockSize ? n : 0;
+			uint32_t expectResyncs = stall > blockSize ? n : 0;
+			bool good = d.runOverruns == expectOverruns && d.runResyncs == expectResyncs &&
+				onOverrunCalls == d.runOverruns && misreads == 0;
+			ok = ok && good;
+			printf("%6u %6u %7u %9u %8u %10u %9u%s\n", blockSize, stall, n, d.runOverruns, d.runResyncs,
+				   onOverrunCalls, misreads, good ? "" : "  FAIL");
+		}
+	}
+
+	// Two more runs, as if the card had been reset in between, adding to the totals
+	ComputerCard::DiagnosticsRecord before = card->Diagnostics();
+	uint32_t misreads, onOverrunCalls;
+	uint32_t n1 = RunCard(1, 3, misreads, onOverrunCalls);
+	uint32_t n2 = RunCard(1, 3, misreads, onOverrunCalls);
+	ComputerCard::DiagnosticsRecord d = card->Diagnostics();
+	bool good = d.runs == before.runs + 2 && d.overruns == before.overruns + n1 + n2 &&
+		d.resyncs == before.resyncs + n1 + n2 && d.runOverruns == n2;
+	ok = ok && good;
+	printf("\nTotals over all %u runs: overruns=%u resyncs=%u%s\n", d.runs, d.overruns, d.resyncs, good ? "" : "  FAIL");
+
+	return ok ? 0 : 1;
+}
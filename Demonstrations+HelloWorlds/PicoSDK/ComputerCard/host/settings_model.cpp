@@ -0,0 +1,185 @@
+/*
+Power-failure and wear test of FlashSettings, against the simulated NOR
+flash of the host build (see hardware/flash.h in include/pico_host.h).
+
+1. Wear: a long run of saves, each changing a few settings, reporting how
+   many times each sector of the ring is erased, compared with erasing
+   one sector for every save.
+2. Power failure: repeatedly changes random settings and commits them,
+   cutting the power at a random byte of the flash writes. After each
+   failure, a new FlashSettings loads the flash as it would at power-up,
+   and every setting must have either its value before the commit or the
+   one being committed. Any other value is reported as a violation.
+
+Usage: settings_model [--trials N] [--seed S]
+Exits with status 1 if there were any violations.
+*/
+
+#define COMPUTERCARD_NOIMPL
+#include "ComputerCard.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+static constexpr unsigned numKeys = 16;
+static constexpr unsigned numSectors = 4;
+using Store = FlashSettings<numKeys, numSectors>;
+
+// A setting's value, or absent
+struct Value
+{
+	bool present;
+	int32_t value;
+	bool operator==(const Value &o) const {return present == o.present && (!present || value == o.value);}
+};
+
+static void Snapshot(const Store &s, Value *v)
+{
+	for (unsigned k = 0; k < numKeys; k++) v[k] = {s.Has(k), s.Get(k)};
+}
+
+static uint32_t Erases(unsigned sector)
+{
+	cchost::State &s = cchost::HW();
+	cchost::FlashMemory(s);
+	return s.flashErases[Store::defaultOffset / FLASH_SECTOR_SIZE + sector];
+}
+
+static uint32_t TotalErases()
+{
+	uint32_t n = 0;
+	for (unsigned i = 0; i < numSectors; i++) n += Erases(i);
+	return n;
+}
+
+static void PrintErases(const char *label)
+{
+	printf("%-28s", label);
+	for (unsigned i = 0; i < numSectors; i++) printf("%8u", Erases(i));
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned trials = 20000;
+	unsigned seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--trials") && i + 1 < argc) trials = unsigned(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = unsigned(atoi(argv[++i]));
+		else
+		{
+			fprintf(stderr, "Usage: %s [--trials N] [--seed S]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	auto Random = [&](uint32_t n) {return uint32_t(rng() % n);};
+
+	// 1. Wear
+	const unsigned saves = 10000;
+	{
+		Store store;
+		store.Load();
+		unsigned calls = 0, maxCalls = 0;
+		for (unsigned i = 0; i < saves; i++)
+		{
+			unsigned changes = 1 + Random(3);
+			for (unsigned c = 0; c < changes; c++) store.Set(Random(numKeys), int32_t(rng()));
+			unsigned n = 1;
+			while (!store.Commit()) n++;
+			calls += n;
+			if (n > maxCalls) maxCalls = n;
+		}
+		printf("FlashSettings<%u, %u>: %u saves of 1-3 settings\n\n", numKeys, numSectors, saves);
+		printf("%-28s", "sector");
+		for (unsigned i = 0; i < numSectors; i++) printf("%8u", i);
+		printf("\n");
+		PrintErases("erases");
+		printf("\n%.1f saves per erase (rewriting one sector for every save: 1 save per erase of one sector)\n",
+			   double(saves) / TotalErases());
+		printf("Commit calls per save: %.2f mean, %u max (one flash operation per call)\n", double(calls) / saves, maxCalls);
+	}
+
+	// 2. Power failure
+	Value durable[numKeys]; // settings that a reload must find
+	{
+		Store store;
+		store.Load();
+		Snapshot(store, durable);
+	}
+
+	unsigned completed = 0, failures = 0, failuresInCopy = 0, violations = 0, oldValues = 0, newValues = 0;
+	for (unsigned t = 0; t < trials; t++)
+	{
+		Store store;
+		store.Load();
+		Value loaded[numKeys];
+		Snapshot(store, loaded);
+		for (unsigned k = 0; k < numKeys; k++)
+		{
+			if (!(loaded[k] == durable[k]))
+			{
+				if (violations++ < 10) printf("trial %u: key %u lost after a completed commit\n", t, k);
+			}
+		}
+
+		// Change a few settings, or occasionally all of them, to reach sector copies sooner
+		Value next[numKeys];
+		memcpy(next, durable, sizeof(next));
+		unsigned changes = Random(8) ? 1 + Random(4) : numKeys;
+		for (unsigned c = 0; c < changes; c++)
+		{
+			unsigned k = (changes == numKeys) ? c : Random(numKeys);
+			next[k] = {true, int32_t(rng())};
+			store.Set(k, next[k].value);
+		}
+
+		// Appending programs one 256-byte page; copying to a new sector erases 4096 bytes, then programs at least two pages.
+		// Failure points are spread so that around half the commits complete.
+		cchost::FlashPowerFailAfter(Random(4) ? Random(2 * FLASH_PAGE_SIZE) : Random(2 * (FLASH_SECTOR_SIZE + 2 * FLASH_PAGE_SIZE)));
+		uint32_t erasesBefore = TotalErases();
+		try
+		{
+			while (!store.Commit()) {}
+			cchost::FlashPowerFailAfter(-1);
+			memcpy(durable, next, sizeof(durable));
+			completed++;
+		}
+		catch (const cchost::PowerFail &)
+		{
+			cchost::FlashPowerFailAfter(-1);
+			failures++;
+			if (TotalErases() != erasesBefore) failuresInCopy++;
+
+			// Power up again
+			Store recovered;
+			recovered.Load();
+			Value after[numKeys];
+			Snapshot(recovered, after);
+			for (unsigned k = 0; k < numKeys; k++)
+			{
+				bool changing = !(next[k] == durable[k]);
+				if (after[k] == durable[k]) oldValues += changing;
+				else if (changing && after[k] == next[k]) newValues++;
+				else if (violations++ < 10)
+				{
+					printf("trial %u: key %u has %s%d after power failure (was %d, committing %d)\n", t, k,
+						   after[k].present ? "" : "no value, ", after[k].value, durable[k].value, next[k].value);
+				}
+			}
+			memcpy(durable, after, sizeof(durable));
+		}
+	}
+
+	printf("\n%u power-failure trials: %u commits completed, %u interrupted by power failure (%u while copying to a new sector)\n",
+		   trials, completed, failures, failuresInCopy);
+	printf("Settings being changed at each failure: %u kept their old value, %u had their new value, %u violations\n",
+		   oldValues, newValues, violations);
+	PrintErases("erases, both tests");
+	return violations ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/*
+Model of the sigma-delta modulator used for ComputerCard's precise CV
+outputs (COMPUTERCARD_PRECISE_CV), reporting the noise it adds within
+a given bandwidth for each modulator order.
+
+A slow sine wave, as might be sent to CVOutPrecise, is fed through
+SigmaDeltaModulator, with the timing of the hardware. The CV output PWM
+wraps every 2048 system clocks (~61kHz at 125MHz), and DMA writes it a
+new level at each wrap, from a ring of levels that the audio interrupt
+keeps filled a few wraps ahead (ComputerCard::FillCVLevels). So the
+modulator runs once per PWM period, and every level lasts the same time,
+as its noise shaping assumes. The requested level changes only when the
+card sets it: once per sample (48kHz by default), or once per block in
+block processing mode.
+
+The difference between the PWM level in each period and the (fractional)
+level requested when it was queued is the modulator's error. The error
+within the bandwidth of interest passes through the CV output filter,
+and is reported here as RMS level, in PWM steps and in cents at
+1V/octave. Exits with status 1 if a higher order leaves more noise
+than a lower one.
+
+Usage: sigma_delta_model [--bandwidth HZ] [--amplitude LSB] [--sample-rate HZ] [--block N]
+*/
+
+#define COMPUTERCARD_NOIMPL
+#include "ComputerCard.h"
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// PWM wraps at 2048 counts of the 125MHz system clock
+static const double pwmRate = 125000000.0 / 2048;
+static const unsigned logN = 16;
+static const unsigned N = 1u << logN; // PWM periods in each test
+
+// PWM step size: ~5.9mV, with ~1V/octave
+static const double centsPerStep = 7.0;
+
+// In-place radix-2 FFT
+static void FFT(std::vector<std::complex<double>> &x)
+{
+	for (unsigned i = 1, j = 0; i < N; i++)
+	{
+		unsigned bit = N >> 1;
+		for (; j & bit; bit >>= 1) j ^= bit;
+		j ^= bit;
+		if (i < j) std::swap(x[i], x[j]);
+	}
+	for (unsigned len = 2; len <= N; len <<= 1)
+	{
+		std::complex<double> w = std::polar(1.0, -2.0 * M_PI / len);
+		for (unsigned i = 0; i < N; i += len)
+		{
+			std::complex<double> wk = 1.0;
+			for (unsigned k = 0; k < len / 2; k++)
+			{
+				std::complex<double> a = x[i + k], b = x[i + k + len / 2] * wk;
+				x[i + k] = a + b;
+				x[i + k + len / 2] = a - b;
+				wk *= w;
+			}
+		}
+	}
+}
+
+// RMS of the error below the given bandwidth, in PWM steps, with the requested level set updateRate times
+// per second, and each interrupt queuing levels up to lead PWM periods ahead, as ComputerCard::FillCVLevels
+template <int Order>
+static double InBandError(double bandwidth, double amplitude, double updateRate, uint32_t lead, double *peakToPeak)
+{
+	SigmaDeltaModulator<Order> modulator;
+	std::vector<std::complex<double>> err(N);
+
+	// Sine wave at an exact FFT bin (~9Hz), around the middle of the PWM range, in CVOutPrecise units
+	const unsigned cycles = 10;
+	int32_t lo = 2047, hi = 0;
+	int64_t updates = 0, filled = 0;
+	uint32_t value = 0;
+	for (unsigned p = 0; p < N; p++)
+	{
+		// Each interrupt queues its level up to lead periods ahead of the one the DMA is about to read
+		while (filled <= p)
+		{
+			double t = updates / updateRate;
+			double cv = amplitude * 128.0 * sin(2.0 * M_PI * cycles * t * pwmRate / N);
+			value = uint32_t(lrint((2047 << 7) - cv)); // as CVOutPrecise
+			filled = int64_t(floor(t * pwmRate)) + lead;
+			updates++;
+		}
+		int32_t level = modulator.Next(value);
+		err[p] = level - value / 256.0;
+		if (level - int32_t(value >> 8) < lo) lo = level - int32_t(value >> 8);
+		if (level - int32_t(value >> 8) > hi) hi = level - int32_t(value >> 8);
+	}
+	*peakToPeak = hi - lo;
+
+	// Parseval: mean square error from the spectrum, counting only bins within the bandwidth
+	FFT(err);
+	unsigned maxBin = unsigned(bandwidth * N / pwmRate);
+	double power = std::norm(err[0]);
+	for (unsigned k = 1; k <= maxBin && k < N / 2; k++) power += 2.0 * std::norm(err[k]);
+	return sqrt(power) / N;
+}
+
+int main(int argc, char **argv)
+{
+	double bandwidth = 200.0;
+	double amplitude = 1000.0;
+	double sampleRate = 48000.0;
+	unsigned blockSize = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--bandwidth") && i + 1 < argc) bandwidth = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--amplitude") && i + 1 < argc) amplitude = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--sample-rate") && i + 1 < argc) sampleRate = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--block") && i + 1 < argc) blockSize = unsigned(atoi(argv[++i]));
+		else
+		{
+			fprintf(stderr, "Usage: %s [--bandwidth HZ] [--amplitude LSB] [--sample-rate HZ] [--block N]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (sampleRate <= 0 || blockSize < 1)
+	{
+		fprintf(stderr, "Usage: %s [--bandwidth HZ] [--amplitude LSB] [--sample-rate HZ] [--block N]\n", argv[0]);
+		return 1;
+	}
+	double updateRate = sampleRate / blockSize;
+	uint32_t lead = uint32_t(ceil(pwmRate / updateRate)) + 1; // as ComputerCard::StartCVDMA
+
+	printf("Sigma-delta CV modulator: %.1fHz sine, amplitude %.0f (CVOut units), noise in 0-%.0fHz\n",
+		   10 * pwmRate / N, amplitude, bandwidth);
+	printf("One level per %.0fHz PWM period, queued %u periods ahead; requested level set at %.0fHz\n",
+		   pwmRate, lead, updateRate);
+	printf("(%.0fHz sample rate, block size %u)\n\n", sampleRate, blockSize);
+	printf("order  rms error (PWM steps)  rms error (cents)  effective bits  output spread (steps)\n");
+
+	double errors[3];
+	for (int order = 0; order < 3; order++)
+	{
+		double pp, &error = errors[order];
+		if (order == 0) error = InBandError<0>(bandwidth, amplitude, updateRate, lead, &pp);
+		else if (order == 1) error = InBandError<1>(bandwidth, amplitude, updateRate, lead, &pp);
+		else error = InBandError<2>(bandwidth, amplitude, updateRate, lead, &pp);
+
+		// Effective resolution, relative to the uniform quantisation noise (1/sqrt(12) steps) of an ideal 11-bit output
+		double bits = 11.0 - log2(error * sqrt(12.0));
+		printf("%5d  %21.5f  %17.4f  %14.1f  %21.0f\n", order, error, error * centsPerStep, bits, pp + 1);
+	}
+
+	// Each order of noise shaping should leave less noise in the bandwidth than the one before
+	if (!(errors[1] < errors[0] && errors[2] < errors[1]))
+	{
+		printf("\nFAIL: a higher modulator order leaves more in-band noise than a lower one\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+Stress test of SPSCRing and Mailbox, with the two sides of each on two
+host threads, standing in for the two RP2040 cores.
+
+SPSCRing: a producer thread pushes sequence-numbered items in batches
+of pseudo-random size (1 to 1.5 times the capacity, so that batches
+are often cut short by a full ring), and a consumer thread pops them in
+batches of other pseudo-random sizes. Each item holds its sequence
+number and its complement, so that the consumer can check that every
+item arrives, once, in order, and not torn.
+
+Mailbox: a writer thread publishes a set of N values many times, every
+value of write k being k, while a reader thread reads continually. Each
+read must return a set of equal values, matching the write count Read
+returns, and the write count must never go backwards.
+
+The ring is small, so that its indices wrap around it often. The host's
+__dmb() is a full memory barrier, as on the RP2040. With only one CPU,
+the threads only overlap where the scheduler preempts one of them, so
+more iterations are needed for the same coverage.
+
+Usage: spsc_stress [--items N] [--writes N]
+    --items N    items passed through the ring (default 20000000)
+    --writes N   writes to the mailbox (default 5000000)
+Exits with status 1 if any item was lost, duplicated, reordered or
+torn, or any mailbox read returned a mixed set.
+*/
+
+#include "ComputerCard.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static constexpr unsigned ringCapacity = 64;
+static constexpr unsigned maxBatch = ringCapacity + ringCapacity / 2;
+static constexpr unsigned mailboxValues = 8;
+
+struct Item
+{
+	uint32_t seq;
+	uint32_t check; // ~seq
+	uint32_t pad[2];
+};
+
+// Small, fast pseudo-random numbers for batch sizes
+static uint32_t NextRandom(uint32_t &state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+static bool TestRing(uint32_t items)
+{
+	static SPSCRing<Item, ringCapacity> ring;
+	std::atomic<bool> failed{false};
+
+	std::thread producer([&] {
+		Item batch[maxBatch];
+		uint32_t random = 1, next = 0;
+		while (next < items && !failed)
+		{
+			unsigned n = 1 + NextRandom(random) % maxBatch;
+			if (n > items - next) n = items - next;
+			for (unsigned i = 0; i < n; i++)
+			{
+				uint32_t s = next + i;
+				batch[i] = Item{s, ~s, {s, s}};
+			}
+			unsigned pushed = ring.Push(batch, n);
+			next += pushed;
+			if (!pushed) std::this_thread::yield();
+		}
+	});
+
+	Item batch[maxBatch];
+	uint32_t random = 2, expected = 0;
+	uint64_t pops = 0, emptyPops = 0;
+	while (expected < items && !failed)
+	{
+		unsigned n = 1 + NextRandom(random) % maxBatch;
+		unsigned popped = ring.Pop(batch, n);
+		pops++;
+		if (!popped)
+		{
+			emptyPops++;
+			std::this_thread::yield();
+		}
+		for (unsigned i = 0; i < popped; i++)
+		{
+			const Item &it = batch[i];
+			if (it.seq != expected || it.check != ~it.seq || it.pad[0] != it.seq || it.pad[1] != it.seq)
+			{
+				fprintf(stderr, "SPSCRing: expected item %u, got %u (check %08x, pad %u %u)\n",
+						unsigned(expected), unsigned(it.seq), unsigned(it.check), unsigned(it.pad[0]), unsigned(it.pad[1]));
+				failed = true;
+				break;
+			}
+			expected++;
+		}
+	}
+	producer.join();
+
+	Item extra;
+	if (!failed && ring.Pop(extra))
+	{
+		fprintf(stderr, "SPSCRing: item %u popped after the last item\n", unsigned(extra.seq));
+		failed = true;
+	}
+	printf("SPSCRing<%u>: %u items, %llu pops (%llu found it empty): %s\n", ringCapacity, unsigned(expected),
+		   (unsigned long long)pops, (unsigned long long)emptyPops, failed ? "FAILED" : "ok");
+	return !failed;
+}
+
+static bool TestMailbox(uint32_t writes)
+{
+	static Mailbox<uint32_t, mailboxValues> mailbox;
+	std::atomic<bool> done{false};
+
+	std::thread writer([&] {
+		uint32_t values[mailboxValues];
+		for (uint32_t k = 1; k <= writes; k++)
+		{
+			for (unsigned i = 0; i < mailboxValues; i++) values[i] = k;
+			mailbox.Write(values);
+			// Give the reader a turn now and then, in case the threads share one CPU
+			if (k % 64 == 0) std::this_thread::yield();
+		}
+		done = true;
+	});
+
+	bool failed = false;
+	uint64_t reads = 0, distinct = 0;
+	uint32_t last = 0;
+	while (!failed)
+	{
+		bool finished = done;
+		uint32_t values[mailboxValues];
+		uint32_t k = mailbox.Read(values);
+		reads++;
+		if (k != last) distinct++;
+		else std::this_thread::yield();
+		for (unsigned i = 0; i < mailboxValues; i++)
+		{
+			if (values[i] != k)
+			{
+				fprintf(stderr, "Mailbox: read of write %u returned value %u from write %u at %u\n",
+						unsigned(k), unsigned(values[i]), unsigned(values[i]), i);
+				failed = true;
+				break;
+			}
+		}
+		if (k < last)
+		{
+			fprintf(stderr, "Mailbox: read write %u after write %u\n", unsigned(k), unsigned(last));
+			failed = true;
+		}
+		last = k;
+		// One more read after the writer has finished, which must see its last write
+		if (finished)
+		{
+			if (!failed && k != writes)
+			{
+				fprintf(stderr, "Mailbox: last read was of write %u, not %u\n", unsigned(k), unsigned(writes));
+				failed = true;
+			}
+			break;
+		}
+	}
+	writer.join();
+
+	printf("Mailbox<%u>: %u writes, %llu reads of %llu different writes: %s\n", mailboxValues, unsigned(writes),
+		   (unsigned long long)reads, (unsigned long long)distinct, failed ? "FAILED" : "ok");
+	return !failed;
+}
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [--items N] [--writes N]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t items = 20000000, writes = 5000000;
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && !strcmp(argv[i], "--items")) items = strtoul(argv[++i], nullptr, 0);
+		else if (i + 1 < argc && !strcmp(argv[i], "--writes")) writes = strtoul(argv[++i], nullptr, 0);
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+
+	bool ok = TestRing(items);
+	ok = TestMailbox(writes) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+Converts a ComputerCard trace dump (see TraceDump and the trace example)
+into Chrome trace event JSON, for viewing in https://ui.perfetto.dev or
+chrome://tracing, with each RP2040 core as a separate track.
+
+The dump may be a log of a whole USB serial session: other lines are
+ignored, and if it holds several dumps, the last is used. A summary of
+each traced span (count, and minimum, mean and maximum duration) is
+printed to stderr.
+
+Usage: trace_decode DUMP [JSON]
+Writes to stdout if JSON is not given.
+*/
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+struct Record
+{
+	unsigned core;
+	uint32_t time;
+	char type;
+	unsigned id;
+	uint32_t value;
+	double us; // time relative to the first record
+	size_t order; // position in the dump, to keep records in order within a core
+};
+
+struct Span
+{
+	uint64_t count = 0;
+	double minUs = 1e30, maxUs = 0, totalUs = 0;
+};
+
+// Escape a string for JSON
+static std::string Quote(const std::string &s)
+{
+	std::string out = "\"";
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\') out += '\\';
+		if (uint8_t(c) < 0x20) continue;
+		out += c;
+	}
+	return out + "\"";
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 3)
+	{
+		fprintf(stderr, "Usage: %s DUMP [JSON]\n", argv[0]);
+		return 1;
+	}
+
+	FILE *in = fopen(argv[1], "r");
+	if (!in)
+	{
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	// Parse the last dump in the file
+	std::vector<Record> records;
+	std::map<unsigned, std::string> names;
+	double tickHz = 1000000;
+	bool inDump = false, found = false;
+	char line[256];
+	while (fgets(line, sizeof(line), in))
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		unsigned long hz;
+		if (sscanf(line, "# computercard-trace 1 tick_hz=%lu", &hz) == 1)
+		{
+			records.clear();
+			names.clear();
+			tickHz = double(hz ? hz : 1);
+			inDump = found = true;
+			continue;
+		}
+		if (!inDump) continue;
+		if (!strcmp(line, "# end"))
+		{
+			inDump = false;
+			continue;
+		}
+
+		Record r;
+		unsigned id;
+		int pos;
+		unsigned long time, value;
+		if (sscanf(line, "R %u %lu %c %u %lu", &r.core, &time, &r.type, &r.id, &value) == 5 && r.core < 2)
+		{
+			r.time = uint32_t(time);
+			r.value = uint32_t(value);
+			r.order = records.size();
+			records.push_back(r);
+		}
+		else if (sscanf(line, "N %u %n", &id, &pos) == 1)
+		{
+			names[id] = line + pos;
+		}
+	}
+	fclose(in);
+	if (!found)
+	{
+		fprintf(stderr, "no trace dump found in %s\n", argv[1]);
+		return 1;
+	}
+
+	// Times are 32-bit ticks, which may have wrapped around, so are taken relative to the
+	// first record, then shifted so that the earliest is at zero
+	if (!records.empty())
+	{
+		uint32_t ref = records[0].time;
+		double earliest = 0;
+		for (Record &r : records)
+		{
+			r.us = double(int32_t(r.time - ref)) * 1e6 / tickHz;
+			earliest = std::min(earliest, r.us);
+		}
+		for (Record &r : records) r.us -= earliest;
+	}
+	std::stable_sort(records.begin(), records.end(),
+					 [](const Record &a, const Record &b) {return a.us < b.us || (a.us == b.us && a.order < b.order);});
+
+	FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+	if (!out)
+	{
+		fprintf(stderr, "cannot write %s\n", argv[2]);
+		return 1;
+	}
+
+	auto name = [&](unsigned id) {
+		auto it = names.find(id);
+		return it != names.end() ? it->second : "id " + std::to_string(id);
+	};
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"core 0 (audio)\"}},\n");
+	fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"core 1\"}}");
+
+	// Spans still open on each core, by ID, with their start times. The oldest records in a
+	// ring may have been overwritten, so an end with no start is dropped.
+	std::map<unsigned, std::vector<double>> open[2];
+	std::map<unsigned, Span> spans;
+	for (const Record &r : records)
+	{
+		std::string n = Quote(name(r.id));
+		char common[128];
+		snprintf(common, sizeof(common), "\"pid\":1,\"tid\":%u,\"ts\":%.3f", r.core, r.us);
+		switch (r.type)
+		{
+		case 'B':
+			open[r.core][r.id].push_back(r.us);
+			fprintf(out, ",\n{\"ph\":\"B\",\"name\":%s,%s,\"args\":{\"value\":%" PRIu32 "}}", n.c_str(), common, r.value);
+			break;
+		case 'E':
+		{
+			std::vector<double> &starts = open[r.core][r.id];
+			if (starts.empty()) break;
+			double d = r.us - starts.back();
+			starts.pop_back();
+			Span &s = spans[r.id];
+			s.count++;
+			s.totalUs += d;
+			s.minUs = std::min(s.minUs, d);
+			s.maxUs = std::max(s.maxUs, d);
+			fprintf(out, ",\n{\"ph\":\"E\",\"name\":%s,%s}", n.c_str(), common);
+			break;
+		}
+		case 'I':
+			fprintf(out, ",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":%s,%s,\"args\":{\"value\":%" PRIu32 "}}", n.c_str(), common, r.value);
+			break;
+		case 'C':
+			fprintf(out, ",\n{\"ph\":\"C\",\"name\":%s,%s,\"args\":{%s:%" PRIu32 "}}", n.c_str(), common, n.c_str(), r.value);
+			break;
+		}
+	}
+	fprintf(out, "\n]}\n");
+	if (out != stdout) fclose(out);
+
+	fprintf(stderr, "%zu records, %.1fms\n", records.size(), records.empty() ? 0.0 : records.back().us / 1000);
+	for (const auto &[id, s] : spans)
+	{
+		fprintf(stderr, "%-28s n=%-8" PRIu64 " min=%.1fus mean=%.1fus max=%.1fus\n", name(id).c_str(), s.count,
+				s.minUs, s.totalUs / double(s.count), s.maxUs);
+	}
+	return 0;
+}
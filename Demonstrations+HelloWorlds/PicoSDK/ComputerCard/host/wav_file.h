@@ -0,0 +1,168 @@
+/*
+Minimal 16-bit PCM WAV reader and writer for the ComputerCard host build.
+*/
+
+#ifndef HOST_WAV_FILE_H
+#define HOST_WAV_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace cchost
+{
+	// Reads a whole 16-bit PCM WAV file into memory
+	class WavReader
+	{
+	public:
+		bool Open(const std::string &filename, std::string &error)
+		{
+			FILE *f = fopen(filename.c_str(), "rb");
+			if (!f)
+			{
+				error = "cannot open " + filename;
+				return false;
+			}
+			bool ok = Parse(f, error);
+			fclose(f);
+			if (!ok) error = filename + ": " + error;
+			return ok;
+		}
+
+		uint32_t SampleRate() const { return sampleRate; }
+		unsigned Channels() const { return channels; }
+		uint64_t Frames() const { return channels ? data.size() / channels : 0; }
+
+		// Sample of channel ch at frame i, or 0 beyond the end of the file.
+		// Mono files return the same sample for every channel.
+		int16_t Sample(uint64_t i, unsigned ch) const
+		{
+			if (i >= Frames()) return 0;
+			return data[i * channels + (ch < channels ? ch : 0)];
+		}
+
+	private:
+		static uint32_t U32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+		static uint16_t U16(const uint8_t *p) { return uint16_t(p[0] | (p[1] << 8)); }
+
+		bool Parse(FILE *f, std::string &error)
+		{
+			uint8_t hdr[12];
+			if (fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4))
+			{
+				error = "not a WAV file";
+				return false;
+			}
+
+			bool haveFormat = false;
+			uint8_t chunk[8];
+			while (fread(chunk, 1, 8, f) == 8)
+			{
+				uint32_t size = U32(chunk + 4);
+				if (!memcmp(chunk, "fmt ", 4))
+				{
+					std::vector<uint8_t> fmt(size);
+					if (size < 16 || fread(fmt.data(), 1, size, f) != size) break;
+					uint16_t format = U16(&fmt[0]);
+					channels = U16(&fmt[2]);
+					sampleRate = U32(&fmt[4]);
+					uint16_t bits = U16(&fmt[14]);
+					if ((format != 1 && format != 0xFFFE) || bits != 16 || channels < 1)
+					{
+						error = "only 16-bit PCM WAV files are supported";
+						return false;
+					}
+					haveFormat = true;
+				}
+				else if (!memcmp(chunk, "data", 4) && haveFormat)
+				{
+					std::vector<uint8_t> raw(size);
+					size_t got = fread(raw.data(), 1, size, f);
+					data.resize(got / 2);
+					for (size_t i = 0; i < data.size(); i++) data[i] = int16_t(U16(&raw[2 * i]));
+					return true;
+				}
+				else if (fseek(f, size + (size & 1), SEEK_CUR))
+				{
+					break;
+				}
+			}
+			error = "no audio data found";
+			return false;
+		}
+
+		std::vector<int16_t> data;
+		uint32_t sampleRate = 0;
+		unsigned channels = 0;
+	};
+
+	// Streams 16-bit PCM frames to a WAV file, patching the header sizes on Close
+	class WavWriter
+	{
+	public:
+		~WavWriter() { Close(); }
+
+		bool Open(const std::string &filename, unsigned numChannels, uint32_t rate)
+		{
+			f = fopen(filename.c_str(), "wb");
+			if (!f) return false;
+			channels = numChannels;
+			sampleRate = rate;
+			frames = 0;
+			WriteHeader();
+			return true;
+		}
+
+		bool IsOpen() const { return f != nullptr; }
+
+		// Change the sample rate in the header, which is rewritten on Close
+		void SetRate(uint32_t rate) { sampleRate = rate; }
+
+		// One sample per channel. Assumes a little-endian host, as WAV is little-endian.
+		void Write(const int16_t *frame)
+		{
+			fwrite(frame, 2, channels, f);
+			frames++;
+		}
+
+		void Close()
+		{
+			if (!f) return;
+			fseek(f, 0, SEEK_SET);
+			WriteHeader();
+			fclose(f);
+			f = nullptr;
+		}
+
+	private:
+		static void Put32(uint8_t *p, uint32_t v)
+		{
+			for (int i = 0; i < 4; i++) p[i] = uint8_t(v >> (8 * i));
+		}
+
+		void WriteHeader()
+		{
+			uint32_t dataBytes = uint32_t(frames * channels * 2);
+			uint8_t h[44] = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+							 'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 0, 0,
+							 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 0,
+							 'd', 'a', 't', 'a', 0, 0, 0, 0};
+			Put32(h + 4, 36 + dataBytes);
+			h[22] = uint8_t(channels);
+			Put32(h + 24, sampleRate);
+			Put32(h + 28, sampleRate * channels * 2);
+			h[32] = uint8_t(channels * 2);
+			Put32(h + 40, dataBytes);
+			fwrite(h, 1, 44, f);
+		}
+
+		FILE *f = nullptr;
+		unsigned channels = 0;
+		uint32_t sampleRate = 0;
+		uint64_t frames = 0;
+	};
+}
+
+#endif
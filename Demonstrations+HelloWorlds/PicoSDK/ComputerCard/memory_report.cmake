@@ -0,0 +1,79 @@
+# Memory map summary of a card, printed after it is linked (see add_example in CMakeLists.txt):
+# RAM taken by static data and code run from RAM, RAM left for the heap and the stacks, flash used,
+# and the largest variables and functions in RAM. Run as a script:
+#
+#   cmake -DELF=<card>.elf -DNM=<arm-none-eabi-nm> [-DTOP=<n>] -P memory_report.cmake
+#
+# The heap and stacks are used at run time, so aren't known here: see ComputerCard::MemoryUsage.
+
+if (NOT DEFINED TOP)
+  set(TOP 8)
+endif()
+
+execute_process(COMMAND ${NM} ${ELF} OUTPUT_VARIABLE symbols RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+  message(WARNING "memory_report: cannot read symbols of ${ELF}")
+  return()
+endif()
+execute_process(COMMAND ${NM} --print-size --size-sort --reverse-sort --demangle ${ELF} OUTPUT_VARIABLE sized)
+
+# Addresses of the linker script's symbols
+string(REPLACE "\n" ";" symbols "${symbols}")
+foreach (line IN LISTS symbols)
+  if (line MATCHES "^([0-9a-fA-F]+) [A-Za-z] (__[A-Za-z_]+)$")
+	math(EXPR address "0x${CMAKE_MATCH_1}")
+	set(addr_${CMAKE_MATCH_2} ${address})
+  endif()
+endforeach()
+
+macro (region_size _var _start _end)
+  if (DEFINED addr_${_start} AND DEFINED addr_${_end})
+	math(EXPR ${_var} "${addr_${_end}} - ${addr_${_start}}")
+  else()
+	set(${_var} "?")
+  endif()
+endmacro()
+
+region_size(data_bytes __data_start__ __data_end__)
+region_size(bss_bytes __bss_start__ __bss_end__)
+region_size(heap_bytes __end__ __HeapLimit)
+region_size(stack0_bytes __StackBottom __StackTop)
+region_size(stack1_bytes __StackOneBottom __StackOneTop)
+region_size(flash_bytes __flash_binary_start __flash_binary_end)
+if (data_bytes STREQUAL "?" OR bss_bytes STREQUAL "?")
+  set(static_bytes "?")
+else()
+  math(EXPR static_bytes "${data_bytes} + ${bss_bytes}")
+endif()
+
+get_filename_component(card ${ELF} NAME_WE)
+set(report "${card} memory:\n")
+string(APPEND report "  static RAM  ${static_bytes} bytes (.data and RAM code ${data_bytes}, .bss ${bss_bytes})\n")
+string(APPEND report "  heap        ${heap_bytes} bytes free at startup\n")
+string(APPEND report "  stacks      ${stack0_bytes} bytes core 0, ${stack1_bytes} bytes core 1\n")
+string(APPEND report "  flash       ${flash_bytes} bytes\n")
+
+# Largest symbols in RAM (SRAM at 0x20000000, or its non-striped alias at 0x21000000), largest first
+string(APPEND report "  largest in RAM:\n")
+string(REPLACE "\n" ";" sized "${sized}")
+set(listed 0)
+foreach (line IN LISTS sized)
+  if (listed GREATER_EQUAL TOP)
+	break()
+  endif()
+  if (line MATCHES "^([0-9a-fA-F]+) ([0-9a-fA-F]+) [A-Za-z] (.*)$")
+	math(EXPR address "0x${CMAKE_MATCH_1}")
+	math(EXPR size "0x${CMAKE_MATCH_2}")
+	if (address GREATER_EQUAL 536870912 AND address LESS 570425344) # 0x20000000 to 0x22000000
+	  set(name "${CMAKE_MATCH_3}")
+	  string(LENGTH "${size}" digits)
+	  foreach (pad RANGE ${digits} 8)
+		string(PREPEND size " ")
+	  endforeach()
+	  string(APPEND report "  ${size}  ${name}\n")
+	  math(EXPR listed "${listed} + 1")
+	endif()
+  endif()
+endforeach()
+
+message("${report}")
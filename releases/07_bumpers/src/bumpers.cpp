@@ -1,4 +1,5 @@
 
+#define COMPUTERCARD_CLAMP_CV_OUTPUTS 1
 #include "ComputerCard.h"
 #include <cmath>
 
@@ -1,4 +1,6 @@
 #include "WavFile.h"
+#define COMPUTERCARD_CLAMP_CV_OUTPUTS 1
+#define COMPUTERCARD_PRECISE_CV 1
 #include "ComputerCard.h"
 
 #include "pico/stdlib.h" 
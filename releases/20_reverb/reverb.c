@@ -1261,6 +1261,8 @@ int main()
 	ReadEEPROM();
 
 	dv = reverb_create();
+	if (!dv)
+		panic("reverb: no room for the reverb's buffers");
 
 	turing_machine_init(&tm);
 	bernoulli_gate_init(&bg);
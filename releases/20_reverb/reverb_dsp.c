@@ -18,9 +18,17 @@
 
 #include "reverb_dsp.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
+// The reverb and its delay buffers are static rather than on the heap, so that the RAM they take
+// is counted when the card is linked. There is one reverb at a time.
+static reverb instance;
+static uint8_t instanceInUse; // boolean
+static int32_t bufferWords[REVERB_BUFFER_WORDS];
+static uint32_t bufferWordsUsed; // taken by buffer_init
+
 
 // Clamp value between min and max 
 int32_t __not_in_flash_func(clamp)(int32_t x, int32_t min, int32_t max)
@@ -42,26 +50,20 @@ void __not_in_flash_func(buffer_setDelay)(buffer *db, uint16_t tap, uint16_t del
 
 ////////////////////////////////////////
 // Delay functions
-void buffer_init(buffer *db, uint16_t delay)
+
+// Take a buffer from bufferWords, or return false if there isn't room for it
+bool buffer_init(buffer *db, uint16_t delay)
 {
 	memset(db, 0, sizeof(delay));
 
-	// Calculate number of bits
-	int16_t x = delay;
-	uint16_t numBits = 0;
-	while (x)
-	{
-		numBits++;
-		x >>= 1;
-	}
-
-	// Buffer size is always 2^n, to avoid
-	uint16_t bufferSize = 1 << numBits;
+	// Buffer size is always 2^n, to wrap with a mask, and as counted by REVERB_BUFFER_WORDS
+	uint16_t bufferSize = REVERB_BUFFER_SIZE(delay);
 
 	// Allocate buffer
-	db->buffer = malloc(bufferSize * sizeof(int32_t));
-	if (!db->buffer)
-		return;
+	if (bufferWordsUsed + bufferSize > REVERB_BUFFER_WORDS)
+		return false;
+	db->buffer = bufferWords + bufferWordsUsed;
+	bufferWordsUsed += bufferSize;
 
 	// Clear buffer
 	memset(db->buffer, 0, bufferSize * sizeof(int32_t));
@@ -69,6 +71,7 @@ void buffer_init(buffer *db, uint16_t delay)
 	// Create bitmask for fast wrapping of the circular buffer
 	db->mask = bufferSize - 1;
 	buffer_setDelay(db, TAP_MAIN, delay);
+	return true;
 }
 
 void buffer_clear(buffer *db)
@@ -77,9 +80,9 @@ void buffer_clear(buffer *db)
 	memset(db->buffer, 0, size * sizeof(int32_t));
 }
 
+// The buffer's memory is returned with the reverb (see reverb_delete)
 void buffer_delete(buffer *db)
 {
-	free(db->buffer);
 	db->buffer = 0;
 }
 
@@ -183,47 +186,60 @@ void __not_in_flash_func(reverb_set_tilt)(struct sreverb *v, int32_t value)
 	v->preFilterHPF = value >> 1;
 }
 
-// Initialise reverb instance
-void initialise(reverb *v)
+// Initialise reverb instance, or return false if its buffers don't fit in bufferWords
+bool initialise(reverb *v)
 {
 	memset(v, 0, sizeof(reverb));
 
-	buffer_init(&v->preDelay, 4100);
+	if (!buffer_init(&v->preDelay, REVERB_PRE_DELAY))
+		return false;
 
-	buffer_init(&v->inDiffusion[0], 142);
-	buffer_init(&v->inDiffusion[1], 107);
-	buffer_init(&v->inDiffusion[2], 379);
-	buffer_init(&v->inDiffusion[3], 277);
+	if (!buffer_init(&v->inDiffusion[0], REVERB_IN_DIFFUSION_1))
+		return false;
+	if (!buffer_init(&v->inDiffusion[1], REVERB_IN_DIFFUSION_2))
+		return false;
+	if (!buffer_init(&v->inDiffusion[2], REVERB_IN_DIFFUSION_3))
+		return false;
+	if (!buffer_init(&v->inDiffusion[3], REVERB_IN_DIFFUSION_4))
+		return false;
 
-	buffer_init(&v->decayDiffusion1[0], 672); // + EXCURSION
+	if (!buffer_init(&v->decayDiffusion1[0], REVERB_DECAY_DIFFUSION_1_L)) // + EXCURSION
+		return false;
 	v->decayDiffusion1[0].readOffset[TAP_OUT1] = v->decayDiffusion1[0].readOffset[TAP_MAIN];
 
-	buffer_init(&v->preDampingDelay[0], 4453);
+	if (!buffer_init(&v->preDampingDelay[0], REVERB_PRE_DAMPING_DELAY_L))
+		return false;
 	buffer_setDelay(&v->preDampingDelay[0], TAP_OUT1, 353);
 	buffer_setDelay(&v->preDampingDelay[0], TAP_OUT2, 3627);
 	buffer_setDelay(&v->preDampingDelay[0], TAP_OUT3, 1990);
 
-	buffer_init(&v->decayDiffusion2[0], 1800);
+	if (!buffer_init(&v->decayDiffusion2[0], REVERB_DECAY_DIFFUSION_2_L))
+		return false;
 	buffer_setDelay(&v->decayDiffusion2[0], TAP_OUT1, 187);
 	buffer_setDelay(&v->decayDiffusion2[0], TAP_OUT2, 1228);
 
-	buffer_init(&v->postDampingDelay[0], 3720);
+	if (!buffer_init(&v->postDampingDelay[0], REVERB_POST_DAMPING_DELAY_L))
+		return false;
 	buffer_setDelay(&v->postDampingDelay[0], TAP_OUT1, 1066);
 	buffer_setDelay(&v->postDampingDelay[0], TAP_OUT2, 2673);
 
-	buffer_init(&v->decayDiffusion1[1], 908); // + EXCURSION
+	if (!buffer_init(&v->decayDiffusion1[1], REVERB_DECAY_DIFFUSION_1_R)) // + EXCURSION
+		return false;
 	v->decayDiffusion1[1].readOffset[TAP_OUT1] = v->decayDiffusion1[1].readOffset[TAP_MAIN];
 
-	buffer_init(&v->preDampingDelay[1], 4217);
+	if (!buffer_init(&v->preDampingDelay[1], REVERB_PRE_DAMPING_DELAY_R))
+		return false;
 	buffer_setDelay(&v->preDampingDelay[1], TAP_OUT1, 266);
 	buffer_setDelay(&v->preDampingDelay[1], TAP_OUT2, 2974);
 	buffer_setDelay(&v->preDampingDelay[1], TAP_OUT3, 2111);
 
-	buffer_init(&v->decayDiffusion2[1], 2656);
+	if (!buffer_init(&v->decayDiffusion2[1], REVERB_DECAY_DIFFUSION_2_R))
+		return false;
 	buffer_setDelay(&v->decayDiffusion2[1], TAP_OUT1, 335);
 	buffer_setDelay(&v->decayDiffusion2[1], TAP_OUT2, 1913);
 
-	buffer_init(&v->postDampingDelay[1], 3163);
+	if (!buffer_init(&v->postDampingDelay[1], REVERB_POST_DAMPING_DELAY_R))
+		return false;
 	buffer_setDelay(&v->postDampingDelay[1], TAP_OUT1, 121);
 	buffer_setDelay(&v->postDampingDelay[1], TAP_OUT2, 1996);
 
@@ -242,16 +258,21 @@ void initialise(reverb *v)
 	v->decayDiffusion1Amount = 45875;
 	reverb_set_size(v, 49152);
 	reverb_set_tilt(v, 62259);
+	return true;
 }
 
-// Get pointer to initialised reverb instance
+// Get pointer to initialised reverb instance, or NULL if there is one already
 reverb *reverb_create(void)
 {
-	reverb *v = malloc(sizeof(reverb));
-	if (!v)
+	if (instanceInUse)
+		return NULL;
+
+	reverb *v = &instance;
+	bufferWordsUsed = 0;
+	if (!initialise(v))
 		return NULL;
 
-	initialise(v);
+	instanceInUse = 1;
 	return v;
 }
 
@@ -274,7 +295,9 @@ void reverb_delete(reverb *v)
 		buffer_delete(&v->postDampingDelay[i]);
 	}
 
-	free(v);
+	// Free the reverb and its buffers for reverb_create
+	bufferWordsUsed = 0;
+	instanceInUse = 0;
 }
 
 // Resets buffers to zero 
@@ -6,9 +6,44 @@
 #include <stdint.h>
 struct sreverb;
 
+// Delay lengths, in samples, of the reverb's buffers (see initialise)
+#define REVERB_PRE_DELAY 4100
+#define REVERB_IN_DIFFUSION_1 142
+#define REVERB_IN_DIFFUSION_2 107
+#define REVERB_IN_DIFFUSION_3 379
+#define REVERB_IN_DIFFUSION_4 277
+#define REVERB_DECAY_DIFFUSION_1_L 672
+#define REVERB_PRE_DAMPING_DELAY_L 4453
+#define REVERB_DECAY_DIFFUSION_2_L 1800
+#define REVERB_POST_DAMPING_DELAY_L 3720
+#define REVERB_DECAY_DIFFUSION_1_R 908
+#define REVERB_PRE_DAMPING_DELAY_R 4217
+#define REVERB_DECAY_DIFFUSION_2_R 2656
+#define REVERB_POST_DAMPING_DELAY_R 3163
+
+// Words of buffer taken by a delay: the smallest power of two greater than it, so that it wraps with a mask
+#define REVERB_BUFFER_SIZE(delay) \
+	((delay) < 1 ? 1 : (delay) < 2 ? 2 : (delay) < 4 ? 4 : (delay) < 8 ? 8 : \
+	(delay) < 16 ? 16 : (delay) < 32 ? 32 : (delay) < 64 ? 64 : (delay) < 128 ? 128 : \
+	(delay) < 256 ? 256 : (delay) < 512 ? 512 : (delay) < 1024 ? 1024 : (delay) < 2048 ? 2048 : \
+	(delay) < 4096 ? 4096 : (delay) < 8192 ? 8192 : (delay) < 16384 ? 16384 : 32768)
+
+// Words of delay buffer taken by a reverb (42368, or 165.5kB)
+#define REVERB_BUFFER_WORDS ( \
+	REVERB_BUFFER_SIZE(REVERB_PRE_DELAY) + \
+	REVERB_BUFFER_SIZE(REVERB_IN_DIFFUSION_1) + REVERB_BUFFER_SIZE(REVERB_IN_DIFFUSION_2) + \
+	REVERB_BUFFER_SIZE(REVERB_IN_DIFFUSION_3) + REVERB_BUFFER_SIZE(REVERB_IN_DIFFUSION_4) + \
+	REVERB_BUFFER_SIZE(REVERB_DECAY_DIFFUSION_1_L) + REVERB_BUFFER_SIZE(REVERB_PRE_DAMPING_DELAY_L) + \
+	REVERB_BUFFER_SIZE(REVERB_DECAY_DIFFUSION_2_L) + REVERB_BUFFER_SIZE(REVERB_POST_DAMPING_DELAY_L) + \
+	REVERB_BUFFER_SIZE(REVERB_DECAY_DIFFUSION_1_R) + REVERB_BUFFER_SIZE(REVERB_PRE_DAMPING_DELAY_R) + \
+	REVERB_BUFFER_SIZE(REVERB_DECAY_DIFFUSION_2_R) + REVERB_BUFFER_SIZE(REVERB_POST_DAMPING_DELAY_R))
+
+// Static RAM taken by the reverb and its delay buffers (see reverb_create)
+#define REVERB_RAM_BYTES (sizeof(struct sreverb) + REVERB_BUFFER_WORDS * sizeof(int32_t))
+
 int32_t __not_in_flash_func(clamp)(int32_t x, int32_t min, int32_t max);
 
-// Get pointer to initialized reverb struct 
+// Get pointer to initialized reverb struct, or NULL if there is one already
 struct sreverb *reverb_create(void);
 
 // Silence reverb by zeroing state 